@@ -0,0 +1,307 @@
+#include "kg_index.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ============================================================================
+// 파일 구간 읽기 백엔드 (io_uring / pread)
+// ============================================================================
+//
+// 구간들을 1MB 단위(파일 오프셋 기준 1MB 경계)로 쪼개 큐 깊이 kQueueDepth로 한꺼번에 걸어 두고,
+// 한 구간의 조각이 모두 도착하면 바로 호출자 콜백을 불러 그 구간의 디코딩이 남은 읽기와 겹치게 함
+// liburing 없이 커널 헤더와 시스템 콜만 씀 (링 구조는 io_uring_setup이 알려 주는 오프셋 그대로)
+
+namespace {
+
+constexpr unsigned kQueueDepth = 64;
+constexpr uint64_t kChunkBytes = 1 << 20;
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+class Uring {
+public:
+    ~Uring() {
+        if (sqes) munmap(sqes, sqes_bytes);
+        if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_bytes);
+        if (sq_ring) munmap(sq_ring, sq_bytes);
+        if (ring_fd >= 0) close(ring_fd);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd = sys_io_uring_setup(entries, &params);
+        if (ring_fd < 0) return false;
+
+        sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_bytes = cq_bytes = std::max(sq_bytes, cq_bytes);
+
+        sq_ring = mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) {
+            sq_ring = nullptr;
+            return false;
+        }
+        cq_ring = single_mmap ? sq_ring
+                              : mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            cq_ring = nullptr;
+            return false;
+        }
+        sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                               ring_fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            sqes = nullptr;
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // 커널이 opcode를 지원하는지 확인 (io_uring_setup만 되는 5.1~5.5 커널에는 IORING_OP_READ가 없고
+    // 그때는 읽기마다 -EINVAL이 돌아옴, 이 커널들은 IORING_REGISTER_PROBE도 모르므로 실패 = 미지원)
+    bool supports(unsigned opcode) {
+        constexpr unsigned kProbeOps = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (sys_io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) return false;
+        return opcode <= probe->last_op && opcode < probe->ops_len && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    // 제출 큐에 읽기 하나 추가 (io_uring_enter 전까지는 커널에 보이지 않음)
+    void queue_read(int fd, void* buffer, unsigned size, uint64_t offset, uint64_t user_data) {
+        unsigned tail = *sq_tail;
+        unsigned slot = tail & sq_mask;
+        io_uring_sqe& sqe = sqes[slot];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = size;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array[slot] = slot;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        pending++;
+    }
+
+    // 쌓인 요청을 제출하고 완료가 하나 이상 올 때까지 대기
+    bool submit_and_wait() {
+        int submitted = sys_io_uring_enter(ring_fd, pending, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) return errno == EINTR;
+        pending -= submitted;
+        return true;
+    }
+
+    // 완료된 요청마다 done(user_data, 결과) 호출
+    template <typename Done>
+    void reap(Done&& done) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            done(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int ring_fd = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    size_t sq_bytes = 0, cq_bytes = 0, sqes_bytes = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned pending = 0;
+};
+
+bool uring_available() {
+    static const bool available = [] {
+        Uring ring;
+        return ring.init(4) && ring.supports(IORING_OP_READ);
+    }();
+    return available;
+}
+
+IoBackend& active_backend() {
+    static IoBackend backend = uring_available() ? IoBackend::Uring : IoBackend::Pread;
+    return backend;
+}
+
+struct Chunk {
+    size_t range;
+    uint64_t offset;     // 파일 오프셋
+    char* dest;
+    uint64_t size;
+};
+
+// 구간마다 1MB 경계로 쪼갬 (구간 순서대로 -> 앞 구간이 먼저 완성됨)
+std::vector<Chunk> split_ranges(const std::vector<ReadRange>& ranges) {
+    std::vector<Chunk> chunks;
+    for (size_t r = 0; r < ranges.size(); r++) {
+        uint64_t offset = ranges[r].offset;
+        uint64_t end = offset + ranges[r].size;
+        char* dest = static_cast<char*>(ranges[r].dest);
+        while (offset < end) {
+            uint64_t next = std::min(end, (offset / kChunkBytes + 1) * kChunkBytes);
+            chunks.push_back(Chunk{r, offset, dest, next - offset});
+            dest += next - offset;
+            offset = next;
+        }
+    }
+    return chunks;
+}
+
+bool read_with_pread(int fd, const std::vector<ReadRange>& ranges, const std::function<bool(size_t)>& on_ready) {
+    for (size_t r = 0; r < ranges.size(); r++) {
+        char* dest = static_cast<char*>(ranges[r].dest);
+        uint64_t done = 0;
+        while (done < ranges[r].size) {
+            ssize_t got = pread(fd, dest + done, std::min<uint64_t>(ranges[r].size - done, kChunkBytes), ranges[r].offset + done);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            done += got;
+        }
+        if (!on_ready(r)) return false;
+    }
+    return true;
+}
+
+bool read_with_uring(int fd, const std::vector<ReadRange>& ranges, const std::function<bool(size_t)>& on_ready) {
+    Uring ring;
+    if (!ring.init(kQueueDepth)) return read_with_pread(fd, ranges, on_ready);
+
+    std::vector<Chunk> chunks = split_ranges(ranges);
+    std::vector<uint64_t> remaining(ranges.size());
+    for (size_t r = 0; r < ranges.size(); r++) {
+        remaining[r] = ranges[r].size;
+        if (remaining[r] == 0 && !on_ready(r)) return false;
+    }
+
+    size_t next = 0;
+    unsigned in_flight = 0;
+    bool ok = true;
+    while (ok && (next < chunks.size() || in_flight > 0)) {
+        for (; next < chunks.size() && in_flight < kQueueDepth; next++, in_flight++) {
+            const Chunk& c = chunks[next];
+            ring.queue_read(fd, c.dest, c.size, c.offset, next);
+        }
+        if (!ring.submit_and_wait()) {
+            ok = false;
+            break;
+        }
+
+        // 완료 처리는 한 번에 모아서: 짧게 읽힌 조각은 나머지를 다시 걸고, 다 찬 구간은 콜백
+        std::vector<size_t> ready;
+        ring.reap([&](uint64_t id, int result) {
+            in_flight--;
+            Chunk& c = chunks[id];
+            if (result <= 0) {
+                ok = false;
+                return;
+            }
+            remaining[c.range] -= result;
+            if ((uint64_t)result < c.size) {
+                c.dest += result;
+                c.offset += result;
+                c.size -= result;
+                ring.queue_read(fd, c.dest, c.size, c.offset, id);
+                in_flight++;
+            } else if (remaining[c.range] == 0) {
+                ready.push_back(c.range);
+            }
+        });
+        for (size_t r : ready) {
+            if (ok && !on_ready(r)) ok = false;
+        }
+    }
+
+    // 실패했으면 걸려 있는 읽기가 버퍼에 쓰기 전에 끝나도록 기다림
+    while (in_flight > 0 && ring.submit_and_wait()) {
+        ring.reap([&](uint64_t, int) { in_flight--; });
+    }
+    return ok;
+}
+
+}  // namespace
+
+bool select_io_backend(IoBackend backend) {
+    if (backend == IoBackend::Auto) backend = uring_available() ? IoBackend::Uring : IoBackend::Pread;
+    if (!io_backend_supported(backend)) return false;
+    active_backend() = backend;
+    return true;
+}
+
+IoBackend active_io_backend() {
+    return active_backend();
+}
+
+bool io_backend_supported(IoBackend backend) {
+    return backend != IoBackend::Uring || uring_available();
+}
+
+const char* io_backend_name(IoBackend backend) {
+    switch (backend) {
+        case IoBackend::Auto: return "auto";
+        case IoBackend::Uring: return "io_uring";
+        case IoBackend::Pread: return "pread";
+    }
+    return "?";
+}
+
+bool parse_io_backend(const std::string& name, IoBackend& backend) {
+    for (IoBackend b : {IoBackend::Auto, IoBackend::Uring, IoBackend::Pread}) {
+        if (name == io_backend_name(b)) {
+            backend = b;
+            return true;
+        }
+    }
+    if (name == "uring") {
+        backend = IoBackend::Uring;
+        return true;
+    }
+    return false;
+}
+
+bool read_file_ranges(const std::string& filename, const std::vector<ReadRange>& ranges,
+                      const std::function<bool(size_t)>& on_ready) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    bool ok = active_backend() == IoBackend::Uring ? read_with_uring(fd, ranges, on_ready)
+                                                   : read_with_pread(fd, ranges, on_ready);
+    close(fd);
+    return ok;
+}
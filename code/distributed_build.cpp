@@ -0,0 +1,324 @@
+#include "kg_index.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ============================================================================
+// 분산 구성 (코디네이터 / 워커 프로세스)
+// ============================================================================
+//
+// 제어는 유닉스 소켓의 줄 단위 텍스트, 데이터(스냅샷, 샤드)는 shard_dir의 파일
+//   워커 -> 코디네이터 : "ready" | "done <kind> <첫 g> <처음 빈 g 또는 끝 g>" | "failed <kind> <첫 g>"
+//   코디네이터 -> 워커 : "job <kind> <첫 g> <끝 g>" | "quit"
+// 구간은 요청이 올 때마다 g가 작은 것부터 나눠 주고 (앞쪽 레벨일수록 무거움), 어느 워커가 빈 레벨을 보고하면
+// 그 뒤 구간은 더 나눠 주지 않음. 작업 중에 끊긴 워커의 구간은 다른 워커에 다시 줌
+
+namespace {
+
+struct Job {
+    std::string kind;
+    int begin;
+    int end;
+};
+
+// 종류마다 다음에 나눠 줄 g와 지금까지 알려진 끝
+struct KindProgress {
+    std::string kind;
+    int next_g = 1;
+    int stop_g = INT_MAX;
+};
+
+struct Connection {
+    int fd = -1;
+    std::string input;
+    bool busy = false;
+    Job job{};
+};
+
+bool send_line(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    const char* bytes = data.data();
+    size_t size = data.size();
+    while (size > 0) {
+        ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+// 한 줄을 받을 때까지 읽음 (연결이 끊기면 false)
+bool receive_line(int fd, std::string& buffer, std::string& line) {
+    while (true) {
+        size_t newline = buffer.find('\n');
+        if (newline != std::string::npos) {
+            line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            return true;
+        }
+        char chunk[256];
+        ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        buffer.append(chunk, got);
+    }
+}
+
+bool socket_address(const std::string& path, sockaddr_un& address) {
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+pid_t spawn_worker(const std::vector<std::string>& args, const std::string& log_file) {
+    // fork 뒤에는 할당하지 않도록 인자는 미리 준비
+    std::vector<char*> argv;
+    for (const std::string& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    // 자식: 출력은 워커별 로그로 보내고 같은 실행 파일을 워커 모드로 다시 실행
+    int log = open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log >= 0) {
+        dup2(log, STDOUT_FILENO);
+        dup2(log, STDERR_FILENO);
+        close(log);
+    }
+    execv("/proc/self/exe", argv.data());
+    _exit(127);
+}
+
+}  // namespace
+
+// g가 최대 차수보다 크면 어떤 두 노드도 g개의 하이퍼엣지를 공유할 수 없으므로 (1,g)-core가 빔
+// 최대 차수 레벨은 (쌍둥이끼리는 모든 하이퍼엣지를 공유하므로) 비어 있지 않을 수 있어서, 병합이 멈출 수 있도록
+// 처음 빈 레벨인 최대 차수 + 1까지 나눠 줌
+int level_shard_bound(const Hypergraph& hypergraph) {
+    size_t max_degree = 0;
+    for (const auto& [node, hyperedges] : hypergraph.node_hyperedges) {
+        max_degree = std::max(max_degree, hyperedges.size());
+    }
+    return (int)std::min(max_degree + 2, hypergraph.E.size());
+}
+
+bool run_distributed_levels(const Hypergraph& index_graph, const std::vector<std::string>& kinds, const DistributedOptions& options) {
+    std::filesystem::create_directories(options.shard_dir);
+    std::string snapshot = options.shard_dir + "/hypergraph.kgh";
+    if (!save_hypergraph_snapshot(index_graph, snapshot)) return false;
+
+    std::vector<KindProgress> progress;
+    for (const std::string& kind : kinds) {
+        progress.push_back(KindProgress{kind});
+        // 이전 실행의 샤드가 섞이지 않도록 지움
+        for (const auto& entry : std::filesystem::directory_iterator(options.shard_dir)) {
+            std::string name = entry.path().filename().string();
+            if (name.rfind(kind + "_", 0) == 0 && entry.path().extension() == ".shard") {
+                std::filesystem::remove(entry.path());
+            }
+        }
+    }
+    int bound = level_shard_bound(index_graph);
+
+    std::string socket_path = options.shard_dir + "/coordinator.sock";
+    sockaddr_un address;
+    if (!socket_address(socket_path, address)) {
+        socket_path = "/tmp/kg_coordinator_" + std::to_string(getpid()) + ".sock";
+        socket_address(socket_path, address);
+    }
+    unlink(socket_path.c_str());
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, options.workers) != 0) {
+        std::cerr << "❌ Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) close(listener);
+        return false;
+    }
+
+    std::cout << "🛰️  Distributed build: " << options.workers << " workers, " << options.levels_per_job
+              << " g levels per job, shards in " << options.shard_dir << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<pid_t> workers;
+    for (int w = 0; w < options.workers; w++) {
+        std::vector<std::string> args = {"kg", "--worker=" + socket_path, "--file=" + snapshot, "--shard-dir=" + options.shard_dir};
+        args.insert(args.end(), options.worker_args.begin(), options.worker_args.end());
+        pid_t pid = spawn_worker(args, options.shard_dir + "/worker_" + std::to_string(w) + ".log");
+        if (pid > 0) workers.push_back(pid);
+    }
+
+    std::deque<Job> retry;                // 끊긴 워커가 하던 구간
+    std::vector<Connection> connections;
+    int exited = 0;
+    size_t jobs_done = 0;
+    bool failed = workers.empty();
+
+    auto next_job = [&](Job& job) {
+        while (!retry.empty()) {
+            job = retry.front();
+            retry.pop_front();
+            for (const KindProgress& p : progress) {
+                if (p.kind == job.kind && job.begin < p.stop_g) return true;
+            }
+        }
+        for (KindProgress& p : progress) {
+            int limit = std::min(bound, p.stop_g);
+            if (p.next_g < limit) {
+                job = Job{p.kind, p.next_g, std::min(limit, p.next_g + options.levels_per_job)};
+                p.next_g = job.end;
+                return true;
+            }
+        }
+        return false;
+    };
+    auto finished = [&] {
+        if (!retry.empty()) return false;
+        for (const KindProgress& p : progress) {
+            if (p.next_g < std::min(bound, p.stop_g)) return false;
+        }
+        for (const Connection& c : connections) {
+            if (c.busy) return false;
+        }
+        return true;
+    };
+    auto assign = [&](Connection& c) {
+        Job job;
+        if (next_job(job)) {
+            c.busy = true;
+            c.job = job;
+            return send_line(c.fd, "job " + job.kind + " " + std::to_string(job.begin) + " " + std::to_string(job.end));
+        }
+        c.busy = false;
+        return true;  // 남은 구간이 없으면 대기 (다른 워커가 실패하면 그 구간을 받음)
+    };
+
+    while (!failed && !finished()) {
+        std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+        for (const Connection& c : connections) fds.push_back({c.fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) break;
+
+        // 죽은 워커 수거 (전부 죽었는데 일이 남았으면 실패)
+        for (int status; waitpid(-1, &status, WNOHANG) > 0;) exited++;
+        if (exited == (int)workers.size() && !finished()) {
+            std::cerr << "❌ All workers exited before the build finished" << std::endl;
+            failed = true;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                Connection c;
+                c.fd = fd;
+                connections.push_back(std::move(c));
+            }
+        }
+
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            Connection& c = connections[i - 1];
+
+            char chunk[256];
+            ssize_t got = recv(c.fd, chunk, sizeof(chunk), 0);
+            if (got <= 0) {
+                if (c.busy) retry.push_back(c.job);
+                close(c.fd);
+                c.fd = -1;
+                continue;
+            }
+            c.input.append(chunk, got);
+
+            for (size_t newline; (newline = c.input.find('\n')) != std::string::npos;) {
+                std::istringstream message(c.input.substr(0, newline));
+                c.input.erase(0, newline + 1);
+                std::string verb, kind;
+                int begin = 0, stop = 0;
+                message >> verb >> kind >> begin >> stop;
+
+                if (verb == "done") {
+                    jobs_done++;
+                    for (KindProgress& p : progress) {
+                        if (p.kind == kind && stop < c.job.end) p.stop_g = std::min(p.stop_g, stop);
+                    }
+                } else if (verb == "failed") {
+                    std::cerr << "❌ Worker failed on " << kind << " g=" << begin << std::endl;
+                    failed = true;
+                }
+                c.busy = false;
+                if (!failed && !assign(c)) {
+                    if (c.busy) retry.push_back(c.job);
+                    close(c.fd);
+                    c.fd = -1;
+                    break;
+                }
+            }
+        }
+        connections.erase(std::remove_if(connections.begin(), connections.end(), [](const Connection& c) { return c.fd < 0; }),
+                          connections.end());
+
+        // 새 구간이 생겼으면 (실패한 구간 재할당) 쉬고 있는 워커에게
+        for (Connection& c : connections) {
+            if (!c.busy && !retry.empty()) assign(c);
+        }
+    }
+
+    for (Connection& c : connections) {
+        send_line(c.fd, "quit");
+        close(c.fd);
+    }
+    close(listener);
+    unlink(socket_path.c_str());
+    for (pid_t pid : workers) {
+        int status;
+        waitpid(pid, &status, 0);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    if (failed) return false;
+    std::cout << "✅ Distributed build: " << jobs_done << " jobs";
+    for (const KindProgress& p : progress) {
+        std::cout << ", " << p.kind << " up to g=" << (std::min(bound, p.stop_g) - 1);
+    }
+    std::cout << " (" << std::fixed << std::setprecision(3) << seconds << "s)" << std::endl;
+    return true;
+}
+
+int run_level_worker(const std::string& socket_path, const Hypergraph& hypergraph, const std::string& shard_dir) {
+    sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || !socket_address(socket_path, address) ||
+        connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "❌ Cannot connect to coordinator at " << socket_path << std::endl;
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    std::string buffer, line;
+    bool ok = send_line(fd, "ready");
+    while (ok && receive_line(fd, buffer, line)) {
+        std::istringstream message(line);
+        std::string verb, kind;
+        int begin = 0, end = 0;
+        message >> verb >> kind >> begin >> end;
+        if (verb != "job") break;
+
+        std::cout << "🔧 Worker: " << kind << " g=" << begin << ".." << (end - 1) << std::endl;
+        int stop = build_level_shard(hypergraph, kind, begin, end, level_shard_path(shard_dir, kind, begin));
+        ok = stop < 0 ? send_line(fd, "failed " + kind + " " + std::to_string(begin))
+                      : send_line(fd, "done " + kind + " " + std::to_string(begin) + " " + std::to_string(stop));
+    }
+    close(fd);
+    return ok ? 0 : 1;
+}
@@ -3,72 +3,15 @@
 #include <memory>
 #include <iostream>
 #include <algorithm>
-
-class FastNaiveIndex {
-private:
-    std::unordered_map<uint64_t, std::unordered_set<int>> index_map;
-    static const std::unordered_set<int> empty_set;
-    
-    static constexpr uint64_t make_key(int k, int g) noexcept {
-        return (static_cast<uint64_t>(g) << 32) | static_cast<uint64_t>(k);
-    }
-    
-public:
-    explicit FastNaiveIndex(const std::shared_ptr<TreeNode>& tree) {
-        if (!tree || tree->children.empty()) return;
-        
-        // 🚀 미리 크기 계산해서 한번에 reserve
-        size_t estimated_size = 0;
-        for (const auto& g_child : tree->children) {
-            if (g_child && !g_child->children.empty()) {
-                estimated_size += g_child->children.size();
-            }
-        }
-        index_map.reserve(estimated_size);
-        
-        for (int g = 0; g < (int)tree->children.size(); g++) {
-            if (!tree->children[g] || tree->children[g]->children.empty()) continue;
-            
-            for (int k = 0; k < (int)tree->children[g]->children.size(); k++) {
-                if (!tree->children[g]->children[k]) continue;
-                
-                const auto& value = tree->children[g]->children[k]->value;
-                if (!value.empty()) {
-                    uint64_t key = make_key(k + 1, g + 1);
-                    // 🚀 emplace 사용해서 복사 방지
-                    index_map.emplace(key, value);
-                }
-            }
-        }
-    }
-    
-    const std::unordered_set<int>& query(int k, int g) const noexcept {
-        uint64_t key = make_key(k, g);
-        auto it = index_map.find(key);
-        return (it != index_map.end()) ? it->second : empty_set;
-    }
-    
-    bool exists(int k, int g) const noexcept {
-        uint64_t key = make_key(k, g);
-        return index_map.find(key) != index_map.end();
-    }
-    
-    size_t size() const noexcept { return index_map.size(); }
-    
-    void print_stats() const {
-        std::cout << "Fast Index Statistics:" << std::endl;
-        std::cout << "  Total entries: " << index_map.size() << std::endl;
-        std::cout << "  Load factor: " << index_map.load_factor() << std::endl;
-        std::cout << "  Bucket count: " << index_map.bucket_count() << std::endl;
-    }
-};
-
-
-// static 멤버 정의
-const std::unordered_set<int> FastNaiveIndex::empty_set;
-
-// 전역 인덱스
-static std::unique_ptr<FastNaiveIndex> g_fast_index;
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <malloc.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // ============================================================================
 // 기존 함수들
@@ -139,6 +82,240 @@ Hypergraph load_hypergraph(const std::string& file_path) {
     return hypergraph;
 }
 
+Hypergraph contract_twin_nodes(const Hypergraph& hypergraph) {
+    // 노드별 하이퍼엣지 인덱스 리스트 (E 순서대로 쌓이므로 이미 정렬됨)
+    std::unordered_map<int, std::vector<int>> incidence;
+    incidence.reserve(hypergraph.node_hyperedges.size());
+    for (int e = 0; e < (int)hypergraph.E.size(); e++) {
+        for (int node : hypergraph.E[e]) {
+            incidence[node].push_back(e);
+        }
+    }
+
+    // 결과를 결정적으로 만들기 위해 노드 ID 순으로 처리
+    std::vector<int> order;
+    order.reserve(incidence.size());
+    for (const auto& pair : incidence) {
+        order.push_back(pair.first);
+    }
+    std::sort(order.begin(), order.end());
+
+    // 인시던스 리스트 해시 -> 대표 노드들 (해시 충돌은 리스트 비교로 구분)
+    std::unordered_map<uint64_t, std::vector<int>> buckets;
+    std::unordered_map<int, int> representative;
+    std::unordered_map<int, std::vector<int>> groups;
+    representative.reserve(order.size());
+
+    for (int node : order) {
+        const auto& list = incidence[node];
+        uint64_t hash = 1469598103934665603ULL;  // FNV-1a
+        for (int e : list) {
+            hash ^= static_cast<uint64_t>(e);
+            hash *= 1099511628211ULL;
+        }
+
+        int rep = node;
+        auto& bucket = buckets[hash];
+        for (int candidate : bucket) {
+            if (incidence[candidate] == list) {
+                rep = candidate;
+                break;
+            }
+        }
+        if (rep == node) {
+            bucket.push_back(node);
+        }
+        representative[node] = rep;
+        auto twins_it = hypergraph.twins.find(node);
+        if (twins_it == hypergraph.twins.end()) {
+            groups[rep].push_back(hypergraph.original_id(node));
+        } else {
+            // 이미 축약된 그래프라면 기존 쌍둥이까지 함께 묶음
+            groups[rep].insert(groups[rep].end(), twins_it->second.begin(), twins_it->second.end());
+        }
+    }
+
+    Hypergraph contracted;
+    contracted.E.reserve(hypergraph.E.size());
+    for (const auto& hyperedge : hypergraph.E) {
+        std::unordered_set<int> mapped;
+        mapped.reserve(hyperedge.size());
+        for (int node : hyperedge) {
+            mapped.insert(representative[node]);
+        }
+        contracted.add_hyperedge(mapped);
+    }
+
+    for (auto& [rep, members] : groups) {
+        if (members.size() > 1) {
+            contracted.twins.emplace(rep, std::move(members));
+        }
+    }
+    contracted.original_ids = hypergraph.original_ids;
+
+    return compact_node_ids(contracted);
+}
+
+Hypergraph compact_node_ids(const Hypergraph& hypergraph) {
+    std::vector<int> order;
+    order.reserve(hypergraph.node_hyperedges.size());
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        order.push_back(pair.first);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::unordered_map<int, int> compact;
+    compact.reserve(order.size());
+    for (int i = 0; i < (int)order.size(); i++) {
+        compact[order[i]] = i;
+    }
+
+    Hypergraph compacted;
+    compacted.original_ids.resize(order.size());
+    for (int i = 0; i < (int)order.size(); i++) {
+        compacted.original_ids[i] = hypergraph.original_id(order[i]);
+    }
+
+    compacted.E.reserve(hypergraph.E.size());
+    for (const auto& hyperedge : hypergraph.E) {
+        std::unordered_set<int> mapped;
+        mapped.reserve(hyperedge.size());
+        for (int node : hyperedge) {
+            mapped.insert(compact[node]);
+        }
+        compacted.add_hyperedge(mapped);
+    }
+
+    for (const auto& [rep, members] : hypergraph.twins) {
+        compacted.twins.emplace(compact[rep], members);
+    }
+
+    return compacted;
+}
+
+BuildConfig g_build_config;
+
+static int find_root(std::vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];  // 경로 압축
+        x = parent[x];
+    }
+    return x;
+}
+
+ComponentPartition partition_by_components(const Hypergraph& hypergraph, int batch_nodes) {
+    ComponentPartition partition;
+    int num_edges = hypergraph.E.size();
+
+    // 하이퍼엣지 단위 union-find: 같은 노드를 공유하는 하이퍼엣지끼리 합침
+    std::vector<int> parent(num_edges);
+    for (int e = 0; e < num_edges; e++) parent[e] = e;
+
+    std::unordered_map<int, int> first_edge;
+    first_edge.reserve(hypergraph.node_hyperedges.size());
+    for (int e = 0; e < num_edges; e++) {
+        for (int node : hypergraph.E[e]) {
+            auto it = first_edge.find(node);
+            if (it == first_edge.end()) {
+                first_edge.emplace(node, e);
+            } else {
+                int a = find_root(parent, it->second);
+                int b = find_root(parent, e);
+                if (a != b) parent[std::max(a, b)] = std::min(a, b);
+            }
+        }
+    }
+
+    // 루트별 하이퍼엣지/노드 모으기
+    std::unordered_map<int, std::vector<int>> component_edges;
+    std::unordered_map<int, int> component_nodes;
+    for (int e = 0; e < num_edges; e++) {
+        component_edges[find_root(parent, e)].push_back(e);
+    }
+    for (const auto& [node, e] : first_edge) {
+        component_nodes[find_root(parent, e)] += hypergraph.weight(node);
+    }
+
+    // 큰 요소부터 (같은 크기면 루트 순서로 결정적으로)
+    std::vector<std::pair<int, int>> order;  // (노드 수, 루트)
+    order.reserve(component_edges.size());
+    for (const auto& pair : component_edges) {
+        order.emplace_back(component_nodes[pair.first], pair.first);
+    }
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+
+    partition.num_components = order.size();
+    partition.giant_component_nodes = order.empty() ? 0 : order[0].first;
+
+    // 큰 요소는 단독 파티션, 작은 요소들은 batch_nodes까지 한 파티션에 채움
+    // (서로 다른 요소끼리는 이웃이 없으므로 한 하이퍼그래프에 넣어도 결과가 같음)
+    int batch_fill = batch_nodes;
+    for (const auto& [size, root] : order) {
+        if (size >= batch_nodes || batch_fill + size > batch_nodes) {
+            partition.parts.emplace_back();
+            partition.parts.back().original_ids = hypergraph.original_ids;
+            batch_fill = 0;
+        }
+        Hypergraph& part = partition.parts.back();
+        batch_fill += size;
+        for (int e : component_edges[root]) {
+            part.add_hyperedge(hypergraph.E[e]);
+            for (int node : hypergraph.E[e]) {
+                auto it = hypergraph.twins.find(node);
+                if (it != hypergraph.twins.end()) {
+                    part.twins.emplace(node, it->second);
+                }
+            }
+        }
+    }
+
+    partition.exhausted_from = std::vector<std::atomic<int>>(partition.parts.size());
+    for (auto& from : partition.exhausted_from) {
+        from.store(INT_MAX);
+    }
+    return partition;
+}
+
+std::vector<std::unordered_set<int>> enumerate_by_components(ComponentPartition& partition, int g, bool shells) {
+    int num_parts = partition.parts.size();
+    std::vector<std::vector<std::unordered_set<int>>> results(num_parts);
+
+    // 파티션은 큰 것부터 정렬되어 있으므로 앞쪽 조각을 먼저 잡은 워커가 거대 요소부터 시작함
+    // (여러 g 레벨이 동시에 돌 수 있으므로 exhausted_from은 "g 이상이면 빈다"는 단조 조건으로만 씀)
+    task_runtime().parallel_for(0, num_parts, [&](int begin, int end) {
+        for (int p = begin; p < end; p++) {
+            if (partition.exhausted_from[p].load() <= g) continue;
+            results[p] = shells ? enumerate_1_g(partition.parts[p], g)
+                                : enumerate_kg_core_fixing_g(partition.parts[p], g);
+        }
+    }, 1);
+
+    // k 인덱스별 합집합 (요소마다 최대 k가 다르므로 가장 긴 것에 맞춤)
+    // shells 결과도 S[i] = (i+1)-core \ (i+2)-core 이므로 같은 방식으로 합쳐짐
+    std::vector<std::unordered_set<int>> S;
+    for (int p = 0; p < num_parts; p++) {
+        if (results[p].empty()) {
+            int from = partition.exhausted_from[p].load();
+            while (g < from && !partition.exhausted_from[p].compare_exchange_weak(from, g)) {}
+            continue;
+        }
+        if (results[p].size() > S.size()) {
+            S.resize(results[p].size());
+        }
+        for (int i = 0; i < (int)results[p].size(); i++) {
+            if (S[i].empty()) {
+                S[i] = std::move(results[p][i]);
+            } else {
+                S[i].insert(results[p][i].begin(), results[p][i].end());
+            }
+        }
+    }
+
+    return S;
+}
+
 std::unordered_map<int, int> neighbour_count_map(const Hypergraph& hypergraph, int v, int g) {
     std::unordered_map<int, int> neighbor_counts;
     
@@ -203,136 +380,34 @@ std::unordered_set<int> find_kg_core(const Hypergraph& hypergraph, int k, int g)
         for (int v : nodes) {
             auto map = neighbour_count_map(hypergraph, v, g);
             
-            std::unordered_map<int, int> filtered_map;
+            int valid_neighbors = hypergraph.twin_neighbors(v, g);
             for (const auto& pair : map) {
                 if (nodes.find(pair.first) != nodes.end()) {
-                    filtered_map[pair.first] = pair.second;
+                    valid_neighbors += hypergraph.weight(pair.first);
                 }
             }
             
-            if ((int)filtered_map.size() < k) {
+            if (valid_neighbors < k) {
                 changed = true;
                 H.erase(v);
             }
         }
     }
     
-    return H;
-}
-
-std::unordered_set<int> kg_core(const Hypergraph& hypergraph, int k, int g) {
-    return find_kg_core(hypergraph, k, g);
-}
-
-std::vector<std::unordered_set<int>> enumerate_kg_core_fixing_g(const Hypergraph& hypergraph, int g) {
-    // 최대 노드 ID 찾기
-    int max_node = 0;
-    for (int node : hypergraph.nodes()) {
-        max_node = std::max(max_node, node);
-    }
-    
-    // 비트맵으로 메모리 최적화: 320MB -> 20MB
-    std::vector<bool> H(max_node + 1, false);
-    std::vector<bool> T(max_node + 1, false);
-    
-    // 초기 활성 노드 설정
-    for (int node : hypergraph.nodes()) {
-        H[node] = true;
+    if (hypergraph.twins.empty()) {
+        return H;
     }
     
-    std::vector<std::unordered_set<int>> S;
-    int active_count = hypergraph.nodes().size();
-    
-    for (int k = 1; k < active_count; k++) {
-        if (active_count <= k) break;
-        
-        while (true) {
-            if (active_count <= k) break;
-            
-            bool changed = false;
-            std::vector<int> nodes_to_remove;
-            std::vector<int> nodes_to_add_to_T;
-            
-            // T가 비어있는지 확인 (효율적인 방식)
-            bool T_empty = true;
-            for (int i = 0; i <= max_node && T_empty; i++) {
-                if (T[i]) T_empty = false;
-            }
-            
-            if (T_empty) {
-                // 모든 활성 노드에 대해 처리
-                for (int v = 0; v <= max_node; v++) {
-                    if (!H[v]) continue;
-                    
-                    T[v] = false;  // T에서 v 제거
-                    
-                    // 이웃 카운트 계산 (비트맵 활용)
-                    int valid_neighbors = count_valid_neighbors_with_bitmap(hypergraph, v, g, H, max_node);
-                    
-                    if (valid_neighbors < k) {
-                        nodes_to_remove.push_back(v);
-                        changed = true;
-                        
-                        // 이웃들을 T에 추가할 목록에 추가
-                        add_neighbors_to_T_list(hypergraph, v, nodes_to_add_to_T, max_node);
-                    }
-                }
-            } else {
-                // T와 H의 교집합에 대해서만 처리
-                for (int v = 0; v <= max_node; v++) {
-                    if (!H[v] || !T[v]) continue;
-                    
-                    T[v] = false;  // T에서 v 제거
-                    
-                    int valid_neighbors = count_valid_neighbors_with_bitmap(hypergraph, v, g, H, max_node);
-                    
-                    if (valid_neighbors < k) {
-                        nodes_to_remove.push_back(v);
-                        changed = true;
-                        
-                        add_neighbors_to_T_list(hypergraph, v, nodes_to_add_to_T, max_node);
-                    }
-                }
-            }
-            
-            // 배치로 노드 제거
-            for (int v : nodes_to_remove) {
-                H[v] = false;
-                active_count--;
-            }
-            
-            // 배치로 T 업데이트
-            for (int neighbor : nodes_to_add_to_T) {
-                if (neighbor <= max_node) {
-                    T[neighbor] = true;
-                }
-            }
-            
-            if (!changed) {
-                // 현재 활성 노드들을 결과에 추가
-                std::unordered_set<int> current_core;
-                current_core.reserve(active_count);
-                
-                for (int i = 0; i <= max_node; i++) {
-                    if (H[i]) {
-                        current_core.insert(i);
-                    }
-                }
-                
-                if (!current_core.empty()) {
-                    S.push_back(std::move(current_core));
-                }
-                
-                // T 비우기
-                std::fill(T.begin(), T.end(), false);
-                break;
-            }
-        }
+    std::unordered_set<int> expanded;
+    for (int v : H) {
+        hypergraph.expand_into(v, expanded);
     }
-    
-    return S;
+    return expanded;
 }
 
+std::unordered_set<int> kg_core(const Hypergraph& hypergraph, int k, int g) {
+    return find_kg_core(hypergraph, k, g);
+}
 
 int count_valid_neighbors_with_bitmap(const Hypergraph& hypergraph, int v, int g, 
                                      const std::vector<bool>& active_nodes, int max_node) {
@@ -353,17 +428,156 @@ int count_valid_neighbors_with_bitmap(const Hypergraph& hypergraph, int v, int g
         }
     }
     
-    // g 이상인 이웃만 카운트
-    int valid_count = 0;
+    // g 이상인 이웃만 카운트 (쌍둥이 대표 노드는 가중치만큼)
+    int valid_count = hypergraph.twin_neighbors(v, g);
     for (const auto& [neighbor, count] : neighbor_counts) {
         if (count >= g) {
-            valid_count++;
+            valid_count += hypergraph.weight(neighbor);
         }
     }
     
     return valid_count;
 }
 
+// 스레드별 밀집 카운터: 노드 ID로 바로 인덱싱하고, 건드린 칸만 기록해 O(touched)로 리셋
+// epoch 모드에서는 칸마다 stamp를 두어 리셋 자체를 생략 (epoch가 한 바퀴 돌 때만 전체 초기화)
+class NeighborCountScratch {
+public:
+    static constexpr uint16_t kSaturated = UINT16_MAX;
+
+    void ensure(int max_node) {
+        if ((int)counts.size() <= max_node) {
+            counts.resize(max_node + 1, 0);
+            stamps.resize(max_node + 1, 0);
+        }
+    }
+
+    // epoch 모드는 카운터를 지우지 않으므로, 리셋 모드로 넘어갈 때 한 번 전체 초기화
+    template <bool UseEpoch>
+    void begin() {
+        if (!UseEpoch && stale) {
+            std::fill(counts.begin(), counts.end(), 0);
+            stale = false;
+        }
+        stale |= UseEpoch;
+    }
+
+    template <bool UseEpoch>
+    void add(int node) {
+        uint16_t& c = counts[node];
+        if (UseEpoch) {
+            if (stamps[node] != epoch) {
+                stamps[node] = epoch;
+                c = 0;
+                touched.push_back(node);
+            }
+        } else if (c == 0) {
+            touched.push_back(node);
+        }
+        c += (c != kSaturated);  // 포화 덧셈 (g 비교에만 쓰므로 상한이면 충분)
+    }
+
+    // count >= g 인 칸의 수를 세고 카운터를 비움
+    template <bool UseEpoch>
+    int tally(int g) {
+        int n = touched.size();
+        gathered.resize(n);
+        for (int i = 0; i < n; i++) {
+            gathered[i] = counts[touched[i]];
+            if (!UseEpoch) counts[touched[i]] = 0;
+        }
+        int valid = count_at_least(gathered.data(), n, g);
+        finish<UseEpoch>();
+        return valid;
+    }
+
+    // 쌍둥이 축약 그래프용: count >= g 인 이웃의 가중치 합
+    template <bool UseEpoch>
+    int tally_weighted(const Hypergraph& hypergraph, int g) {
+        int valid = 0;
+        for (int node : touched) {
+            if (counts[node] >= g) valid += hypergraph.weight(node);
+            if (!UseEpoch) counts[node] = 0;
+        }
+        finish<UseEpoch>();
+        return valid;
+    }
+
+private:
+    std::vector<uint16_t> counts;
+    std::vector<uint32_t> stamps;
+    std::vector<int> touched;
+    std::vector<uint16_t> gathered;
+    uint32_t epoch = 1;
+    bool stale = false;
+
+    template <bool UseEpoch>
+    void finish() {
+        touched.clear();
+        if (UseEpoch && ++epoch == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    // count >= g  <=>  sat_sub(g, count) == 0 (SSE2의 부호 없는 포화 뺄셈으로 8개씩 비교)
+    static int count_at_least(const uint16_t* values, int n, int g) {
+        int valid = 0;
+        int i = 0;
+#if defined(__SSE2__)
+        const __m128i threshold = _mm_set1_epi16(static_cast<short>(g));
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+            __m128i ge = _mm_cmpeq_epi16(_mm_subs_epu16(threshold, v), zero);
+            valid += __builtin_popcount(_mm_movemask_epi8(ge)) / 2;
+        }
+#endif
+        for (; i < n; i++) {
+            valid += values[i] >= g;
+        }
+        return valid;
+    }
+};
+
+static thread_local NeighborCountScratch t_count_scratch;
+
+template <bool UseEpoch, typename ActiveSet>
+static int count_valid_neighbors_dense_impl(const Hypergraph& hypergraph, int v, int g,
+                                            const ActiveSet& active_nodes, int max_node) {
+    auto& scratch = t_count_scratch;
+    scratch.ensure(max_node);
+    scratch.begin<UseEpoch>();
+
+    for (const auto& hyperedge : hypergraph.node_hyperedges.at(v)) {
+        for (int neighbor : hyperedge) {
+            if (neighbor != v && neighbor <= max_node && active_nodes[neighbor]) {
+                scratch.add<UseEpoch>(neighbor);
+            }
+        }
+    }
+
+    if (hypergraph.twins.empty()) {
+        return scratch.tally<UseEpoch>(g);
+    }
+    return hypergraph.twin_neighbors(v, g) + scratch.tally_weighted<UseEpoch>(hypergraph, g);
+}
+
+int count_valid_neighbors_dense(const Hypergraph& hypergraph, int v, int g,
+                                const std::vector<bool>& active_nodes, int max_node, bool use_epoch) {
+    if (!hypergraph.has_node(v)) {
+        return 0;
+    }
+
+    // 16비트 포화 카운터로 구분할 수 없는 g는 해시맵 버전으로
+    if (g >= NeighborCountScratch::kSaturated) {
+        return count_valid_neighbors_with_bitmap(hypergraph, v, g, active_nodes, max_node);
+    }
+
+    return use_epoch ? count_valid_neighbors_dense_impl<true>(hypergraph, v, g, active_nodes, max_node)
+                     : count_valid_neighbors_dense_impl<false>(hypergraph, v, g, active_nodes, max_node);
+}
+
 // T에 추가할 이웃들을 리스트에 수집
 void add_neighbors_to_T_list(const Hypergraph& hypergraph, int v, 
                             std::vector<int>& nodes_to_add, int max_node) {
@@ -380,145 +594,869 @@ void add_neighbors_to_T_list(const Hypergraph& hypergraph, int v,
     }
 }
 
-std::shared_ptr<TreeNode> naive_index_construction(
-    const Hypergraph& hypergraph, 
-    const std::vector<std::unordered_set<int>>& E) {
-    
-    auto T = std::make_shared<TreeNode>("root");
-    T->children.reserve(E.size());  // 메모리 예약
-    
-    std::cout << "🔧 Naive: Processing g-values (Bitmap Optimized)..." << std::endl;
-    
-    for (int g = 1; g < static_cast<int>(E.size()); g++) {
-        std::cout << "   g=" << g << ": Computing cores..." << std::flush;
-        
-        auto S = enumerate_kg_core_fixing_g(hypergraph, g);
-        
-        if (S.empty()) {
-            std::cout << " no cores found, stopping at g=" << (g-1) << std::endl;
-            break;
+// ============================================================================
+// 작은 g 전용 커널 (g=1: 비트셋 + popcount, g=2/3: 8비트 포화 카운터, 그 외: 16비트 밀집 카운터)
+// ============================================================================
+
+// 64비트 워드 단위 노드 비트셋 (g=1에서 활성 집합과 워드 단위 AND + popcount)
+struct NodeBits {
+    std::vector<uint64_t> words;
+
+    explicit NodeBits(int max_node = 0) : words(max_node / 64 + 1, 0) {}
+
+    bool operator[](int n) const { return (words[n >> 6] >> (n & 63)) & 1; }
+    void set(int n) { words[n >> 6] |= uint64_t(1) << (n & 63); }
+    void reset(int n) { words[n >> 6] &= ~(uint64_t(1) << (n & 63)); }
+    bool none() const {
+        for (uint64_t w : words) {
+            if (w) return false;
         }
-        
-        std::cout << " found " << S.size() << " cores" << std::endl;
-        
-        auto g_node = std::make_shared<TreeNode>("");
-        g_node->children.reserve(S.size());
-        
-        for (auto& core : S) {
-            auto leaf_node = std::make_shared<TreeNode>("");
-            leaf_node->value = std::move(core);
-            g_node->children.push_back(std::move(leaf_node));
+        return true;
+    }
+    void clear() { std::fill(words.begin(), words.end(), 0); }
+    // other의 비트를 합치고 other는 비움
+    void absorb(NodeBits& other) {
+        for (size_t i = 0; i < words.size(); i++) {
+            words[i] |= other.words[i];
+            other.words[i] = 0;
         }
-        
-        T->children.push_back(std::move(g_node));
     }
-    
-    std::cout << "✅ Naive: Completed with " << T->children.size() << " g-levels" << std::endl;
-    
-    // FastNaiveIndex 생성
-    std::cout << "🚀 Naive: Creating fast index..." << std::endl;
-    g_fast_index = std::make_unique<FastNaiveIndex>(T);
-    std::cout << "✅ Naive: Fast index ready!" << std::endl;
-    g_fast_index->print_stats();
-    
-    return T;
-}
+};
 
-const std::unordered_set<int>& querying_for_naive_index(
-    const std::shared_ptr<TreeNode>& tree, int k, int g) {
-    
-    // 🚀 빠른 인덱스가 있으면 사용
-    if (g_fast_index) {
-        return g_fast_index->query(k, g);
+// v의 이웃들을 marked에 표시 (peeling의 다음 확인 대상, 목록 대신 비트라 중복이 쌓이지 않음)
+static void mark_neighbors(const Hypergraph& hypergraph, int v, NodeBits& marked, int max_node) {
+    for (const auto& hyperedge : hypergraph.node_hyperedges.at(v)) {
+        for (int neighbor : hyperedge) {
+            if (neighbor != v && neighbor <= max_node) marked.set(neighbor);
+        }
     }
-    
-    // fallback: 기존 방식
-    static const std::unordered_set<int> empty_result;
-    
-    if (!tree || tree->children.empty()) return empty_result;
-    
-    const int g_idx = g - 1;
-    const int k_idx = k - 1;
-    
-    if (g_idx < 0 || g_idx >= (int)tree->children.size()) return empty_result;
-    if (k_idx < 0 || k_idx >= (int)tree->children[g_idx]->children.size()) return empty_result;
-    
-    return tree->children[g_idx]->children[k_idx]->value;
 }
 
-// ============================================================================
-// 나머지 함수들
-// ============================================================================
+// g=1: 공유 하이퍼엣지 수와 관계없이 이웃 존재 여부만 필요
+class NeighborBitScratch {
+public:
+    void ensure(int max_node) {
+        size_t num_words = max_node / 64 + 1;
+        if (bits.size() < num_words) bits.resize(num_words, 0);
+    }
 
-std::vector<std::unordered_set<int>> enumerate_1_g(const Hypergraph& hypergraph, int g) {
-    std::unordered_set<int> H = hypergraph.nodes();
-    std::vector<std::unordered_set<int>> S;
-    std::unordered_set<int> T;
-    std::unordered_set<int> temp;
-    
-    for (int k = 1; k < (int)hypergraph.nodes().size(); k++) {
-        if ((int)H.size() <= k) {
-            break;
+    void add(int node) {
+        uint64_t& w = bits[node >> 6];
+        if (w == 0) touched_words.push_back(node >> 6);
+        w |= uint64_t(1) << (node & 63);
+    }
+
+    int tally(const NodeBits& active) {
+        int valid = 0;
+        for (int w : touched_words) {
+            valid += __builtin_popcountll(bits[w] & active.words[w]);
+            bits[w] = 0;
         }
-        
-        while (true) {
-            if ((int)H.size() <= k) {
-                break;
+        touched_words.clear();
+        return valid;
+    }
+
+    int tally_weighted(const Hypergraph& hypergraph, const NodeBits& active) {
+        int valid = 0;
+        for (int w : touched_words) {
+            uint64_t live = bits[w] & active.words[w];
+            while (live) {
+                valid += hypergraph.weight(w * 64 + __builtin_ctzll(live));
+                live &= live - 1;
             }
-            
-            bool changed = false;
-            std::unordered_set<int> nodes = H;
-            
-            if (!T.empty()) {
-                std::unordered_set<int> intersection;
-                for (int node : nodes) {
-                    if (T.find(node) != T.end()) {
-                        intersection.insert(node);
-                    }
+            bits[w] = 0;
+        }
+        touched_words.clear();
+        return valid;
+    }
+
+private:
+    std::vector<uint64_t> bits;
+    std::vector<int> touched_words;
+};
+
+// g=2/3: G에서 포화하는 8비트 카운터 (count >= G 는 count == G)
+template <int G>
+class SmallCountScratch {
+public:
+    void ensure(int max_node) {
+        if ((int)counts.size() <= max_node) counts.resize(max_node + 1, 0);
+    }
+
+    void add(int node) {
+        uint8_t& c = counts[node];
+        if (c == 0) touched.push_back(node);
+        c += (c < G);
+    }
+
+    int tally() {
+        int n = touched.size();
+        gathered.resize(n);
+        for (int i = 0; i < n; i++) {
+            gathered[i] = counts[touched[i]];
+            counts[touched[i]] = 0;
+        }
+        touched.clear();
+
+        int valid = 0;
+        int i = 0;
+#if defined(__SSE2__)
+        const __m128i target = _mm_set1_epi8(G);
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gathered.data() + i));
+            valid += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, target)));
+        }
+#endif
+        for (; i < n; i++) {
+            valid += gathered[i] == G;
+        }
+        return valid;
+    }
+
+    int tally_weighted(const Hypergraph& hypergraph) {
+        int valid = 0;
+        for (int node : touched) {
+            if (counts[node] == G) valid += hypergraph.weight(node);
+            counts[node] = 0;
+        }
+        touched.clear();
+        return valid;
+    }
+
+private:
+    std::vector<uint8_t> counts;
+    std::vector<int> touched;
+    std::vector<uint8_t> gathered;
+};
+
+static thread_local NeighborBitScratch t_bit_scratch;
+
+template <int G>
+static SmallCountScratch<G>& small_count_scratch() {
+    static thread_local SmallCountScratch<G> scratch;
+    return scratch;
+}
+
+// G = 1, 2, 3은 컴파일 타임 특수화, G = 0은 런타임 g
+template <int G>
+static int count_valid_neighbors_fixed(const Hypergraph& hypergraph, int v, int g,
+                                       const NodeBits& active, int max_node) {
+    if constexpr (G == 0) {
+        if (g < NeighborCountScratch::kSaturated) {
+            return count_valid_neighbors_dense_impl<false>(hypergraph, v, g, active, max_node);
+        }
+        // 16비트 포화 카운터로 구분할 수 없는 g
+        std::unordered_map<int, int> neighbor_counts;
+        for (const auto& hyperedge : hypergraph.node_hyperedges.at(v)) {
+            for (int neighbor : hyperedge) {
+                if (neighbor != v && neighbor <= max_node && active[neighbor]) {
+                    neighbor_counts[neighbor]++;
                 }
-                nodes = intersection;
             }
-            
-            for (int v : nodes) {
-                T.erase(v);
-                
-                auto map = neighbour_count_map(hypergraph, v, g);
-                
-                std::unordered_map<int, int> filtered_map;
-                for (const auto& pair : map) {
-                    if (nodes.find(pair.first) != nodes.end()) {
-                        filtered_map[pair.first] = pair.second;
-                    }
+        }
+        int valid_count = hypergraph.twin_neighbors(v, g);
+        for (const auto& [neighbor, count] : neighbor_counts) {
+            if (count >= g) valid_count += hypergraph.weight(neighbor);
+        }
+        return valid_count;
+    } else if constexpr (G == 1) {
+        // 비활성 노드는 popcount 단계에서 활성 워드와 AND로 걸러냄
+        auto& scratch = t_bit_scratch;
+        scratch.ensure(max_node);
+        for (const auto& hyperedge : hypergraph.node_hyperedges.at(v)) {
+            for (int neighbor : hyperedge) {
+                if (neighbor != v && neighbor <= max_node) {
+                    scratch.add(neighbor);
                 }
-                
-                if ((int)filtered_map.size() < k) {
-                    H.erase(v);
-                    changed = true;
+            }
+        }
+        if (hypergraph.twins.empty()) return scratch.tally(active);
+        return hypergraph.twin_neighbors(v, 1) + scratch.tally_weighted(hypergraph, active);
+    } else {
+        auto& scratch = small_count_scratch<G>();
+        scratch.ensure(max_node);
+        for (const auto& hyperedge : hypergraph.node_hyperedges.at(v)) {
+            for (int neighbor : hyperedge) {
+                if (neighbor != v && neighbor <= max_node && active[neighbor]) {
+                    scratch.add(neighbor);
                 }
             }
-            
-            if (!changed) {
-                if (!temp.empty()) {
-                    std::unordered_set<int> difference;
-                    for (int node : temp) {
-                        if (H.find(node) == H.end()) {
-                            difference.insert(node);
-                        }
-                    }
-                    S.push_back(difference);
-                    T.clear();
+        }
+        if (hypergraph.twins.empty()) return scratch.tally();
+        return hypergraph.twin_neighbors(v, G) + scratch.tally_weighted(hypergraph);
+    }
+}
+
+long long sum_valid_neighbors_small_g(const Hypergraph& hypergraph, const std::vector<int>& nodes, int g, int rounds) {
+    int max_node = 0;
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        max_node = std::max(max_node, pair.first);
+    }
+    NodeBits active(max_node);
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        active.set(pair.first);
+    }
+
+    long long total = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int v : nodes) {
+            switch (g) {
+                case 1: total += count_valid_neighbors_fixed<1>(hypergraph, v, g, active, max_node); break;
+                case 2: total += count_valid_neighbors_fixed<2>(hypergraph, v, g, active, max_node); break;
+                case 3: total += count_valid_neighbors_fixed<3>(hypergraph, v, g, active, max_node); break;
+                default: total += count_valid_neighbors_fixed<0>(hypergraph, v, g, active, max_node); break;
+            }
+        }
+    }
+    return total;
+}
+
+// 고정된 g에서 k를 1씩 올리며 peeling, 각 노드의 core number(속한 가장 큰 k, 없으면 0)를 기록
+// k 단계에서 제거된 노드는 (k-1, g)-core까지만 속함
+template <int G>
+static std::vector<int> peel_core_numbers(const Hypergraph& hypergraph, int g, int max_node) {
+    std::vector<int> core_number(max_node + 1, 0);
+
+    NodeBits H(max_node);
+    NodeBits T(max_node);
+    NodeBits marked(max_node);   // 이번 배치에서 제거된 노드의 이웃 (배치가 끝난 뒤 T에 합침)
+    std::vector<int> active_list;
+    active_list.reserve(hypergraph.node_hyperedges.size());
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        H.set(pair.first);
+        active_list.push_back(pair.first);
+    }
+    std::sort(active_list.begin(), active_list.end());
+
+    // 쌍둥이 축약 그래프에서는 원본 노드 수(가중치 합) 기준
+    int active_count = hypergraph.total_weight();
+    bool T_empty = true;
+    int last_stable_k = 0;
+
+    for (int k = 1; k < active_count; k++) {
+        while (true) {
+            if (active_count <= k) break;
+
+            std::vector<int> nodes_to_remove;
+
+            // T가 비어 있으면 모든 활성 노드, 아니면 T에 든 활성 노드만 다시 확인
+            for (int v : active_list) {
+                if (!T_empty && !T[v]) continue;
+                T.reset(v);
+
+                int valid_neighbors = count_valid_neighbors_fixed<G>(hypergraph, v, g, H, max_node);
+                if (valid_neighbors < k) {
+                    nodes_to_remove.push_back(v);
+                    mark_neighbors(hypergraph, v, marked, max_node);
                 }
-                temp = H;
+            }
+
+            if (nodes_to_remove.empty()) {
+                // (k,g)-core 안정화: 다음 k는 전체 활성 노드부터
+                last_stable_k = k;
+                T.clear();
+                T_empty = true;
                 break;
             }
+
+            // 배치로 노드 제거
+            for (int v : nodes_to_remove) {
+                H.reset(v);
+                core_number[v] = k - 1;
+                active_count -= hypergraph.weight(v);
+            }
+            active_list.erase(std::remove_if(active_list.begin(), active_list.end(),
+                                             [&](int v) { return !H[v]; }),
+                              active_list.end());
+
+            // 배치로 T 업데이트
+            T.absorb(marked);
+            T_empty = T.none();
+        }
+    }
+
+    // 남은 노드 수가 k 이하가 되면 (k,g)-core는 비므로, 남은 노드는 마지막으로 안정화된 core까지만 속함
+    for (int v : active_list) {
+        core_number[v] = last_stable_k;
+    }
+
+    return core_number;
+}
+
+// g별 특수화 선택 (레벨마다 호출되므로 자주 다시 만드는 작은 g 레벨이 가장 빠른 경로를 탐)
+static std::vector<int> core_numbers_fixing_g(const Hypergraph& hypergraph, int g, int max_node) {
+    switch (g) {
+        case 1: return peel_core_numbers<1>(hypergraph, g, max_node);
+        case 2: return peel_core_numbers<2>(hypergraph, g, max_node);
+        case 3: return peel_core_numbers<3>(hypergraph, g, max_node);
+        default: return peel_core_numbers<0>(hypergraph, g, max_node);
+    }
+}
+
+// core number별로 (원본 노드로 펼친) 노드 묶기: buckets[k-1] = core number가 정확히 k인 노드들
+// enumerate_kg_core_fixing_g와 enumerate_1_g 둘 다 이 한 번의 peeling에서 나옴:
+//   shell은 core number가 k인 노드들, (k,g)-core는 큰 k부터 shell을 누적한 것
+//   (예전에는 core 쪽이 k마다 안정된 활성 노드 전체를 다시 펼쳐 담았고, shell 쪽은 해시 집합으로 따로 peeling했음)
+static std::vector<std::unordered_set<int>> shells_fixing_g(const Hypergraph& hypergraph, int g) {
+    int max_node = 0;
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        max_node = std::max(max_node, pair.first);
+    }
+
+    auto core_number = core_numbers_fixing_g(hypergraph, g, max_node);
+
+    int max_k = 0;
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        max_k = std::max(max_k, core_number[pair.first]);
+    }
+
+    std::vector<std::unordered_set<int>> shells(max_k);
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        int c = core_number[pair.first];
+        if (c > 0) {
+            hypergraph.expand_into(pair.first, shells[c - 1]);
+        }
+    }
+    return shells;
+}
+
+std::vector<std::unordered_set<int>> enumerate_kg_core_fixing_g(const Hypergraph& hypergraph, int g) {
+    // (k,g)-core = core number가 k 이상인 노드들 → 큰 k부터 shell을 누적
+    auto S = shells_fixing_g(hypergraph, g);
+    for (int i = (int)S.size() - 2; i >= 0; i--) {
+        S[i].insert(S[i + 1].begin(), S[i + 1].end());
+    }
+    return S;
+}
+
+// 설정에 따라 연결 요소 파티션 준비 (요소가 하나뿐이면 원본 그대로 쓰도록 빈 파티션 반환)
+static ComponentPartition prepare_component_partition(const Hypergraph& hypergraph) {
+    if (!g_build_config.partition_components) {
+        return ComponentPartition();
+    }
+    
+    auto partition = partition_by_components(hypergraph, g_build_config.component_batch_nodes);
+    std::cout << "   🧩 Components: " << partition.num_components << " (giant: " << partition.giant_component_nodes
+              << " nodes) → " << partition.parts.size() << " partitions" << std::endl;
+    
+    if (partition.parts.size() <= 1) {
+        return ComponentPartition();
+    }
+    return partition;
+}
+
+// ============================================================================
+// 메모리 예산 구성 (--memory-budget)
+// ============================================================================
+//
+// 예산이 있으면 g 레벨마다 peeling 결과(core number)에서 shell들을 바로 임시 파일로 흘려 보내고
+// 레벨 집합은 consume 차례가 왔을 때 그 레벨 하나만 다시 만듦
+// 동시에 peeling하는 레벨 수는 묶음마다 (예산 - 현재 RSS) / 레벨 하나의 peeling 상태로 정함
+// 레벨 하나의 peeling도, consume할 레벨 하나의 집합도 남은 예산에 들어가지 않으면 예외로 멈춤
+// 파일: [집합 수 u32] shell마다 [인코딩 길이 u32][DeltaVarint 인코딩]
+
+// 추정치 (바이트): peeling은 노드 ID 칸마다 core number/활성 목록/비트셋/스레드 카운터,
+// 흘려 보내기는 펼친 노드마다 (core number, ID) 쌍과 정렬/인코딩 버퍼, 되살린 집합은 unordered_set 원소 하나
+constexpr size_t kPeelBytesPerNodeId = 32;
+constexpr size_t kSpillBytesPerNode = 24;
+constexpr size_t kSetBytesPerElement = 48;
+
+static std::string spill_path(int g) {
+    std::string dir = g_build_config.spill_dir.empty() ? "/tmp" : g_build_config.spill_dir;
+    return dir + "/kg_spill_" + std::to_string(getpid()) + "_" + std::to_string(g) + ".tmp";
+}
+
+// 레벨 하나를 peeling해서 파일로 흘려 보내는 동안의 메모리 (KB)
+static size_t level_peel_kb(const Hypergraph& hypergraph) {
+    int max_node = 0;
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        max_node = std::max(max_node, pair.first);
+    }
+    size_t bytes = (size_t)(max_node + 1) * kPeelBytesPerNodeId + (size_t)hypergraph.total_weight() * kSpillBytesPerNode;
+    return bytes / 1024 + 1;
+}
+
+// (core number, 원본 노드 ID) 쌍을 out에 추가 (core number가 0인 노드는 빠짐)
+static void append_core_numbers(const Hypergraph& hypergraph, int g, std::vector<std::pair<int, int>>& out) {
+    int max_node = 0;
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        max_node = std::max(max_node, pair.first);
+    }
+    auto core_number = core_numbers_fixing_g(hypergraph, g, max_node);
+    for (const auto& pair : hypergraph.node_hyperedges) {
+        int c = core_number[pair.first];
+        if (c == 0) continue;
+        auto it = hypergraph.twins.find(pair.first);
+        if (it == hypergraph.twins.end()) {
+            out.emplace_back(c, hypergraph.original_id(pair.first));
+        } else {
+            for (int node : it->second) out.emplace_back(c, node);
+        }
+    }
+}
+
+// g 레벨을 peeling하고 shell들을 path에 씀, 반환값은 되살릴 때의 원소 수 (cores면 core 크기의 합)
+// 파티션이 있으면 요소들을 차례로 peeling (동시에 도는 peeling 수가 묶음 크기를 넘지 않도록)
+static size_t spill_level(const Hypergraph& hypergraph, ComponentPartition& partition, int g, bool shells,
+                          const std::string& path) {
+    std::vector<std::pair<int, int>> numbers;
+    if (partition.parts.empty()) {
+        append_core_numbers(hypergraph, g, numbers);
+    } else {
+        for (size_t p = 0; p < partition.parts.size(); p++) {
+            if (partition.exhausted_from[p].load() <= g) continue;
+            size_t before = numbers.size();
+            append_core_numbers(partition.parts[p], g, numbers);
+            if (numbers.size() == before) {
+                int from = partition.exhausted_from[p].load();
+                while (g < from && !partition.exhausted_from[p].compare_exchange_weak(from, g)) {}
+            }
         }
     }
+    std::sort(numbers.begin(), numbers.end());
     
-    if (!temp.empty()) {
-        S.push_back(temp);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    uint32_t count = numbers.empty() ? 0 : numbers.back().first;
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    
+    // core number 순으로 정렬했으므로 shell k는 연속 구간이고 그 안은 ID 순
+    size_t elements = 0;
+    std::vector<int> shell;
+    std::vector<uint8_t> encoded;
+    size_t i = 0;
+    for (uint32_t k = 1; k <= count; k++) {
+        shell.clear();
+        for (; i < numbers.size() && numbers[i].first == (int)k; i++) shell.push_back(numbers[i].second);
+        elements += shells ? shell.size() : shell.size() * k;
+        encoded.clear();
+        encode_sorted_set(shell.data(), shell.data() + shell.size(), SetCodec::DeltaVarint, encoded);
+        uint32_t bytes = encoded.size();
+        out.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+        out.write(reinterpret_cast<const char*>(encoded.data()), bytes);
+    }
+    out.close();
+    if (!out) {
+        std::remove(path.c_str());
+        throw std::runtime_error("cannot write spilled level " + path);
     }
+    return elements;
+}
+
+// shells=false면 큰 k부터 shell을 누적해 core로 되살림 (enumerate_kg_core_fixing_g와 같은 결과)
+static std::vector<std::unordered_set<int>> restore_level(const std::string& path, bool shells) {
+    std::ifstream in(path, std::ios::binary);
+    uint32_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
     
-    return S;
+    std::vector<std::unordered_set<int>> level(count);
+    std::vector<uint8_t> encoded;
+    for (auto& set : level) {
+        uint32_t bytes = 0;
+        in.read(reinterpret_cast<char*>(&bytes), sizeof(bytes));
+        encoded.resize(bytes);
+        in.read(reinterpret_cast<char*>(encoded.data()), bytes);
+        if (!in) break;
+        set.reserve(encoded_set_size(encoded.data()));
+        decode_sorted_set(encoded.data(), set);
+    }
+    bool ok = (bool)in;
+    in.close();
+    std::remove(path.c_str());
+    if (!ok) throw std::runtime_error("cannot read spilled level " + path);
+    
+    if (!shells) {
+        for (int i = (int)level.size() - 2; i >= 0; i--) {
+            level[i].insert(level[i + 1].begin(), level[i + 1].end());
+        }
+    }
+    return level;
+}
+
+// 남은 예산에 들어가는 동시 peeling 레벨 수 (하나도 안 들어가면 예외)
+static int budget_wave(size_t peel_kb, int workers, int g) {
+    size_t budget_kb = g_build_config.memory_budget_kb;
+    size_t rss_kb = get_memory_usage_kb();
+    size_t room_kb = budget_kb > rss_kb ? budget_kb - rss_kb : 0;
+    size_t wave = std::min<size_t>(workers, room_kb / peel_kb);
+    if (wave == 0) {
+        throw std::runtime_error("memory budget of " + std::to_string(budget_kb) + " KB exceeded: peeling g=" +
+                                 std::to_string(g) + " needs about " + std::to_string(peel_kb) + " KB on top of " +
+                                 std::to_string(rss_kb) + " KB RSS");
+    }
+    return wave;
+}
+
+// consume 차례가 온 레벨을 되살리기 전: 그 레벨의 집합이 남은 예산에 들어가는지 확인
+static void check_restore_fits(size_t elements, int g) {
+    size_t budget_kb = g_build_config.memory_budget_kb;
+    size_t rss_kb = get_memory_usage_kb();
+    size_t level_kb = elements * kSetBytesPerElement / 1024;
+    if (rss_kb + level_kb > budget_kb) {
+        throw std::runtime_error("memory budget of " + std::to_string(budget_kb) + " KB exceeded: level g=" +
+                                 std::to_string(g) + " holds " + std::to_string(elements) + " node entries (about " +
+                                 std::to_string(level_kb) + " KB) on top of " + std::to_string(rss_kb) + " KB RSS");
+    }
+}
+
+// 설정에 체크포인트 디렉터리가 있으면 name.ckpt를 열고 (resume이면 같은 하이퍼그래프의 기록을 이어서) true
+static bool open_level_checkpoint(const Hypergraph& hypergraph, const char* name, LevelCheckpoint& checkpoint) {
+    if (g_build_config.checkpoint_dir.empty()) return false;
+    std::filesystem::create_directories(g_build_config.checkpoint_dir);
+    std::string file = g_build_config.checkpoint_dir + "/" + name + ".ckpt";
+    if (!checkpoint.open(file, hypergraph_checksum(hypergraph), g_build_config.resume)) {
+        std::cerr << "   ⚠️  Checkpointing disabled" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 레벨 g의 집합들 (shells면 shell, 아니면 core)
+static std::vector<std::unordered_set<int>> compute_level(const Hypergraph& hypergraph, ComponentPartition& partition,
+                                                          int g, bool shells) {
+    if (!partition.parts.empty()) return enumerate_by_components(partition, g, shells);
+    return shells ? enumerate_1_g(hypergraph, g) : enumerate_kg_core_fixing_g(hypergraph, g);
+}
+
+std::string level_shard_path(const std::string& dir, const std::string& kind, int g_begin) {
+    return dir + "/" + kind + "_" + std::to_string(g_begin) + ".shard";
+}
+
+// 분산 구성 병합: 샤드들을 g 순서대로 이어 읽어 consume에 넘김 (샤드 경계는 보이지 않음)
+static int replay_level_shards(const Hypergraph& hypergraph, const char* kind, int max_g,
+                               const std::function<void(int, std::vector<std::unordered_set<int>>&)>& consume) {
+    uint64_t checksum = hypergraph_checksum(hypergraph);
+    int shards = 0;
+    for (int g = 1; g < max_g; shards++) {
+        std::string file = level_shard_path(g_build_config.shard_dir, kind, g);
+        LevelCheckpoint shard;
+        if (!std::filesystem::exists(file) || !shard.open(file, checksum, true, g) || shard.completed() == 0) {
+            throw std::runtime_error("missing or mismatched level shard " + file);
+        }
+        for (int end = g + shard.completed(); g < end && g < max_g; g++) {
+            std::vector<std::unordered_set<int>> level;
+            if (!shard.read_level(g, level)) {
+                throw std::runtime_error("cannot read level g=" + std::to_string(g) + " from " + file);
+            }
+            if (level.empty()) {
+                std::cout << "   🧩 Merged " << (shards + 1) << " level shards (g=1.." << (g - 1) << ")" << std::endl;
+                return g;
+            }
+            consume(g, level);
+        }
+    }
+    return max_g;
+}
+
+int build_level_shard(const Hypergraph& hypergraph, const std::string& kind, int g_begin, int g_end, const std::string& filename) {
+    bool shells = kind == "shells";
+    if (!shells && kind != "cores") return -1;
+    
+    LevelCheckpoint shard;
+    if (!shard.open(filename, hypergraph_checksum(hypergraph), false, g_begin)) return -1;
+    
+    auto partition = prepare_component_partition(hypergraph);
+    TaskRuntime& runtime = task_runtime();
+    int wave = runtime.num_workers();
+    
+    // for_each_g_level과 같이 워커 수만큼 묶어 계산하고 g 순서대로 기록 (처음 빈 레벨은 빈 기록으로 남기고 멈춤)
+    for (int first = g_begin, last; first < g_end; first = last) {
+        last = std::min(g_end, first + wave);
+        std::vector<std::vector<std::unordered_set<int>>> levels(last - first);
+        TaskGroup group(runtime);
+        for (int g = first; g < last; g++) {
+            group.run([&, g] { levels[g - first] = compute_level(hypergraph, partition, g, shells); });
+        }
+        group.wait();
+        
+        for (int g = first; g < last; g++) {
+            if (!shard.append_level(g, levels[g - first])) return -1;
+            if (levels[g - first].empty()) return g;
+        }
+    }
+    return g_end;
+}
+
+// g = 1, 2, ... 레벨을 워커 수만큼 묶어 병렬로 계산하고 g 순서대로 consume에 넘김
+// kind는 "cores"(레벨 = (k,g)-core들) 또는 "shells"(레벨 = shell들), 체크포인트/샤드 이름으로도 씀
+// (k,g+1)-core ⊆ (k,g)-core 이므로 처음 빈 레벨 이후는 모두 비어 있음 → 거기서 멈추고, 같은 묶음의 뒤쪽 결과만 버림
+// 메모리 예산이 있으면 레벨마다 shell을 임시 파일로 흘려 보내고 차례가 오면 그 레벨만 되살림 (묶음 크기는 남은 예산으로)
+// 체크포인트를 쓰면 consume 전에 레벨을 checkpoint_name.ckpt에 기록하고, 재개할 때는 기록된 레벨을 읽어서 consume에 다시 넘김
+// (consume 쪽 상태는 레벨들만으로 다시 만들어지므로 레벨 집합만 저장)
+// 반환값은 처음 빈 g (끝까지 비지 않았으면 max_g)
+static int for_each_g_level(const Hypergraph& hypergraph, ComponentPartition& partition, const char* kind, int max_g,
+                            const std::function<void(int, std::vector<std::unordered_set<int>>&)>& consume) {
+    if (!g_build_config.shard_dir.empty()) {
+        return replay_level_shards(hypergraph, kind, max_g, consume);
+    }
+    bool shells = std::string(kind) == "shells";
+    
+    LevelCheckpoint checkpoint;
+    bool checkpointing = open_level_checkpoint(hypergraph, kind, checkpoint);
+    int resumed = checkpointing ? std::min(checkpoint.completed(), max_g - 1) : 0;
+    if (resumed > 0) {
+        std::cout << "   ♻️  Resuming from checkpoint: g=1.." << resumed << " already built" << std::endl;
+    }
+    for (int g = 1; g <= resumed; g++) {
+        std::vector<std::unordered_set<int>> level;
+        if (!checkpoint.read_level(g, level)) {
+            throw std::runtime_error("cannot read checkpointed level g=" + std::to_string(g));
+        }
+        consume(g, level);
+    }
+    
+    TaskRuntime& runtime = task_runtime();
+    int wave = runtime.num_workers();
+    bool budgeted = g_build_config.memory_budget_kb > 0;
+    size_t peel_kb = budgeted ? level_peel_kb(hypergraph) : 0;
+    
+    for (int first = resumed + 1, last; first < max_g; first = last) {
+        if (budgeted) {
+            int fits = budget_wave(peel_kb, runtime.num_workers(), first);
+            if (fits != wave) {
+                std::cout << "   💾 Memory budget: " << fits << " g level(s) at a time (~" << peel_kb << " KB each, "
+                          << get_memory_usage_kb() << " of " << g_build_config.memory_budget_kb << " KB in use)" << std::endl;
+                wave = fits;
+            }
+        }
+        last = std::min(max_g, first + wave);
+        std::vector<std::vector<std::unordered_set<int>>> levels(last - first);
+        std::vector<size_t> spilled_elements(last - first, 0);
+        
+        // 예외나 빈 레벨로 빠져나가도 이 묶음의 임시 파일은 남기지 않음 (restore_level이 지운 파일은 건너뜀)
+        struct SpillCleanup {
+            bool active;
+            int first, last;
+            ~SpillCleanup() {
+                for (int g = first; active && g < last; g++) std::remove(spill_path(g).c_str());
+            }
+        } cleanup{budgeted, first, last};
+        
+        TaskGroup group(runtime);
+        for (int g = first; g < last; g++) {
+            group.run([&, g] {
+                if (budgeted) {
+                    spilled_elements[g - first] = spill_level(hypergraph, partition, g, shells, spill_path(g));
+                } else {
+                    levels[g - first] = compute_level(hypergraph, partition, g, shells);
+                }
+            });
+        }
+        group.wait();
+        
+        for (int g = first; g < last; g++) {
+            if (budgeted) {
+                if (spilled_elements[g - first] > 0) check_restore_fits(spilled_elements[g - first], g);
+                levels[g - first] = restore_level(spill_path(g), shells);
+            }
+            if (levels[g - first].empty()) {
+                if (checkpointing) checkpoint.remove();
+                return g;
+            }
+            if (checkpointing && !checkpoint.append_level(g, levels[g - first])) {
+                checkpointing = false;
+            }
+            consume(g, levels[g - first]);
+            levels[g - first] = std::vector<std::unordered_set<int>>();
+            // 해제한 레벨의 페이지를 돌려줘야 다음 묶음의 남은 예산을 RSS로 잴 수 있음
+            if (budgeted) malloc_trim(0);
+        }
+    }
+    if (checkpointing) checkpoint.remove();
+    return max_g;
+}
+
+// ============================================================================
+// Naive 인덱스
+// ============================================================================
+
+// g 레벨의 집합 크기 요약
+// (k,g+1)-core ⊆ (k,g)-core, (k+1,g)-core ⊆ (k,g)-core 이므로 크기가 같으면 core도 같음 (집합 비교 불필요)
+static std::vector<size_t> level_summary(const std::vector<std::unordered_set<int>>& sets) {
+    std::vector<size_t> sizes;
+    sizes.reserve(sets.size());
+    for (const auto& set : sets) {
+        sizes.push_back(set.size());
+    }
+    return sizes;
+}
+
+// shell 크기들의 뒤에서부터 누적합 = (k,g)-core 크기들
+static std::vector<uint32_t> suffix_core_sizes(const std::vector<size_t>& shell_sizes) {
+    std::vector<uint32_t> core_sizes(shell_sizes.size());
+    size_t total = 0;
+    for (size_t s = shell_sizes.size(); s-- > 0;) {
+        total += shell_sizes[s];
+        core_sizes[s] = total;
+    }
+    return core_sizes;
+}
+
+void NaiveIndex::add_level(const std::vector<std::unordered_set<int>>& cores) {
+    std::vector<size_t> sizes = level_summary(cores);
+    logical_leaves += cores.size();
+    for (size_t size : sizes) {
+        referenced += size;
+    }
+    
+    // 직전 g 레벨과 모든 core가 같으면 run만 늘림
+    if (!previous_sizes.empty() && sizes == previous_sizes) {
+        level_runs.add_level(true);
+        return;
+    }
+    level_runs.add_level(false);
+    
+    std::vector<int> sorted, stored_copy;
+    for (int k = 1; k <= (int)cores.size(); k++) {
+        // 더 벗겨지는 노드가 없으면 (k-1,g)-core의 run이 이어짐
+        if (k > 1 && sizes[k - 1] == sizes[k - 2]) continue;
+        
+        sorted.assign(cores[k - 1].begin(), cores[k - 1].end());
+        std::sort(sorted.begin(), sorted.end());
+        
+        uint64_t hash = 1469598103934665603ULL ^ sorted.size();  // FNV-1a
+        for (int node : sorted) {
+            hash ^= static_cast<uint64_t>(node);
+            hash *= 1099511628211ULL;
+        }
+        
+        // 같은 내용의 leaf가 이미 있으면 그 구간을 공유
+        KRun run;
+        run.first_k = k;
+        bool shared = false;
+        auto candidates = by_content.equal_range(hash);
+        for (auto it = candidates.first; it != candidates.second; ++it) {
+            const FlatIndex::Range& other = k_runs[it->second].leaf;
+            if (other.size() != sorted.size()) continue;
+            
+            const int* stored = arena.data() + other.begin;
+            if (arena_stream) {
+                // 파일에 쓴 leaf는 다시 읽어서 비교 (못 읽으면 새로 저장)
+                stored_copy.resize(other.size());
+                if (!arena_stream->read(other.begin * sizeof(int), stored_copy.data(), other.size() * sizeof(int))) continue;
+                stored = stored_copy.data();
+            }
+            if (std::equal(sorted.begin(), sorted.end(), stored)) {
+                run.leaf = other;
+                shared = true;
+                break;
+            }
+        }
+        
+        if (!shared) {
+            run.leaf.begin = stored_nodes();
+            if (arena_stream) {
+                arena_stream->append(sorted.data(), sorted.size() * sizeof(int));
+            } else {
+                arena.insert(arena.end(), sorted.begin(), sorted.end());
+            }
+            run.leaf.end = stored_nodes();
+            by_content.emplace(hash, k_runs.size());
+            unique_count++;
+        }
+        k_runs.push_back(run);
+    }
+    level_begin.push_back(k_runs.size());
+    level_max_k.push_back(cores.size());
+    previous_sizes = std::move(sizes);
+}
+
+size_t NaiveIndex::stored_nodes() const {
+    return arena_stream ? arena_stream->size() / sizeof(int) : arena.size();
+}
+
+void NaiveIndex::finish() {
+    if (arena_stream) arena_stream->flush();
+    by_content = std::unordered_multimap<uint64_t, uint32_t>();
+    previous_sizes = std::vector<size_t>();
+    arena.shrink_to_fit();
+    k_runs.shrink_to_fit();
+    level_begin.shrink_to_fit();
+    level_max_k.shrink_to_fit();
+    level_runs.first_g.shrink_to_fit();
+}
+
+void NaiveIndex::print_stats() const {
+    std::cout << "Naive Index Statistics:" << std::endl;
+    std::cout << "  g-levels: " << num_levels() << " (" << num_stored_levels() << " stored, rest as runs)" << std::endl;
+    std::cout << "  Leaves: " << num_leaves() << " (" << stored_leaves() << " k-runs, "
+              << unique_leaves() << " unique)" << std::endl;
+    std::cout << "  Stored node IDs: " << stored_nodes() << " of " << referenced_nodes() << " referenced";
+    if (referenced_nodes() > 0) {
+        std::cout << " (" << std::fixed << std::setprecision(1)
+                  << (1.0 - (double)stored_nodes() / referenced_nodes()) * 100 << "% deduplicated)";
+    }
+    std::cout << std::endl;
+    std::cout << "  Memory: " << memory_bytes() << " bytes" << std::endl;
+}
+
+// g 레벨마다 (k,g)-core들을 구해 index에 추가 (arena를 파일에 쓰는 경우에도 같은 경로)
+static void fill_naive_index(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E, NaiveIndex& index) {
+    std::cout << "🔧 Naive: Processing g-values (Bitmap Optimized)..." << std::endl;
+    
+    auto partition = prepare_component_partition(hypergraph);
+    
+    int stop_g = for_each_g_level(hypergraph, partition, "cores", E.size(), [&](int g, std::vector<std::unordered_set<int>>& S) {
+        std::cout << "   g=" << g << ": found " << S.size() << " cores" << std::endl;
+        index.add_level(S);
+    });
+    
+    if (stop_g < (int)E.size()) {
+        std::cout << "   g=" << stop_g << ": no cores found, stopping at g=" << (stop_g-1) << std::endl;
+    }
+    
+    index.finish();
+    std::cout << "✅ Naive: Completed with " << index.num_levels() << " g-levels" << std::endl;
+    index.print_stats();
+}
+
+NaiveIndex naive_index_construction(
+    const Hypergraph& hypergraph, 
+    const std::vector<std::unordered_set<int>>& E) {
+    
+    NaiveIndex index;
+    fill_naive_index(hypergraph, E, index);
+    return index;
+}
+
+bool build_naive_index_file(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E,
+                            const std::string& filename, IndexMetadata metadata) {
+    auto arena = std::make_shared<SectionStream>();
+    if (!arena->open(filename)) return false;
+    
+    NaiveIndex index;
+    index.stream_arena(arena);
+    fill_naive_index(hypergraph, E, index);
+    if (arena->failed()) return false;
+    
+    metadata.max_g_level = index.num_levels();
+    return save_naive_index(index, metadata, filename);
+}
+
+NodeSpan querying_for_naive_index(const NaiveIndex& index, int k, int g) {
+    return index.query(k, g);
+}
+
+// 두 core 모두 arena의 정렬된 구간이므로 병합 차집합 한 번
+CoreResult querying_shell_for_naive_index(const NaiveIndex& index, int k, int g) {
+    NodeSpan core = index.query(k, g);
+    NodeSpan upper = index.query(k + 1, g);
+    if (upper.empty()) return CoreResult(core);
+    
+    auto shell = std::make_shared<std::vector<int>>();
+    shell->reserve(core.size() - std::min(core.size(), upper.size()));
+    std::set_difference(core.begin(), core.end(), upper.begin(), upper.end(), std::back_inserter(*shell));
+    CoreResult result(NodeSpan{shell->data(), shell->size()});
+    result.keep_alive(shell);
+    return result;
+}
+
+// ============================================================================
+// 나머지 함수들
+// ============================================================================
+
+std::vector<std::unordered_set<int>> enumerate_1_g(const Hypergraph& hypergraph, int g) {
+    // S[k-1] = (k,g)-core \ (k+1,g)-core, 마지막 원소는 가장 큰 k의 core 전체
+    return shells_fixing_g(hypergraph, g);
 }
 
 std::shared_ptr<TreeNode> one_level_compression(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E) {
@@ -526,19 +1464,26 @@ std::shared_ptr<TreeNode> one_level_compression(const Hypergraph& hypergraph, co
     
     std::cout << "      🔧 One-Level: Processing g-values..." << std::endl;
     
-    for (int g = 1; g < (int)E.size(); g++) {
-        std::cout << "         g=" << g << ": Computing cores..." << std::flush;
-        
-        auto S = enumerate_1_g(hypergraph, g);
+    auto partition = prepare_component_partition(hypergraph);
+    std::vector<size_t> previous_sizes;
+    
+    int stop_g = for_each_g_level(hypergraph, partition, "shells", E.size(), [&](int g, std::vector<std::unordered_set<int>>& S) {
+        std::cout << "         g=" << g << ": found " << S.size() << " cores" << std::endl;
         
-        if (S.empty()) {
-            std::cout << " no cores found, stopping at g=" << (g-1) << std::endl;
-            break;
+        // shell 크기가 모두 같으면 core도 모두 같으므로 직전 레벨의 run을 늘림
+        std::vector<size_t> sizes = level_summary(S);
+        if (sizes == previous_sizes) {
+            T->level_runs.add_level(true);
+            std::cout << "            same cores as g=" << (g-1) << ", stored as run" << std::endl;
+            return;
         }
+        T->level_runs.add_level(false);
+        previous_sizes = std::move(sizes);
         
-        std::cout << " found " << S.size() << " cores" << std::endl;
-        
-        T->children.push_back(std::make_shared<TreeNode>(std::to_string(g)));
+        // 이름은 FlatIndex::name()으로 필요할 때만 만듦
+        T->children.push_back(std::make_shared<TreeNode>(""));
+        auto level = T->children.back();
+        level->core_sizes = suffix_core_sizes(previous_sizes);
         
         std::shared_ptr<TreeNode> prev = nullptr;
         
@@ -548,12 +1493,14 @@ std::shared_ptr<TreeNode> one_level_compression(const Hypergraph& hypergraph, co
                 std::cout << "            k=" << (s+1) << " (" << S[s].size() << " nodes)" << std::endl;
             }
             
-            std::string node_name = "(" + std::to_string(s + 1) + "," + std::to_string(g) + ")";
-            T->children[g - 1]->children.push_back(std::make_shared<TreeNode>(node_name));
+            level->children.push_back(std::make_shared<TreeNode>(""));
             
-            T->children[g - 1]->children[s]->value = S[s];
+            auto& value = level->children[s]->value;
+            value.assign(S[s].begin(), S[s].end());
+            std::sort(value.begin(), value.end());
+            S[s] = std::unordered_set<int>();
             
-            auto u = T->children[g - 1]->children[s];
+            auto u = level->children[s];
             
             if (prev != nullptr) {
                 prev->next = u;
@@ -561,12 +1508,229 @@ std::shared_ptr<TreeNode> one_level_compression(const Hypergraph& hypergraph, co
             
             prev = u;
         }
+    });
+    
+    if (stop_g < (int)E.size()) {
+        std::cout << "         g=" << stop_g << ": no cores found, stopping at g=" << (stop_g-1) << std::endl;
     }
     
-    std::cout << "      ✅ One-Level: Completed with " << T->children.size() << " g-levels" << std::endl;
+    std::cout << "      ✅ One-Level: Completed with " << T->level_runs.max_g() << " g-levels ("
+              << T->children.size() << " stored, rest as runs)" << std::endl;
     return T;
 }
 
+// one_level_compression + flatten_index + save_flat_index와 같은 파일을 레벨 단위로 만듦
+// 레벨마다 집합들을 인코딩해서 (페이지 정렬 규칙 그대로) 파일에 붙이고, 노드 표와 레벨 표만 메모리에 남김
+bool build_one_level_index_file(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E,
+                                const std::string& filename, IndexMetadata metadata) {
+    auto sets = std::make_shared<SectionStream>();
+    if (!sets->open(filename)) return false;
+    
+    FlatIndex index;
+    index.streamed_sets = sets;
+    index.level_begin.push_back(0);
+    
+    std::cout << "      🔧 One-Level (external): Processing g-values..." << std::endl;
+    
+    auto partition = prepare_component_partition(hypergraph);
+    SetCodec codec = g_build_config.leaf_codec;
+    std::vector<size_t> previous_sizes;
+    std::vector<int> sorted;
+    std::vector<uint8_t> encoded;
+    
+    int stop_g = for_each_g_level(hypergraph, partition, "shells", E.size(), [&](int g, std::vector<std::unordered_set<int>>& S) {
+        std::cout << "         g=" << g << ": found " << S.size() << " cores" << std::endl;
+        
+        std::vector<size_t> sizes = level_summary(S);
+        if (sizes == previous_sizes) {
+            index.level_runs.add_level(true);
+            std::cout << "            same cores as g=" << (g-1) << ", stored as run" << std::endl;
+            return;
+        }
+        index.level_runs.add_level(false);
+        previous_sizes = std::move(sizes);
+        int level_g = index.level_runs.first_g[index.level_runs.num_stored() - 1];
+        std::vector<uint32_t> core_sizes = suffix_core_sizes(previous_sizes);
+        index.core_sizes.insert(index.core_sizes.end(), core_sizes.begin(), core_sizes.end());
+        
+        // 레벨의 집합들을 k 순서(next 체인 순서)로 인코딩
+        encoded.clear();
+        std::vector<uint32_t> offsets(S.size(), FlatIndex::kNull);
+        for (size_t s = 0; s < S.size(); s++) {
+            if (S[s].empty()) continue;
+            sorted.assign(S[s].begin(), S[s].end());
+            std::sort(sorted.begin(), sorted.end());
+            S[s] = std::unordered_set<int>();
+            
+            offsets[s] = encoded.size();
+            encode_sorted_set(sorted.data(), sorted.data() + sorted.size(), codec, encoded);
+            index.raw_set_bytes += sorted.size() * sizeof(int);
+        }
+        
+        sets->pad(level_group_padding(sets->size(), encoded.size()));
+        uint32_t base = sets->size();
+        index.level_set_begin.push_back(base);
+        sets->append(encoded.data(), encoded.size());
+        
+        uint32_t first = index.nodes.size();
+        for (size_t s = 0; s < S.size(); s++) {
+            FlatIndex::Node node;
+            node.next = s + 1 < S.size() ? first + s + 1 : FlatIndex::kNull;
+            node.value = offsets[s] == FlatIndex::kNull ? FlatIndex::kNull : base + offsets[s];
+            node.k = s + 1;
+            node.g = level_g;
+            index.nodes.push_back(node);
+        }
+        index.level_begin.push_back(index.nodes.size());
+    });
+    
+    if (stop_g < (int)E.size()) {
+        std::cout << "         g=" << stop_g << ": no cores found, stopping at g=" << (stop_g-1) << std::endl;
+    }
+    index.level_set_begin.push_back(sets->size());
+    if (!sets->flush()) return false;
+    
+    std::cout << "      ✅ One-Level (external): Completed with " << index.num_levels() << " g-levels ("
+              << index.num_stored_levels() << " stored, rest as runs), leaf sets " << index.raw_set_bytes
+              << " → " << sets->size() << " bytes" << std::endl;
+    
+    metadata.max_g_level = index.num_levels();
+    return save_flat_index(index, metadata, filename);
+}
+
+// ============================================================================
+// 지연 구성 인덱스 (레벨 단위 캐시)
+// ============================================================================
+
+LazyLevelIndex::LazyLevelIndex(const Hypergraph& hypergraph, size_t capacity_bytes)
+    : hypergraph(hypergraph), partition(prepare_component_partition(hypergraph)), capacity_bytes(capacity_bytes) {
+    for (const auto& [node, hyperedges] : hypergraph.node_hyperedges) {
+        max_degree = std::max(max_degree, (int)hyperedges.size());
+    }
+}
+
+std::shared_ptr<const LazyLevelIndex::Level> LazyLevelIndex::build(int g) {
+    auto S = partition.parts.empty() ? enumerate_1_g(hypergraph, g) : enumerate_by_components(partition, g, true);
+    
+    auto level = std::make_shared<Level>();
+    size_t total = 0;
+    for (const auto& shell : S) total += shell.size();
+    level->nodes.reserve(total);
+    level->starts.reserve(S.size() + 1);
+    for (const auto& shell : S) {
+        level->starts.push_back(level->nodes.size());
+        auto begin = level->nodes.insert(level->nodes.end(), shell.begin(), shell.end());
+        std::sort(begin, level->nodes.end());
+    }
+    level->starts.push_back(level->nodes.size());
+    return level;
+}
+
+std::shared_ptr<const LazyLevelIndex::Level> LazyLevelIndex::level(int g) {
+    static const auto empty_level = std::make_shared<const Level>();
+    if (g <= 0 || g > max_degree) {
+        return empty_level;
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(g);
+    if (it != entries.end()) {
+        if (it->second.built) {
+            counters.hits++;
+            lru.splice(lru.begin(), lru, it->second.position);
+            return it->second.ready.get();
+        }
+        // 다른 스레드가 구성 중: 락을 놓고 그 결과를 기다림 (실패했으면 예외가 그대로 넘어옴)
+        counters.waits++;
+        auto ready = it->second.ready;
+        lock.unlock();
+        return ready.get();
+    }
+    
+    std::promise<std::shared_ptr<const Level>> promise;
+    entries[g].ready = promise.get_future().share();
+    lock.unlock();
+    
+    auto start = std::chrono::high_resolution_clock::now();
+    std::shared_ptr<const Level> built;
+    try {
+        built = build(g);
+    } catch (...) {
+        // 기다리던 요청에는 예외를 넘기고 항목은 지워서 다음 요청이 다시 구성하게 함
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> guard(mutex);
+        entries.erase(g);
+        throw;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    promise.set_value(built);
+    
+    lock.lock();
+    Entry& entry = entries[g];
+    entry.built = true;
+    lru.push_front(g);
+    entry.position = lru.begin();
+    counters.builds++;
+    counters.build_seconds += seconds;
+    counters.cached_bytes += built->bytes();
+    evict_locked();
+    return built;
+}
+
+// 상한을 넘는 동안 가장 오래 안 쓴 레벨부터 내보냄 (방금 넣은 레벨 하나는 남김)
+void LazyLevelIndex::evict_locked() {
+    while (capacity_bytes > 0 && counters.cached_bytes > capacity_bytes && lru.size() > 1) {
+        int g = lru.back();
+        lru.pop_back();
+        auto it = entries.find(g);
+        counters.cached_bytes -= it->second.ready.get()->bytes();
+        entries.erase(it);
+        counters.evictions++;
+    }
+}
+
+CoreResult LazyLevelIndex::query(int k, int g) {
+    auto L = level(g);
+    if (k <= 0 || k > L->max_k()) {
+        return CoreResult();
+    }
+    // shell마다 정렬돼 있으므로 shell 하나가 조각 하나
+    CoreResult core;
+    for (int s = k - 1; s < L->max_k(); s++) {
+        core.add_span(NodeSpan{L->nodes.data() + L->starts[s], L->starts[s + 1] - L->starts[s]});
+    }
+    core.keep_alive(L);
+    return core;
+}
+
+CoreResult LazyLevelIndex::shell(int k, int g) {
+    auto L = level(g);
+    if (k <= 0 || k > L->max_k()) {
+        return CoreResult();
+    }
+    CoreResult shell(NodeSpan{L->nodes.data() + L->starts[k - 1], L->starts[k] - L->starts[k - 1]});
+    shell.keep_alive(L);
+    return shell;
+}
+
+size_t LazyLevelIndex::core_size(int k, int g) {
+    auto L = level(g);
+    return k <= 0 || k > L->max_k() ? 0 : L->nodes.size() - L->starts[k - 1];
+}
+
+bool LazyLevelIndex::cached(int g) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(g);
+    return it != entries.end() && it->second.built;
+}
+
+LazyLevelIndex::Stats LazyLevelIndex::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result = counters;
+    result.cached_levels = lru.size();
+    return result;
+}
+
 std::pair<std::shared_ptr<TreeNode>, double> jump_compression(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E) {
     auto h_time_start = std::chrono::high_resolution_clock::now();
     
@@ -580,31 +1744,30 @@ std::pair<std::shared_ptr<TreeNode>, double> jump_compression(const Hypergraph&
     
     std::cout << "      🔧 Jump: Adding jump pointers..." << std::endl;
     
+    // run으로 합쳐진 레벨은 저장되지 않으므로 저장된 레벨끼리 이어도 core의 포함 관계가 유지됨
+    // 각 g 레벨의 차집합은 원래의 g+1 레벨 값만 보므로 레벨별로 병렬 계산한 뒤 한꺼번에 교체
+    std::vector<std::vector<std::vector<int>>> differences(std::max(0, max_g - 1));
+    task_runtime().parallel_for(0, max_g - 1, [&](int begin, int end) {
+        for (int g = begin; g < end; g++) {
+            int max_k = std::min(T_2->children[g + 1]->children.size(), T_2->children[g]->children.size());
+            differences[g].resize(max_k);
+            
+            for (int k = 0; k < max_k; k++) {
+                sorted_difference(T_2->children[g]->children[k]->value,
+                                  T_2->children[g + 1]->children[k]->value, differences[g][k]);
+            }
+        }
+    }, 1);
+    
     for (int g = 0; g < max_g - 1; g++) {
-        int max_k = T_2->children[g + 1]->children.size();
+        int processed = differences[g].size();
+        std::cout << "         g=" << (g+1) << ": Processing " << T_2->children[g + 1]->children.size()
+                  << " jump connections... " << processed << " completed" << std::endl;
         
-        std::cout << "         g=" << (g+1) << ": Processing " << max_k << " jump connections..." << std::flush;
-        
-        int processed = 0;
-        for (int k = 0; k < max_k; k++) {
-            if (k < (int)T_2->children[g]->children.size()) {
-                T_2->children[g]->children[k]->jump = T_2->children[g + 1]->children[k];
-                
-                std::unordered_set<int> difference;
-                const auto& current_value = T_2->children[g]->children[k]->value;
-                const auto& jump_value = T_2->children[g]->children[k]->jump->value;
-                
-                for (int node : current_value) {
-                    if (jump_value.find(node) == jump_value.end()) {
-                        difference.insert(node);
-                    }
-                }
-                
-                T_2->children[g]->children[k]->value = difference;
-                processed++;
-            }
+        for (int k = 0; k < processed; k++) {
+            T_2->children[g]->children[k]->jump = T_2->children[g + 1]->children[k];
+            T_2->children[g]->children[k]->value = std::move(differences[g][k]);
         }
-        std::cout << " " << processed << " completed" << std::endl;
     }
     
     auto h_time = std::chrono::duration<double>(h_time_end - h_time_start).count();
@@ -613,26 +1776,6 @@ std::pair<std::shared_ptr<TreeNode>, double> jump_compression(const Hypergraph&
     return {T_2, h_time};
 }
 
-std::unordered_set<int> set_intersection(const std::unordered_set<int>& set1, const std::unordered_set<int>& set2) {
-    std::unordered_set<int> result;
-    for (int element : set1) {
-        if (set2.find(element) != set2.end()) {
-            result.insert(element);
-        }
-    }
-    return result;
-}
-
-std::unordered_set<int> set_difference(const std::unordered_set<int>& set1, const std::unordered_set<int>& set2) {
-    std::unordered_set<int> result;
-    for (int element : set1) {
-        if (set2.find(element) == set2.end()) {
-            result.insert(element);
-        }
-    }
-    return result;
-}
-
 std::tuple<std::shared_ptr<TreeNode>, double, double> diagonal_compression(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E) {
     auto v_time_start = std::chrono::high_resolution_clock::now();
     
@@ -712,3 +1855,121 @@ std::tuple<std::shared_ptr<TreeNode>, double, double> diagonal_compression(const
 }
 
 
+
+// ============================================================================
+// 평평한 레이아웃 변환
+// ============================================================================
+
+FlatIndex flatten_index(const std::shared_ptr<TreeNode>& tree) {
+    FlatIndex index;
+    index.level_begin.push_back(0);
+    if (!tree) return index;
+    
+    index.level_runs = tree->level_runs;
+    if (index.level_runs.empty()) {
+        for (size_t g = 0; g < tree->children.size(); g++) {
+            index.level_runs.add_level(false);
+        }
+    }
+    
+    // 1) 레벨 노드들에 번호 부여 (g, k 순서로 연속)
+    std::unordered_map<const TreeNode*, uint32_t> ids;
+    std::vector<const TreeNode*> order;
+    for (int g = 0; g < (int)tree->children.size(); g++) {
+        for (int k = 0; k < (int)tree->children[g]->children.size(); k++) {
+            const TreeNode* node = tree->children[g]->children[k].get();
+            ids.emplace(node, order.size());
+            order.push_back(node);
+            
+            FlatIndex::Node flat;
+            flat.k = k + 1;
+            flat.g = index.level_runs.first_g[g];
+            index.nodes.push_back(flat);
+        }
+        index.level_begin.push_back(order.size());
+    }
+    
+    // 2) next/jump로만 닿는 노드들 (diagonal의 aux 노드) 번호 부여
+    for (size_t n = 0; n < order.size(); n++) {
+        for (const TreeNode* linked : {order[n]->next.get(), order[n]->jump.get()}) {
+            if (linked && ids.emplace(linked, order.size()).second) {
+                order.push_back(linked);
+                index.nodes.emplace_back();
+            }
+        }
+    }
+    
+    for (size_t n = 0; n < order.size(); n++) {
+        index.nodes[n].next = order[n]->next ? ids.at(order[n]->next.get()) : FlatIndex::kNull;
+        index.nodes[n].jump = order[n]->jump ? ids.at(order[n]->jump.get()) : FlatIndex::kNull;
+    }
+    
+    // 3) 쿼리가 따라가는 순서(레벨마다 k=1에서 next 체인)대로 집합들을 인코딩해서 배치
+    SetCodec codec = g_build_config.leaf_codec;
+    size_t codec_sets[4] = {0, 0, 0, 0};
+    auto encode = [&](const std::vector<int>& sorted) -> uint32_t {
+        if (sorted.empty()) return FlatIndex::kNull;
+        
+        uint32_t offset = index.sets.size();
+        SetCodec used = encode_sorted_set(sorted.data(), sorted.data() + sorted.size(), codec, index.sets);
+        codec_sets[static_cast<int>(used)]++;
+        index.raw_set_bytes += sorted.size() * sizeof(int);
+        return offset;
+    };
+    
+    std::vector<bool> placed(order.size(), false);
+    auto place = [&](uint32_t n) {
+        placed[n] = true;
+        FlatIndex::Node& flat = index.nodes[n];
+        const TreeNode* node = order[n];
+        
+        flat.value = encode(node->value);
+        
+        // aux는 i = 1..최대 i 조밀 배열 (없는 i는 kNull) → aux[1..s]가 항상 앞쪽 구간 하나
+        int max_i = 0;
+        for (const auto& aux_pair : node->aux) {
+            if (!aux_pair.second.empty()) max_i = std::max(max_i, aux_pair.first);
+        }
+        
+        flat.aux_begin = index.aux_entries.size();
+        for (int i = 1; i <= max_i; i++) {
+            auto it = node->aux.find(i);
+            FlatIndex::AuxEntry entry;
+            entry.i = i;
+            entry.set = it == node->aux.end() ? FlatIndex::kNull : encode(it->second);
+            index.aux_entries.push_back(entry);
+        }
+        flat.aux_end = index.aux_entries.size();
+    };
+    
+    for (int l = 0; l < index.num_stored_levels(); l++) {
+        index.level_set_begin.push_back(index.sets.size());
+        uint32_t n = index.stored_level_size(l) > 0 ? index.level_begin[l] : FlatIndex::kNull;
+        while (n != FlatIndex::kNull && !placed[n]) {
+            place(n);
+            n = index.nodes[n].next;
+        }
+    }
+    index.level_set_begin.push_back(index.sets.size());
+    for (uint32_t n = 0; n < order.size(); n++) {
+        if (!placed[n]) place(n);
+    }
+    index.sets.shrink_to_fit();
+    
+    // 4) 레벨 노드마다 core 크기 (구성 때 적어 둔 것이 없는 트리는 한 번씩 쿼리해서 셈)
+    index.core_sizes.resize(index.level_begin.back());
+    for (int l = 0; l < index.num_stored_levels(); l++) {
+        const auto& sizes = tree->children[l]->core_sizes;
+        bool known = (int)sizes.size() == index.stored_level_size(l);
+        for (int k = 1; k <= index.stored_level_size(l); k++) {
+            index.core_sizes[index.level_begin[l] + k - 1] =
+                known ? sizes[k - 1] : querying_for_diagonal(FlatIndexView(index), k, index.level_runs.first_g[l]).size();
+        }
+    }
+    
+    std::cout << "      🗜️  Leaf sets (" << set_codec_name(codec) << "): " << index.raw_set_bytes << " → "
+              << index.sets.size() << " bytes (varint " << codec_sets[1] << ", ef " << codec_sets[2]
+              << ", roaring " << codec_sets[3] << ", raw " << codec_sets[0] << " sets)" << std::endl;
+    
+    return index;
+}
@@ -16,16 +16,103 @@
 #include <filesystem>
 #include <iomanip>
 #include <ctime>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <future>
+#include <list>
+
+// 연속된 g 레벨의 core가 모두 같으면 한 레벨만 저장하고 g 구간(run)으로 가리키는 표
+// 저장된 레벨 l은 g ∈ [first_g[l], first_g[l+1]), 마지막 원소는 max_g + 1
+struct LevelRuns {
+    std::vector<uint32_t> first_g;
+    
+    bool empty() const { return first_g.empty(); }
+    int num_stored() const { return first_g.empty() ? 0 : (int)first_g.size() - 1; }
+    int max_g() const { return first_g.empty() ? 0 : (int)first_g.back() - 1; }
+    
+    // 다음 g 레벨 추가 (same_as_previous면 직전 run을 늘림)
+    void add_level(bool same_as_previous) {
+        if (first_g.empty()) first_g.push_back(1);
+        if (same_as_previous && first_g.size() > 1) {
+            first_g.back()++;
+        } else {
+            first_g.push_back(first_g.back() + 1);
+        }
+    }
+    
+    // g가 저장된 레벨 번호 (0부터), 범위 밖이면 -1
+    int level_of(int g) const { return level_of(first_g.data(), first_g.size(), g); }
+    
+    // 같은 표가 다른 곳(mmap 영역 등)에 있을 때
+    static int level_of(const uint32_t* first_g, size_t count, int g) {
+        if (g <= 0 || count == 0 || (uint32_t)g >= first_g[count - 1]) return -1;
+        return (int)(std::upper_bound(first_g, first_g + count, (uint32_t)g) - first_g) - 1;
+    }
+    
+    size_t memory_bytes() const { return first_g.capacity() * sizeof(uint32_t); }
+};
+
+// 노드 ID 집합 인코딩 (FlatIndex의 value/aux 집합마다 선택)
+// Auto는 세 압축 인코딩과 Raw의 크기를 계산해 가장 작은 것 (드문 집합은 varint, 촘촘하면 Elias-Fano/Roaring)
+enum class SetCodec : uint8_t { Raw = 0, DeltaVarint = 1, EliasFano = 2, Roaring = 3, Auto = 255 };
+
+// 정렬된 [first, last)를 out 끝에 인코딩해서 붙이고 실제로 쓴 codec 반환
+SetCodec encode_sorted_set(const int* first, const int* last, SetCodec codec, std::vector<uint8_t>& out);
+
+// 인코딩했을 때의 바이트 수 (메모리 보고용)
+size_t encoded_set_bytes(const int* first, const int* last, SetCodec codec);
+
+SetCodec encoded_set_codec(const uint8_t* data);
+size_t encoded_set_size(const uint8_t* data);
+
+// 인코딩된 집합을 out에 추가 (오름차순으로 풀림)
+void decode_sorted_set(const uint8_t* data, std::unordered_set<int>& out);
+void decode_sorted_set(const uint8_t* data, std::vector<int>& out);
+
+// out부터 채우고 끝 위치 반환 (out에는 encoded_set_size만큼 자리가 있어야 함)
+int* decode_sorted_set(const uint8_t* data, int* out);
+
+// 원소를 블록 단위로 넘김: raw 인코딩은 저장된 배열을 그대로, 나머지는 작은 스택 버퍼로 풀어서
+// block이 false를 돌려주면 멈추고 false 반환
+bool decode_sorted_set_blocks(const uint8_t* data, const std::function<bool(const int*, size_t)>& block);
+
+const char* set_codec_name(SetCodec codec);
+bool parse_set_codec(const std::string& name, SetCodec& codec);
+
+// 다른 곳(힙 벡터 또는 mmap 영역)에 있는 배열을 복사 없이 보여줌 (원본이 살아 있는 동안만 유효)
+template <typename T>
+struct ArrayView {
+    using value_type = T;
+    
+    const T* first = nullptr;
+    size_t count = 0;
+    
+    ArrayView() = default;
+    ArrayView(const T* data, size_t size) : first(data), count(size) {}
+    ArrayView(const std::vector<T>& values) : first(values.data()), count(values.size()) {}
+    
+    const T& operator[](size_t i) const { return first[i]; }
+    const T* data() const { return first; }
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
 
 // TreeNode 클래스 - Python의 TreeNode와 동일한 구조
+// value와 aux 집합은 오름차순 노드 ID 배열 (압축 단계의 교집합/차집합을 정렬 병합 커널로 처리)
 class TreeNode {
 public:
-    std::unordered_map<int, std::unordered_set<int>> aux;  // aux 딕셔너리
+    std::unordered_map<int, std::vector<int>> aux;         // aux 딕셔너리
     std::string name;                                      // 노드 이름
     std::vector<std::shared_ptr<TreeNode>> children;       // 자식 노드들
     std::shared_ptr<TreeNode> next;                        // 다음 노드 포인터
-    std::unordered_set<int> value;                         // 값 집합
+    std::vector<int> value;                                // 값 집합 (정렬됨)
     std::shared_ptr<TreeNode> jump;                        // 점프 포인터
+    LevelRuns level_runs;                                  // 루트 전용: g -> children 번호 (비어 있으면 children[g-1])
+    std::vector<uint32_t> core_sizes;                      // 레벨 노드 전용: core_sizes[k-1] = (k,g)-core 크기
     
     // 생성자
     TreeNode(const std::string& node_name) : name(node_name), next(nullptr), jump(nullptr) {}
@@ -34,6 +121,329 @@ public:
     ~TreeNode() = default;
 };
 
+class SectionStream;
+
+// one-level/jump/diagonal 인덱스의 평평한 레이아웃
+// 노드들은 하나의 표에 있고 next/jump는 32비트 번호, value/aux 집합은 sets 바이트 배열 안의 인코딩된 집합 위치
+// 저장된 레벨의 k 노드들은 표에서 연속 (diagonal의 aux 노드들은 레벨 노드들 뒤), 이름은 name()으로 필요할 때만 만듦
+// 같은 core가 이어지는 g들은 level_runs로 한 레벨을 가리킴
+struct FlatIndex {
+    static constexpr uint32_t kNull = 0xFFFFFFFFu;
+    
+    struct Range {
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        uint32_t size() const { return end - begin; }
+    };
+    
+    struct Node {
+        uint32_t next = kNull;
+        uint32_t jump = kNull;
+        uint32_t value = kNull;   // sets 안의 위치 (빈 집합이면 kNull)
+        uint32_t aux_begin = 0;   // aux_entries 구간: aux_entries[aux_begin + i - 1]이 aux[i] (i = 1..aux_end - aux_begin)
+        uint32_t aux_end = 0;
+        int32_t k = 0;            // 이름용 (aux 노드는 0)
+        int32_t g = 0;
+    };
+    
+    struct AuxEntry {
+        int32_t i;
+        uint32_t set;             // 빈 aux[i]는 kNull
+    };
+    
+    LevelRuns level_runs;               // g -> 저장된 레벨
+    std::vector<uint32_t> level_begin;  // 저장된 레벨 l의 노드는 nodes[level_begin[l], level_begin[l+1])
+    std::vector<Node> nodes;
+    std::vector<AuxEntry> aux_entries;
+    std::vector<uint8_t> sets;
+    std::vector<uint32_t> level_set_begin;  // 저장된 레벨 l이 놓은 집합은 sets[level_set_begin[l], level_set_begin[l+1]) (그 뒤는 체인 밖 aux)
+    std::vector<uint32_t> core_sizes;   // 레벨 노드 n = (k,g)의 core 크기 (nodes와 같은 번호, 길이 level_begin.back())
+    size_t raw_set_bytes = 0;           // 같은 집합들을 int 배열로 뒀을 때의 크기 (압축률 보고용)
+    std::shared_ptr<SectionStream> streamed_sets;  // 외부 메모리 구성: sets 대신 구성 중인 파일에 이미 쓰여 있음 (쿼리 불가, 저장만)
+    
+    int num_levels() const { return level_runs.max_g(); }
+    int num_stored_levels() const { return level_begin.empty() ? 0 : (int)level_begin.size() - 1; }
+    
+    int stored_level_size(int l) const { return level_begin[l + 1] - level_begin[l]; }
+    
+    int level_size(int g) const {
+        int l = level_runs.level_of(g);
+        return l < 0 ? 0 : stored_level_size(l);
+    }
+    
+    // (k,g) 노드 번호, 범위 밖이면 kNull
+    uint32_t node_at(int k, int g) const {
+        int l = level_runs.level_of(g);
+        if (l < 0 || k <= 0 || k > stored_level_size(l)) return kNull;
+        return level_begin[l] + k - 1;
+    }
+    
+    // (k,g)-core 크기를 집합을 풀지 않고 O(1)로, 범위 밖이면 0
+    size_t core_size(int k, int g) const {
+        uint32_t n = node_at(k, g);
+        return n == kNull ? 0 : core_sizes[n];
+    }
+    
+    size_t set_size(uint32_t set) const {
+        return set == kNull ? 0 : encoded_set_size(sets.data() + set);
+    }
+    
+    template <typename Out>
+    void decode_into(uint32_t set, Out& out) const {
+        if (set != kNull) decode_sorted_set(sets.data() + set, out);
+    }
+    
+    // value와 aux 집합 원소 수의 합
+    size_t stored_nodes() const {
+        size_t total = 0;
+        for (const Node& n : nodes) total += set_size(n.value);
+        for (const AuxEntry& e : aux_entries) total += set_size(e.set);
+        return total;
+    }
+    
+    std::string name(uint32_t node) const {
+        const Node& n = nodes[node];
+        if (n.k == 0) return "aux";
+        return "(" + std::to_string(n.k) + "," + std::to_string(n.g) + ")";
+    }
+    
+    size_t memory_bytes() const {
+        return sizeof(FlatIndex) + level_runs.memory_bytes() + level_begin.capacity() * sizeof(uint32_t) + nodes.capacity() * sizeof(Node)
+             + aux_entries.capacity() * sizeof(AuxEntry) + sets.capacity() + level_set_begin.capacity() * sizeof(uint32_t)
+             + core_sizes.capacity() * sizeof(uint32_t);
+    }
+};
+
+// 평평한 인덱스의 읽기 전용 뷰 (쿼리는 이것만 읽음)
+// 힙의 FlatIndex나 mmap한 인덱스 파일(MappedIndex) 어느 쪽이든 같은 쿼리 코드로 서빙
+struct FlatIndexView {
+    ArrayView<uint32_t> first_g;           // LevelRuns::first_g
+    ArrayView<uint32_t> level_begin;
+    ArrayView<FlatIndex::Node> nodes;
+    ArrayView<FlatIndex::AuxEntry> aux_entries;
+    ArrayView<uint8_t> sets;
+    ArrayView<uint32_t> core_sizes;
+    
+    FlatIndexView() = default;
+    FlatIndexView(const FlatIndex& index)
+        : first_g(index.level_runs.first_g), level_begin(index.level_begin), nodes(index.nodes),
+          aux_entries(index.aux_entries), sets(index.sets), core_sizes(index.core_sizes) {}
+    
+    int num_levels() const { return first_g.empty() ? 0 : (int)first_g[first_g.size() - 1] - 1; }
+    int num_stored_levels() const { return level_begin.empty() ? 0 : (int)level_begin.size() - 1; }
+    int stored_level_size(int l) const { return level_begin[l + 1] - level_begin[l]; }
+    int level_of(int g) const { return LevelRuns::level_of(first_g.data(), first_g.size(), g); }
+    
+    int level_size(int g) const {
+        int l = level_of(g);
+        return l < 0 ? 0 : stored_level_size(l);
+    }
+    
+    uint32_t node_at(int k, int g) const {
+        int l = level_of(g);
+        if (l < 0 || k <= 0 || k > stored_level_size(l)) return FlatIndex::kNull;
+        return level_begin[l] + k - 1;
+    }
+    
+    size_t core_size(int k, int g) const {
+        uint32_t n = node_at(k, g);
+        return n == FlatIndex::kNull ? 0 : core_sizes[n];
+    }
+    
+    size_t set_size(uint32_t set) const {
+        return set == FlatIndex::kNull ? 0 : encoded_set_size(sets.data() + set);
+    }
+    
+    template <typename Out>
+    void decode_into(uint32_t set, Out& out) const {
+        if (set != FlatIndex::kNull) decode_sorted_set(sets.data() + set, out);
+    }
+};
+
+// 인덱스 arena 안의 정렬된 노드 ID 구간을 복사 없이 보여줌 (인덱스가 살아 있는 동안만 유효)
+struct NodeSpan {
+    const int* first = nullptr;
+    size_t count = 0;
+    
+    const int* begin() const { return first; }
+    const int* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+// 쿼리 결과를 넘겨줄 형식 (뒤에서 다른 노드 집합과 바로 교집합/합집합을 하는 쪽에 맞춰 고름)
+//   Sorted  : 오름차순 uint32_t 배열 (병합 방식 교집합)
+//   Bitmap  : 노드 v는 비트 v인 밀집 비트맵 (단어별 AND/OR)
+//   Roaring : SetCodec::Roaring으로 인코딩된 압축 비트맵 (드문 결과도 작게, decode_sorted_set으로 읽음)
+enum class ResultFormat : uint8_t { Sorted, Bitmap, Roaring };
+
+const char* result_format_name(ResultFormat format);
+bool parse_result_format(const std::string& name, ResultFormat& format);
+
+// 요청한 형식으로 모은 쿼리 결과 (format에 해당하는 멤버만 채워짐)
+struct QueryOutput {
+    ResultFormat format = ResultFormat::Sorted;
+    size_t count = 0;                    // 노드 수
+    std::vector<uint32_t> sorted;
+    std::vector<uint64_t> bitmap;
+    std::vector<uint8_t> roaring;
+    
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool contains(int node) const;
+    size_t bytes() const { return sorted.size() * sizeof(uint32_t) + bitmap.size() * sizeof(uint64_t) + roaring.size(); }
+};
+
+// (k,g)-core 쿼리 결과: 원소를 모으지 않고 인덱스 안의 조각(인코딩된 집합 또는 정렬된 구간)만 가리킴
+// 조각 안에서는 오름차순, 인덱스가 살아 있는 동안만 유효 (캐시에서 빌린 조각은 keep_alive로 주인을 붙잡아 둠)
+// naive/one-level/지연 구성 결과는 조각끼리 겹치지 않아 그대로 이어 붙이면 되고,
+// jump/diagonal은 한 노드가 coreness가 바뀐 g마다 다시 나오므로 set_overlapping()으로 표시해 두고 소비할 때 비트맵으로 거름
+class CoreResult {
+public:
+    CoreResult() = default;
+    CoreResult(NodeSpan span) { add_span(span); }
+    
+    void add_set(const uint8_t* encoded);
+    void add_span(NodeSpan span);
+    void set_overlapping() { overlapping = true; }
+    void keep_alive(std::shared_ptr<const void> holder) { owner = std::move(holder); }
+    
+    // 서로 다른 노드 수 (겹치는 결과는 처음 부를 때 한 번 셈)
+    size_t size() const;
+    bool empty() const { return total == 0; }
+    size_t num_pieces() const { return pieces.size(); }
+    size_t stored_size() const { return total; }   // 조각 원소 수의 합 (겹친 만큼 size()보다 큼)
+    
+    // 원소를 블록 단위로 한 번씩 넘김 (겹치지 않으면 NodeSpan과 raw 조각은 복사 없이), block이 false를 돌려주면 멈춤
+    bool for_each_block(const std::function<bool(const int*, size_t)>& block) const;
+    
+    template <typename Visit>
+    void for_each(Visit&& visit) const {
+        for_each_block([&](const int* first, size_t count) {
+            for (size_t i = 0; i < count; i++) visit(first[i]);
+            return true;
+        });
+    }
+    
+    // 호출자가 원할 때만 모음 (sorted=false면 조각 순서 그대로)
+    std::vector<int> to_vector(bool sorted = false) const;
+    std::vector<uint32_t> to_sorted_ids() const;
+    std::vector<uint64_t> to_bitmap(size_t universe = 0) const;   // 노드 v는 비트 v, universe = 최대 ID + 1 (0이면 결과에 맞춤)
+    std::vector<uint8_t> to_roaring() const;
+    std::unordered_set<int> to_set() const;
+    
+    // 해시 집합을 거치지 않고 조각들에서 바로 요청한 형식으로
+    QueryOutput to_output(ResultFormat format, size_t universe = 0) const;
+    
+private:
+    static constexpr size_t kUnknown = SIZE_MAX;
+    
+    struct Piece {
+        const uint8_t* encoded;   // nullptr이면 span
+        NodeSpan span;
+    };
+    
+    bool for_each_piece_block(const std::function<bool(const int*, size_t)>& block) const;
+    
+    // 큰 결과 (조각 원소 수 합이 g_query_config.parallel_decode_nodes 이상): 조각들을 워커들에 나눠 풂
+    bool decode_in_parallel() const;
+    void decode_pieces_parallel(int* out) const;                  // 조각 순서대로 나란히 (겹치는 원소 포함)
+    std::vector<uint64_t> distinct_bitmap_parallel() const;       // 겹치는 조각들을 원자적 OR로 모은 비트맵
+    
+    // 정렬된 결과를 Id(int 또는 uint32_t) 배열로 (출력 배열에 바로 풂)
+    template <typename Id>
+    std::vector<Id> collect(bool sorted) const;
+    
+    std::vector<Piece> pieces;
+    size_t total = 0;
+    bool overlapping = false;
+    mutable size_t distinct = kUnknown;
+    std::shared_ptr<const void> owner;
+};
+
+struct IndexMetadata;
+
+// naive 인덱스: (g, k) -> arena 구간 표
+// 같은 core가 이어지는 g 레벨과 k는 run 하나로 저장하고, 내용이 같은 leaf는 한 번만 저장
+// 인스턴스마다 독립적이므로 여러 개를 동시에 둘 수 있음
+class NaiveIndex {
+public:
+    // 다음 g 레벨의 core들 (cores[k-1] = (k,g)-core) 추가
+    void add_level(const std::vector<std::unordered_set<int>>& cores);
+    
+    // 구성이 끝나면 중복 제거용 해시 표를 버림
+    void finish();
+    
+    // arena를 메모리에 두지 않고 구성 중인 인덱스 파일에 바로 씀 (외부 메모리 구성, add_level 전에)
+    // 이후에는 save_naive_index로 그 파일을 완성하는 것만 가능하고 쿼리는 다시 불러서
+    void stream_arena(std::shared_ptr<SectionStream> stream) { arena_stream = std::move(stream); }
+    
+    // (k,g)-core, 범위 밖이면 빈 구간
+    NodeSpan query(int k, int g) const {
+        const KRun* run = run_of(k, g);
+        return run ? NodeSpan{arena.data() + run->leaf.begin, run->leaf.size()} : NodeSpan();
+    }
+    
+    // (k,g)-core 크기 (run 표만 보므로 arena를 스트리밍한 인덱스에서도 됨)
+    size_t core_size(int k, int g) const {
+        const KRun* run = run_of(k, g);
+        return run ? run->leaf.size() : 0;
+    }
+    
+    int num_levels() const { return level_runs.max_g(); }
+    int num_stored_levels() const { return level_runs.num_stored(); }
+    
+    int level_size(int g) const {
+        int l = level_runs.level_of(g);
+        return l < 0 ? 0 : (int)level_max_k[l];
+    }
+    
+    size_t num_leaves() const { return logical_leaves; }      // 모든 (k,g) 조합 수
+    size_t stored_leaves() const { return k_runs.size(); }    // 실제 저장된 run 수
+    size_t unique_leaves() const { return unique_count; }
+    size_t stored_nodes() const;                               // 실제 저장된 노드 ID 수
+    size_t referenced_nodes() const { return referenced; }     // leaf 크기의 합 (중복 제거 전)
+    
+    size_t memory_bytes() const {
+        return sizeof(NaiveIndex) + level_runs.memory_bytes() + level_begin.capacity() * sizeof(uint32_t)
+             + level_max_k.capacity() * sizeof(uint32_t) + k_runs.capacity() * sizeof(KRun)
+             + arena.capacity() * sizeof(int);
+    }
+    
+    void print_stats() const;
+    
+    friend bool save_naive_index(const NaiveIndex& index, const IndexMetadata& metadata, const std::string& filename);
+    friend bool load_naive_index(const std::string& filename, NaiveIndex& index, IndexMetadata* metadata);
+    
+private:
+    // first_k부터 다음 run 직전까지의 k가 모두 같은 leaf
+    struct KRun {
+        uint32_t first_k;
+        FlatIndex::Range leaf;
+    };
+    
+    // k 이하에서 시작하는 마지막 run, 범위 밖이면 nullptr
+    const KRun* run_of(int k, int g) const {
+        int l = level_runs.level_of(g);
+        if (l < 0 || k <= 0 || k > (int)level_max_k[l]) return nullptr;
+        auto first = k_runs.begin() + level_begin[l];
+        auto last = k_runs.begin() + level_begin[l + 1];
+        return &*(std::upper_bound(first, last, (uint32_t)k, [](uint32_t key, const KRun& r) { return key < r.first_k; }) - 1);
+    }
+    
+    LevelRuns level_runs;                       // g -> 저장된 레벨
+    std::vector<uint32_t> level_begin{0};       // 저장된 레벨 l의 run은 k_runs[level_begin[l], level_begin[l+1])
+    std::vector<uint32_t> level_max_k;          // 저장된 레벨 l의 k 최댓값
+    std::vector<KRun> k_runs;
+    std::vector<int> arena;
+    std::shared_ptr<SectionStream> arena_stream;             // 있으면 arena는 비어 있고 노드 ID는 파일에
+    std::unordered_multimap<uint64_t, uint32_t> by_content;  // 내용 해시 -> k_runs 번호 (구성 중에만)
+    std::vector<size_t> previous_sizes;                       // 직전 g 레벨의 core 크기들 (구성 중에만)
+    size_t logical_leaves = 0;
+    size_t unique_count = 0;
+    size_t referenced = 0;
+};
+
 // 하이퍼그래프를 나타내는 클래스
 class Hypergraph {
 public:
@@ -42,9 +452,53 @@ public:
     
     // 전체 하이퍼엣지들의 리스트
     std::vector<std::unordered_set<int>> E;
-    
+
+    // 쌍둥이 노드 축약 정보: 대표 노드 -> 같은 하이퍼엣지 집합을 갖는 원본 노드들 (대표 포함)
+    // 축약되지 않은 노드는 들어 있지 않음 (가중치 1)
+    std::unordered_map<int, std::vector<int>> twins;
+
+    // 압축된 노드 ID -> 원본 노드 ID (비어 있으면 ID가 원본 그대로)
+    // 커널들이 노드 ID 크기의 밀집 배열을 쓰므로 인덱스 구성용 그래프는 0..n-1로 다시 번호를 매김
+    std::vector<int> original_ids;
+
     // 생성자
     Hypergraph() = default;
+
+    // 노드 v가 대표하는 원본 노드 수
+    int weight(int v) const {
+        auto it = twins.find(v);
+        return it == twins.end() ? 1 : (int)it->second.size();
+    }
+
+    // 원본 노드 수 (축약 전 기준)
+    int total_weight() const {
+        int total = (int)node_hyperedges.size();
+        for (const auto& pair : twins) {
+            total += (int)pair.second.size() - 1;
+        }
+        return total;
+    }
+
+    // v의 쌍둥이들은 v와 deg(v)개의 하이퍼엣지를 공유하므로, deg(v) >= g이면 서로 유효한 이웃
+    int twin_neighbors(int v, int g) const {
+        int w = weight(v);
+        if (w <= 1) return 0;
+        return (int)node_hyperedges.at(v).size() >= g ? w - 1 : 0;
+    }
+
+    int original_id(int v) const {
+        return original_ids.empty() ? v : original_ids[v];
+    }
+
+    // 대표 노드 v를 원본 노드들로 펼쳐서 out에 추가 (twins에는 원본 ID가 들어 있음)
+    void expand_into(int v, std::unordered_set<int>& out) const {
+        auto it = twins.find(v);
+        if (it == twins.end()) {
+            out.insert(original_id(v));
+        } else {
+            out.insert(it->second.begin(), it->second.end());
+        }
+    }
     
     // 노드 추가
     void add_node(int node) {
@@ -77,16 +531,132 @@ public:
     }
 };
   
+// 정렬된 노드 ID 배열의 교집합/차집합 커널 (실행 시점에 CPU가 지원하는 가장 넓은 SIMD 선택)
+// 크기가 비슷하면 SIMD 블록 병합, 한쪽이 훨씬 작으면 갤로핑 탐색
+enum class SetKernel { Auto, Scalar, SSE41, AVX2 };
+
+// 커널 강제 지정 (CPU가 지원하지 않으면 false), Auto면 가장 넓은 것
+bool select_set_kernel(SetKernel kernel);
+SetKernel active_set_kernel();
+bool set_kernel_supported(SetKernel kernel);
+const char* set_kernel_name(SetKernel kernel);
+
+// out = a ∩ b / a \ b (a, b는 오름차순, 중복 없음, out은 덮어씀)
+void sorted_intersection(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& out);
+void sorted_difference(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& out);
+
+std::vector<int> set_intersection(const std::vector<int>& set1, const std::vector<int>& set2);
+std::vector<int> set_difference(const std::vector<int>& set1, const std::vector<int>& set2);
+
+// 작업 훔치기(work-stealing) 태스크 런타임
+// 워커마다 deque를 두고 자기 것은 뒤에서(LIFO), 남의 것은 앞에서(FIFO) 꺼내 실행
+// 호출한 스레드(main)가 워커 0이며, join 중에도 대기 태스크를 대신 실행하므로 중첩 병렬도 교착되지 않음
+class TaskRuntime {
+public:
+    explicit TaskRuntime(int num_threads);
+    ~TaskRuntime();
+    
+    int num_workers() const;
+    
+    // 현재 워커의 deque에 태스크 추가
+    void submit(std::function<void()> task);
+    
+    // 대기 중인 태스크 하나를 현재 스레드에서 실행 (없으면 false)
+    bool run_one();
+    
+    // 실행할 태스크가 없을 때: pending이 0이 되거나 새 태스크가 들어올 때까지 워커처럼 잠듦 (기한 없음)
+    // pending을 0으로 만든 쪽은 반드시 그 뒤에 notify_idle을 부름
+    void park(const std::atomic<int>& pending);
+    void notify_idle();
+    
+    // [begin, end)를 body(b, e) 조각으로 나눠 실행하고 모두 끝날 때까지 대기
+    // 남의 deque가 비어 있을 때만 남은 범위를 반으로 쪼개 내놓으므로 조각 크기가 부하에 맞춰 조절됨
+    // grain <= 0이면 범위 / (워커 수 * 8)
+    void parallel_for(int begin, int end, const std::function<void(int, int)>& body, int grain = 0);
+    
+    // 워커별 사용률 통계
+    void reset_stats();
+    void print_utilization(const std::string& label) const;
+    
+    struct Impl;
+    
+private:
+    std::unique_ptr<Impl> impl;
+};
+
+// 태스크 묶음: run으로 추가하고 wait으로 모두 끝날 때까지 대기 (태스크 예외는 wait에서 다시 던짐)
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskRuntime& runtime) : runtime(runtime) {}
+    ~TaskGroup();
+    
+    void run(std::function<void()> task);
+    void wait();
+    
+private:
+    TaskRuntime& runtime;
+    std::atomic<int> pending{0};
+    std::exception_ptr error;
+    std::atomic<bool> has_error{false};
+};
+
+// --threads로 한 번 설정 (0 이하면 하드웨어 스레드 수)
+void init_task_runtime(int num_threads);
+
+// 전역 런타임 (init 전이면 하드웨어 스레드 수로 생성)
+TaskRuntime& task_runtime();
+
 // 헤더 파일 (.h 또는 .hpp)에 추가
 int count_valid_neighbors_with_bitmap(const Hypergraph& hypergraph, int v, int g, 
                                      const std::vector<bool>& active_nodes, int max_node);
 
+// 해시맵 대신 스레드별 밀집 카운터 배열을 쓰는 버전 (use_epoch면 리셋 없이 epoch stamp로 구분)
+int count_valid_neighbors_dense(const Hypergraph& hypergraph, int v, int g,
+                                const std::vector<bool>& active_nodes, int max_node, bool use_epoch = false);
+
+// 작은 g 특수화 커널(g=1 비트셋, g=2/3 8비트 카운터)로 모든 노드가 활성일 때의 유효 이웃 수 합 (벤치마크용)
+long long sum_valid_neighbors_small_g(const Hypergraph& hypergraph, const std::vector<int>& nodes, int g, int rounds);
+
 void add_neighbors_to_T_list(const Hypergraph& hypergraph, int v, 
                             std::vector<int>& nodes_to_add, int max_node);
 
 // 함수 선언들
 Hypergraph load_hypergraph(const std::string& file_path);
 
+// 같은 하이퍼엣지 집합에 속한 노드들(쌍둥이)을 가중치 있는 대표 노드 하나로 축약 (결과는 압축 ID)
+Hypergraph contract_twin_nodes(const Hypergraph& hypergraph);
+
+// 노드 ID를 원본 ID 순서대로 0..n-1로 다시 매김 (original_ids로 되돌림)
+Hypergraph compact_node_ids(const Hypergraph& hypergraph);
+
+// 인덱스 구성 옵션 (main에서 한 번 설정)
+struct BuildConfig {
+    bool partition_components = true;   // 연결 요소별로 나눠서 분해
+    int component_batch_nodes = 4096;   // 이보다 작은 요소들은 하나의 파티션으로 묶음
+    SetCodec leaf_codec = SetCodec::Auto;  // 평평한 인덱스의 value/aux 집합 인코딩
+    size_t memory_budget_kb = 0;        // 구성 중 RSS 상한 (0이면 없음): 레벨을 파일로 흘려 보내고 남은 예산만큼만 동시에 peeling, 못 지키면 예외
+    std::string spill_dir;              // 내린 레벨을 둘 디렉터리 (비어 있으면 /tmp)
+    std::string checkpoint_dir;         // 비어 있지 않으면 끝난 g 레벨마다 체크포인트 기록
+    bool resume = false;                // 체크포인트가 같은 하이퍼그래프에서 나온 것이면 기록된 레벨은 다시 계산하지 않음
+    std::string shard_dir;              // 비어 있지 않으면 레벨을 계산하지 않고 이 디렉터리의 레벨 샤드에서 읽음 (분산 구성 병합)
+};
+
+extern BuildConfig g_build_config;
+
+// 연결 요소 단위로 나눈 하이퍼그래프 (큰 요소는 단독, 작은 요소들은 묶어서 하나의 파티션)
+// (k,g)-core는 연결 요소별 core의 합집합이므로 파티션별 결과를 g 레벨마다 합치면 됨
+struct ComponentPartition {
+    std::vector<Hypergraph> parts;
+    std::vector<std::atomic<int>> exhausted_from;  // (1,g)-core가 처음 빈 g (이후 g에서 더 볼 필요 없음), 없으면 INT_MAX
+    int num_components = 0;
+    int giant_component_nodes = 0;
+};
+
+ComponentPartition partition_by_components(const Hypergraph& hypergraph, int batch_nodes);
+
+// 파티션별로 병렬 계산 후 k 인덱스별로 합침 (shells=true면 enumerate_1_g, 아니면 enumerate_kg_core_fixing_g)
+std::vector<std::unordered_set<int>> enumerate_by_components(ComponentPartition& partition, int g, bool shells);
+
 std::unordered_map<int, int> neighbour_count_map(const Hypergraph& hypergraph, int v, int g);
 
 std::unordered_set<int> get_neighbour(const Hypergraph& hypergraph, int v);
@@ -99,18 +669,109 @@ std::unordered_set<int> kg_core_peeling(const Hypergraph& hypergraph, int k, int
 
 std::vector<std::unordered_set<int>> enumerate_kg_core_fixing_g(const Hypergraph& hypergraph, int g);
 
-std::shared_ptr<TreeNode> naive_index_construction(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E);
+NaiveIndex naive_index_construction(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E);
 
 std::vector<std::unordered_set<int>> enumerate_1_g(const Hypergraph& hypergraph, int g);
 
 std::shared_ptr<TreeNode> one_level_compression(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E);
 
+// 지연 구성 인덱스 (--lazy): 전체 인덱스를 미리 만들지 않고 쿼리가 닿은 g 레벨만 그때 분해해서 캐시
+// 레벨은 shell들을 k 순서로 이어 붙인 배열이라 (k,g)-core는 k번째 shell부터 끝까지의 연속 구간 (결과는 shell마다 조각 하나)
+// 같은 g를 동시에 요청하면 한 스레드만 구성하고 나머지는 그 결과를 기다림 (실패하면 다음 요청이 다시 구성)
+// 캐시된 레벨은 capacity_bytes(0이면 무제한) 안에서 LRU로 내보냄, 쿼리가 들고 있는 레벨은 내보내도 유효
+class LazyLevelIndex {
+public:
+    struct Level {
+        std::vector<int> nodes;         // shell마다 정렬, k 순서로 이어 붙임
+        std::vector<uint32_t> starts;   // starts[k-1] = k번째 shell의 시작, 마지막 원소는 nodes.size()
+        
+        int max_k() const { return starts.empty() ? 0 : (int)starts.size() - 1; }
+        size_t bytes() const { return nodes.capacity() * sizeof(int) + starts.capacity() * sizeof(uint32_t); }
+    };
+    
+    struct Stats {
+        size_t builds = 0;       // 실제로 분해한 레벨 수
+        size_t hits = 0;         // 캐시에서 바로 꺼낸 요청
+        size_t waits = 0;        // 다른 스레드의 구성을 기다린 요청
+        size_t evictions = 0;
+        size_t cached_levels = 0;
+        size_t cached_bytes = 0;
+        double build_seconds = 0.0;
+    };
+    
+    LazyLevelIndex(const Hypergraph& hypergraph, size_t capacity_bytes);
+    
+    // g 레벨 (없으면 구성), g가 범위 밖이면 빈 레벨
+    std::shared_ptr<const Level> level(int g);
+    CoreResult query(int k, int g);    // 레벨을 붙잡아 두므로 내보내진 뒤에도 유효
+    
+    CoreResult shell(int k, int g);    // (k,g)-core \ (k+1,g)-core = 레벨의 k번째 구간 하나
+    size_t core_size(int k, int g);    // 레벨이 캐시에 있으면 O(1) (없으면 구성)
+    
+    // 캐시에 있는지만 확인 (구성하지 않음)
+    bool cached(int g) const;
+    int max_g() const { return max_degree; }
+    Stats stats() const;
+    
+private:
+    struct Entry {
+        std::shared_future<std::shared_ptr<const Level>> ready;
+        bool built = false;                // false면 구성 중
+        std::list<int>::iterator position; // built일 때 lru 안의 위치
+    };
+    
+    std::shared_ptr<const Level> build(int g);
+    void evict_locked();
+    
+    const Hypergraph& hypergraph;
+    ComponentPartition partition;
+    size_t capacity_bytes;
+    int max_degree = 0;                    // g가 이보다 크면 (1,g)-core가 빔
+    
+    mutable std::mutex mutex;
+    std::unordered_map<int, Entry> entries;
+    std::list<int> lru;                    // 앞쪽이 최근에 쓴 레벨
+    Stats counters;
+};
+
+// 분산 구성: 코디네이터가 g 구간을 워커 프로세스들에 나눠 주고 (유닉스 소켓), 워커는 하이퍼그래프 스냅샷을 읽어
+// 구간의 레벨들을 샤드 파일(dir/<kind>_<첫 g>.shard, kind는 naive용 "cores" 또는 one-level/jump/diagonal용 "shells")로 씀
+// 병합은 g_build_config.shard_dir을 설정하고 보통의 구성 함수를 부르면 됨: 레벨을 g 순서대로 읽으므로
+// run 병합과 샤드 경계를 넘는 jump/diagonal 포인터는 한 번에 구성할 때와 같이 만들어짐
+std::string level_shard_path(const std::string& dir, const std::string& kind, int g_begin);
+
+// [g_begin, g_end) 레벨을 계산해서 샤드로 씀, 반환값은 처음 빈 g (없으면 g_end), 실패하면 -1
+int build_level_shard(const Hypergraph& hypergraph, const std::string& kind, int g_begin, int g_end, const std::string& filename);
+
+// 분산 구성이 나눠 줄 g의 상한 (미포함): 처음 빈 레벨(최대 차수 + 1)까지 들어가게 최대 차수 + 2, 하이퍼엣지 수로 자름
+int level_shard_bound(const Hypergraph& hypergraph);
+
+struct DistributedOptions {
+    int workers = 2;
+    int levels_per_job = 8;                  // 한 번에 나눠 주는 g 구간 길이
+    std::string shard_dir;
+    std::vector<std::string> worker_args;    // 워커에 그대로 넘길 구성 옵션 (--threads= 등)
+};
+
+// 코디네이터: 스냅샷을 shard_dir에 쓰고 워커들을 띄워 kinds의 샤드를 모두 만들 때까지 구간을 나눠 줌
+bool run_distributed_levels(const Hypergraph& index_graph, const std::vector<std::string>& kinds, const DistributedOptions& options);
+
+// 워커: 코디네이터에 접속해서 받은 구간마다 build_level_shard (종료 코드 반환)
+int run_level_worker(const std::string& socket_path, const Hypergraph& hypergraph, const std::string& shard_dir);
+
+// 외부 메모리 구성: 끝난 g 레벨을 바로 인코딩해서 filename에 붙이고 메모리에서 버림
+// 결과 파일은 naive_index_construction / one_level_compression을 save한 것과 같은 내용 (load_*_index, MappedIndex로 읽음)
+bool build_naive_index_file(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E,
+                            const std::string& filename, IndexMetadata metadata);
+bool build_one_level_index_file(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E,
+                                const std::string& filename, IndexMetadata metadata);
+
 std::pair<std::shared_ptr<TreeNode>, double> jump_compression(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E);
 
 std::tuple<std::shared_ptr<TreeNode>, double, double> diagonal_compression(const Hypergraph& hypergraph, const std::vector<std::unordered_set<int>>& E);
 
 // 쿼리 함수들
-const std::unordered_set<int>& querying_for_naive_index(const std::shared_ptr<TreeNode>& tree, int k, int g);
+NodeSpan querying_for_naive_index(const NaiveIndex& index, int k, int g);
 
 std::unordered_set<int> querying_for_one_level(const std::shared_ptr<TreeNode>& tree, int k, int g);
 
@@ -118,11 +779,117 @@ std::unordered_set<int> querying_for_two_level(const std::shared_ptr<TreeNode>&
 
 std::unordered_set<int> querying_for_diagonal(const std::shared_ptr<TreeNode>& tree, int k, int g);
 
+// 트리 루트의 g -> 저장된 레벨 (children 번호), 범위 밖이면 -1
+int tree_level_of(const std::shared_ptr<TreeNode>& tree, int g);
+
+// 트리가 답할 수 있는 최대 g (run으로 합쳐진 레벨 포함)
+int tree_max_g(const std::shared_ptr<TreeNode>& tree);
+
+// 포인터 트리를 평평한 레이아웃으로 변환 (트리는 그대로 둠)
+FlatIndex flatten_index(const std::shared_ptr<TreeNode>& tree);
+
+// 쿼리 옵션 (main에서 한 번 설정)
+struct QueryConfig {
+    size_t parallel_decode_nodes = 1 << 16;  // 결과 조각 원소 수 합이 이 이상이면 조각들을 병렬로 풂 (0이면 항상 단일 스레드)
+};
+
+extern QueryConfig g_query_config;
+
+// 평평한 레이아웃에서의 같은 쿼리들 (FlatIndex는 뷰로 바로 넘길 수 있음)
+// 결과는 인덱스의 집합들을 가리키기만 하므로 비용은 조각 수에 비례, 원소는 소비할 때 풀림
+CoreResult querying_for_one_level(const FlatIndexView& index, int k, int g);
+
+CoreResult querying_for_two_level(const FlatIndexView& index, int k, int g);
+
+CoreResult querying_for_diagonal(const FlatIndexView& index, int k, int g);
+
+// 결과 형식을 지정하는 버전 (universe는 Bitmap 크기, 0이면 결과의 최대 노드에 맞춤)
+QueryOutput querying_for_one_level(const FlatIndexView& index, int k, int g, ResultFormat format, size_t universe = 0);
+
+QueryOutput querying_for_two_level(const FlatIndexView& index, int k, int g, ResultFormat format, size_t universe = 0);
+
+QueryOutput querying_for_diagonal(const FlatIndexView& index, int k, int g, ResultFormat format, size_t universe = 0);
+
+// (k,g)-shell = (k,g)-core \ (k+1,g)-core
+// one-level은 (k,g) leaf 하나, jump는 (k,g')들의 값에서 (k+1,g)-core를 뺀 것, diagonal은 두 core의 차
+// 크기만 필요하면 core_size(k,g) - core_size(k+1,g)
+CoreResult querying_shell_for_naive_index(const NaiveIndex& index, int k, int g);
+
+CoreResult querying_shell_for_one_level(const FlatIndexView& index, int k, int g);
+
+CoreResult querying_shell_for_two_level(const FlatIndexView& index, int k, int g);
+
+CoreResult querying_shell_for_diagonal(const FlatIndexView& index, int k, int g);
+
 std::unordered_set<int> kg_core(const Hypergraph& hypergraph, int k, int g);
 
+// 배치 쿼리: 쿼리들을 태스크 런타임으로 병렬 실행 (query는 인덱스를 묶어 둔 (k, g) -> core 함수)
+using QueryFunction = std::function<CoreResult(int, int)>;
+
+std::vector<CoreResult> run_query_batch(const std::vector<std::pair<int, int>>& queries,
+                                        const QueryFunction& query);
+
+// 각 결과를 워커 안에서 바로 요청한 형식으로 모음
+std::vector<QueryOutput> run_query_batch(const std::vector<std::pair<int, int>>& queries,
+                                         const QueryFunction& query, ResultFormat format, size_t universe = 0);
+
+// 탐색을 공유하는 배치 쿼리: g로 묶어 k 순으로 정렬한 뒤 g마다 체인을 한 번만 따라가며 풀고,
+// 각 결과는 그 공유 버퍼 위의 구간들 (results[i]는 queries[i]의 결과, 버퍼는 결과들이 붙잡고 있음)
+std::vector<CoreResult> querying_batch_for_one_level(const FlatIndexView& index, const std::vector<std::pair<int, int>>& queries);
+
+std::vector<CoreResult> querying_batch_for_two_level(const FlatIndexView& index, const std::vector<std::pair<int, int>>& queries);
+
+std::vector<CoreResult> querying_batch_for_diagonal(const FlatIndexView& index, const std::vector<std::pair<int, int>>& queries);
+
+// 직사각형 sweep의 한 걸음: 이번 (k,g)-core = 직전 core ∪ added \ removed (첫 걸음은 added가 core 전체)
+// added/removed는 인덱스 집합을 가리키므로 인덱스가 살아 있는 동안만 유효
+struct CoreDelta {
+    int k = 0;
+    int g = 0;
+    CoreResult added;
+    CoreResult removed;
+    size_t size = 0;   // 이 걸음 뒤의 core 크기 (크기 표에서)
+};
+
+using DeltaSink = std::function<bool(const CoreDelta&)>;
+
+// k ∈ [k1,k2] × g ∈ [g1,g2]를 포함 관계를 따라 뱀 모양으로 훑음 (모든 걸음이 더하기만 하거나 빼기만 함)
+//   g 행 안의 k 걸음 : one-level leaf 하나 ((k,g)-shell)
+//   행 끝의 g 걸음   : jump 레벨 값들 중 (k,g+1)-core 밖의 노드
+// sink가 false를 돌려주면 멈추고 false
+bool sweep_core_deltas(const FlatIndexView& one_level, const FlatIndexView& jump, int k1, int k2, int g1, int g2,
+                       const DeltaSink& sink);
+
+// (k,g)-core들의 합/교/차 식 (피연산자는 (k,g), 연산은 공유 포인터로 이어 붙인 트리)
+struct CoreExpr {
+    enum class Op : uint8_t { Core, Union, Intersection, Difference };
+    
+    Op op = Op::Core;
+    int k = 0;                                       // Op::Core
+    int g = 0;
+    std::shared_ptr<const CoreExpr> left, right;     // 나머지 연산
+    
+    static CoreExpr core(int k, int g);
+};
+
+CoreExpr operator|(const CoreExpr& a, const CoreExpr& b);   // 합집합
+CoreExpr operator&(const CoreExpr& a, const CoreExpr& b);   // 교집합
+CoreExpr operator-(const CoreExpr& a, const CoreExpr& b);   // 차집합
+
+// "(2,3) & (3,1) - ((4,3) | (5,1))" 형태 (&가 |, -보다 먼저, 같은 순위는 왼쪽부터)
+bool parse_core_expr(const std::string& text, CoreExpr& expr);
+std::string core_expr_text(const CoreExpr& expr);
+
+// one-level 인덱스의 셸 구조 위에서 식을 계산
+// core끼리의 포함 관계((k1,g1) ⊆ (k2,g2) ⇔ k1 >= k2, g1 >= g2)와 같은 g의 셸 구간으로 줄일 수 있는 부분은 풀지 않고,
+// 그렇지 않은 부분만 정렬된 배열로 풀어 병합 (결과는 가능하면 인덱스 조각을 그대로 가리킴)
+CoreResult evaluate_core_expr(const FlatIndexView& one_level, const CoreExpr& expr);
+
 // 유틸리티 함수들
 int count_total_nodes(const std::shared_ptr<TreeNode>& tree, const std::string& type);
 
+int count_total_nodes(const FlatIndex& index, const std::string& type);
+
 std::map<int, int> count_each_nodes(const std::shared_ptr<TreeNode>& tree, const std::string& type);
 
 std::map<int, int> count_empty_leaf(const std::shared_ptr<TreeNode>& tree);
@@ -148,16 +915,161 @@ struct IndexMetadata {
     std::string creation_time;
     std::string hypergraph_filename;
     std::string compression_type;  // "naive", "one_level", "jump", "diagonal"
-    int num_nodes;
-    int num_hyperedges;
-    int max_g_level;
-    double construction_time;
-    size_t file_size_bytes;
+    int num_nodes = 0;
+    int num_hyperedges = 0;
+    int max_g_level = 0;
+    double construction_time = 0.0;
+    size_t file_size_bytes = 0;
+    uint64_t graph_checksum = 0;   // 만든 하이퍼그래프의 hypergraph_checksum (0이면 모름)
 };
 
 bool save_metadata(const IndexMetadata& metadata, const std::string& filename);
 IndexMetadata load_metadata(const std::string& filename);
 
+// 바이너리 인덱스 파일: 버전 있는 리틀 엔디언 섹션 형식, 섹션마다 체크섬
+// 섹션 하나를 벡터 하나로 한 번에 읽으므로 원소마다 할당하지 않음 (읽기 시간은 파일 크기에 비례)
+bool save_flat_index(const FlatIndex& index, const IndexMetadata& metadata, const std::string& filename);
+bool load_flat_index(const std::string& filename, FlatIndex& index, IndexMetadata* metadata = nullptr);
+
+bool save_naive_index(const NaiveIndex& index, const IndexMetadata& metadata, const std::string& filename);
+bool load_naive_index(const std::string& filename, NaiveIndex& index, IndexMetadata* metadata = nullptr);
+
+// 구성 중인 인덱스 파일의 가장 큰 섹션(naive arena, 평평한 인덱스의 집합들)을 버퍼 하나 크기씩 바로 파일에 씀
+// 헤더와 섹션 표 자리를 앞에 비워 두고, save_*_index가 나머지 섹션을 뒤에 붙이고 앞을 채운 뒤 이름을 바꿈
+class SectionStream {
+public:
+    static constexpr uint64_t kStart = 4096;  // 섹션 본문 시작 (헤더 + 섹션 표 127개까지)
+    
+    SectionStream() = default;
+    SectionStream(const SectionStream&) = delete;
+    SectionStream& operator=(const SectionStream&) = delete;
+    ~SectionStream();                           // 완성되지 않았으면 임시 파일 삭제
+    
+    bool open(const std::string& filename);     // filename.tmp에 씀
+    bool append(const void* data, size_t size);
+    bool pad(size_t size);                      // 0 바이트 size개
+    bool read(uint64_t position, void* out, size_t size);  // 이미 쓴 구간 (섹션 안 위치)
+    bool flush();
+    
+    uint64_t size() const { return written + buffer.size(); }
+    bool failed() const { return error; }
+    const std::string& target() const { return filename; }
+    int descriptor() const { return fd; }
+    void release() { committed = true; }        // 이름을 바꿔 완성한 뒤
+    
+private:
+    std::string filename;
+    int fd = -1;
+    uint64_t written = 0;
+    std::vector<uint8_t> buffer;
+    bool error = false;
+    bool committed = false;
+};
+
+// 레벨 하나의 집합 구간(size 바이트)을 집합 섹션의 position에 놓기 전에 넣을 0 바이트 수
+// 페이지 경계에 걸치는 큰 구간(1/4 페이지 이상)은 새 페이지에서 시작
+size_t level_group_padding(size_t position, size_t size);
+
+// 인덱스 파일의 메타데이터만 읽음 (없거나 손상되었으면 false)
+bool read_index_metadata(const std::string& filename, IndexMetadata& metadata);
+
+// 하이퍼그래프 스냅샷: 인덱스 파일과 같은 섹션 형식 (하이퍼엣지 블록들, 쌍둥이 축약 정보, 원본 ID)
+// 텍스트 파싱 없이 읽고, 블록마다 도착하는 대로 하이퍼엣지 집합을 만들어 남은 읽기와 겹침
+bool save_hypergraph_snapshot(const Hypergraph& hypergraph, const std::string& filename);
+bool load_hypergraph_snapshot(const std::string& filename, Hypergraph& hypergraph);
+
+// 하이퍼그래프 내용 체크섬 (하이퍼엣지 순서와 무관, 쌍둥이 가중치와 원본 ID 포함)
+uint64_t hypergraph_checksum(const Hypergraph& hypergraph);
+
+// g 레벨 체크포인트: 끝난 레벨의 집합들을 파일 끝에 붙이고 레벨마다 동기화 (긴 구성을 끊긴 곳부터 재개)
+// 기록마다 체크섬이 있어 쓰다 끊긴 마지막 기록은 버림, 입력 체크섬이 다르면 새로 시작
+// 분산 구성의 레벨 샤드도 같은 형식 (first_g부터의 레벨, 처음 빈 레벨은 집합 없는 기록으로 남김)
+class LevelCheckpoint {
+public:
+    LevelCheckpoint() = default;
+    LevelCheckpoint(const LevelCheckpoint&) = delete;
+    LevelCheckpoint& operator=(const LevelCheckpoint&) = delete;
+    ~LevelCheckpoint();
+    
+    // resume이면 기존 기록을 확인해서 이어 쓰고, 아니면 비우고 시작
+    bool open(const std::string& filename, uint64_t input_checksum, bool resume, int first_g = 1);
+    
+    int first() const { return first_g; }
+    int completed() const { return (int)records.size(); }   // 기록된 레벨 g = first()..first()+completed()-1
+    bool read_level(int g, std::vector<std::unordered_set<int>>& level);
+    bool append_level(int g, const std::vector<std::unordered_set<int>>& level);
+    void remove();                                           // 구성이 끝나면 파일 삭제
+    
+private:
+    std::string filename;
+    int fd = -1;
+    int first_g = 1;
+    std::vector<uint64_t> records;   // 레벨마다 기록 시작 오프셋
+    uint64_t end = 0;
+};
+
+// 파일 구간 읽기 백엔드: io_uring이면 큰 읽기들을 큐 깊이를 두고 한꺼번에, 아니면 pread로 차례대로
+enum class IoBackend { Auto, Uring, Pread };
+
+// 백엔드 강제 지정 (커널이 io_uring을 지원하지 않으면 false), Auto면 가능한 것 중 io_uring 우선
+bool select_io_backend(IoBackend backend);
+IoBackend active_io_backend();
+bool io_backend_supported(IoBackend backend);
+const char* io_backend_name(IoBackend backend);
+bool parse_io_backend(const std::string& name, IoBackend& backend);
+
+struct ReadRange {
+    uint64_t offset;
+    uint64_t size;
+    void* dest;
+};
+
+// 구간들을 읽어 dest를 채우고, 구간 하나가 다 차면 on_ready(구간 번호) 호출 (완료 순서, false면 중단)
+bool read_file_ranges(const std::string& filename, const std::vector<ReadRange>& ranges,
+                      const std::function<bool(size_t)>& on_ready);
+
+// mmap 접근 패턴 힌트 (madvise)
+enum class MapAdvice { Normal, Random, Sequential, WillNeed };
+
+struct MapOptions {
+    MapAdvice advice = MapAdvice::Random;  // 쿼리는 몇 개 g 레벨만 건드리므로 기본은 미리 읽기 없음
+    bool huge_pages = false;               // MADV_HUGEPAGE (파일 THP를 지원하는 커널에서만 효과)
+    bool verify_checksums = false;         // 열 때 모든 섹션 체크섬 확인 (파일 전체를 읽게 됨)
+};
+
+bool parse_map_advice(const std::string& name, MapAdvice& advice);
+
+// 평평한 인덱스 파일을 읽기 전용 mmap으로 그대로 서빙
+// 집합들은 파일 안에서 저장된 레벨마다 모여 있고 큰 레벨은 페이지 경계에서 시작하므로
+// 쿼리가 닿은 g 레벨의 페이지만 읽히고, 같은 파일을 연 프로세스들은 페이지 캐시를 공유
+class MappedIndex {
+public:
+    MappedIndex() = default;
+    ~MappedIndex() { close(); }
+    MappedIndex(const MappedIndex&) = delete;
+    MappedIndex& operator=(const MappedIndex&) = delete;
+    
+    bool open(const std::string& filename, const MapOptions& options = MapOptions());
+    void close();
+    
+    bool is_open() const { return base != nullptr; }
+    const FlatIndexView& view() const { return index; }
+    const IndexMetadata& metadata() const { return meta; }
+    
+    // g 레벨의 집합 페이지들에 힌트 (WillNeed면 미리 읽기 시작)
+    void advise_level(int g, MapAdvice advice) const;
+    
+    size_t mapped_bytes() const { return length; }
+    size_t resident_bytes() const;   // 지금 페이지 캐시에서 매핑된 바이트 (mincore)
+    
+private:
+    void* base = nullptr;
+    size_t length = 0;
+    FlatIndexView index;
+    ArrayView<uint32_t> level_set_begin;
+    IndexMetadata meta;
+};
+
 // CSV 결과 로깅 함수들
 void log_construction_result(const std::string& index_type, 
                            double construction_time,
@@ -173,6 +1085,8 @@ void log_query_result(const std::string& index_type,
 // 유틸리티 함수들
 std::string get_current_time_string();
 size_t get_file_size(const std::string& filename);
+size_t get_memory_usage_kb();        // 현재 RSS
+size_t get_peak_memory_usage_kb();   // 최대 RSS
 bool save_complete_index(const std::shared_ptr<TreeNode>& tree, 
                         const std::string& base_filename,
                         const std::string& compression_type,
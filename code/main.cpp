@@ -11,36 +11,9 @@
 #include <random>       // 랜덤 선택용
 #include <cmath>        // std::round용 추가
 #include <chrono>       // std::chrono용 추가  
-// 메모리 사용량 측정 함수들
-size_t get_memory_usage_kb() {
-    std::ifstream file("/proc/self/status");
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.substr(0, 6) == "VmRSS:") {
-            std::istringstream iss(line);
-            std::string label;
-            size_t memory_kb;
-            iss >> label >> memory_kb;
-            return memory_kb;
-        }
-    }
-    return 0;
-}
-
-size_t get_peak_memory_usage_kb() {
-    std::ifstream file("/proc/self/status");
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.substr(0, 9) == "VmHWM:") {
-            std::istringstream iss(line);
-            std::string label;
-            size_t memory_kb;
-            iss >> label >> memory_kb;
-            return memory_kb;
-        }
-    }
-    return 0;
-}
+#include <functional>   // std::function용
+#include <fcntl.h>      // posix_fadvise (콜드 로드 벤치마크)
+#include <thread>       // 분산 구성 워커 스레드 수
 
 std::string format_memory(size_t kb) {
     if (kb < 1024) {
@@ -52,6 +25,53 @@ std::string format_memory(size_t kb) {
     }
 }
 
+// "512M", "2G", "800000K", "1048576" (바이트) -> KB
+bool parse_memory_size(const std::string& text, size_t& kb) {
+    size_t end = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(text, &end);
+    } catch (const std::exception&) {
+        return false;
+    }
+    std::string unit = text.substr(end);
+    double scale = unit.empty() || unit == "B" ? 1.0 / 1024
+                 : unit == "K" || unit == "KB" ? 1.0
+                 : unit == "M" || unit == "MB" ? 1024.0
+                 : unit == "G" || unit == "GB" ? 1024.0 * 1024 : -1.0;
+    if (scale < 0 || value <= 0) return false;
+    kb = (size_t)(value * scale);
+    return kb > 0;
+}
+
+// 인덱스 파일에 기록하는 메타데이터 (불러올 때 같은 하이퍼그래프로 만든 것인지 확인하는 데 씀)
+IndexMetadata make_index_metadata(const std::string& type, const std::string& hypergraph_file,
+                                  const Hypergraph& index_graph, double construction_time) {
+    IndexMetadata metadata;
+    metadata.creation_time = get_current_time_string();
+    metadata.hypergraph_filename = hypergraph_file;
+    metadata.compression_type = type;
+    metadata.num_nodes = index_graph.node_hyperedges.size();
+    metadata.num_hyperedges = index_graph.E.size();
+    metadata.construction_time = construction_time;
+    metadata.graph_checksum = hypergraph_checksum(index_graph);
+    return metadata;
+}
+
+// 메모리 예산을 둔 구성: 구성 중 최대 RSS(get_peak_memory_usage_kb)를 예산과 비교, 넘었으면 false
+bool report_memory_budget(size_t peak_kb) {
+    size_t budget_kb = g_build_config.memory_budget_kb;
+    if (budget_kb == 0) return true;
+    if (peak_kb > budget_kb) {
+        std::cerr << "❌ Peak RSS during construction " << format_memory(peak_kb) << " exceeded the memory budget "
+                  << format_memory(budget_kb) << std::endl;
+        return false;
+    }
+    std::cout << "   📉 Peak RSS during construction: " << format_memory(peak_kb) << " (budget "
+              << format_memory(budget_kb) << ") ✅" << std::endl;
+    return true;
+}
+
 size_t tree_memory(const std::shared_ptr<TreeNode>& tree) {
     if (!tree) return 0;
     
@@ -63,16 +83,24 @@ size_t tree_memory(const std::shared_ptr<TreeNode>& tree) {
     // name 문자열
     total_size += tree->name.capacity();
     
-    // value set의 크기 - 노드 수 기준으로만 계산
-    total_size += tree->value.size() * sizeof(int);
+    // value set의 크기 - 평평한 인덱스에 저장될 인코딩 바이트 수
+    SetCodec codec = g_build_config.leaf_codec;
+    const auto& value = tree->value;
+    if (!value.empty()) {
+        total_size += encoded_set_bytes(value.data(), value.data() + value.size(), codec);
+    }
     
-    // aux map의 크기 - 노드 수 기준으로만 계산
+    // aux map의 크기 - 마찬가지로 인코딩 바이트 수
     for (const auto& aux_pair : tree->aux) {
-        total_size += aux_pair.second.size() * sizeof(int); // value set의 노드들
+        const auto& set = aux_pair.second;
+        if (!set.empty()) {
+            total_size += encoded_set_bytes(set.data(), set.data() + set.size(), codec);
+        }
     }
     
-    // children의 크기
+    // children의 크기 (같은 core가 이어지는 g 레벨은 run 표 하나로 대신함)
     total_size += tree->children.capacity() * sizeof(std::shared_ptr<TreeNode>);
+    total_size += tree->level_runs.memory_bytes();
     
     // 재귀적으로 자식들의 크기 계산
     for (const auto& child : tree->children) {
@@ -82,8 +110,173 @@ size_t tree_memory(const std::shared_ptr<TreeNode>& tree) {
     return total_size;
 }
 
+// 파일을 페이지 캐시에서 내림 (콜드 스타트 측정용, 더러운 페이지는 남을 수 있음)
+void drop_file_cache(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// "k,g" 또는 "k g" 파싱
+bool parse_kg(const std::string& text, int& k, int& g) {
+    size_t separator = text.find_first_of(", ");
+    if (separator == std::string::npos) return false;
+    try {
+        k = std::stoi(text.substr(0, separator));
+        g = std::stoi(text.substr(separator + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return k > 0 && g > 0;
+}
+
+// 결과 노드 출력 (15개까지는 전부, 넘으면 앞의 10개만 풀어서)
+void print_result_nodes(const CoreResult& result) {
+    size_t limit = result.size() <= 15 ? result.size() : 10;
+    std::cout << (result.size() <= 15 ? "   📋 Nodes: {" : "   📋 First 10 nodes: {");
+    size_t printed = 0;
+    result.for_each_block([&](const int* first, size_t count) {
+        for (size_t i = 0; i < count && printed < limit; i++, printed++) {
+            std::cout << (printed > 0 ? ", " : "") << first[i];
+        }
+        return printed < limit;
+    });
+    std::cout << (result.size() <= 15 ? "}" : ", ...}") << std::endl;
+}
+
+void print_lazy_cache(const LazyLevelIndex& lazy) {
+    auto stats = lazy.stats();
+    std::cout << "   🗃️  Level cache: " << stats.cached_levels << " levels, " << format_memory(stats.cached_bytes / 1024)
+              << " | built " << stats.builds << " (" << std::fixed << std::setprecision(3) << stats.build_seconds << "s), hits "
+              << stats.hits << ", waited " << stats.waits << ", evicted " << stats.evictions << std::endl;
+}
+
+// g마다 k 범위와 (k,g)-core 크기 표 (크기는 인덱스에 저장돼 있어 집합을 풀지 않음)
+void print_core_size_table(int max_g, const std::function<int(int)>& level_size, const std::function<size_t(int, int)>& core_size) {
+    for (int level_g = 1; level_g <= max_g; level_g++) {
+        int max_k = level_size(level_g);
+        if (max_k <= 0) continue;
+        std::cout << "   g=" << level_g << ": k can be 1 to " << max_k << " | sizes";
+        for (int k = 1; k <= max_k; k++) std::cout << " " << core_size(k, level_g);
+        std::cout << std::endl;
+    }
+}
+
+// --interactive --lazy: 인덱스를 미리 만들지 않고 쿼리가 닿은 g 레벨만 구성
+// 어느 인덱스 종류든 (k,g)-core는 같으므로 메서드 이름은 받되 모두 레벨 캐시에서 답함
+void run_lazy_interactive(const Hypergraph& index_graph, size_t total_nodes, size_t cache_kb) {
+    std::cout << "\n=== Lazy Interactive Mode ===" << std::endl;
+    std::cout << "💤 g levels are built on first use, cache cap "
+              << (cache_kb > 0 ? format_memory(cache_kb) : std::string("unlimited")) << std::endl;
+    LazyLevelIndex lazy(index_graph, cache_kb * 1024);
+    std::cout << "   📋 g can be 1 to " << lazy.max_g() << " (k range shows up once a level is built)" << std::endl;
+    
+    std::cout << "\nCommands:" << std::endl;
+    std::cout << "  [method] k,g     - Query (k,g)-core, method (naive/one/jump/diag) is accepted but optional" << std::endl;
+    std::cout << "  prefetch g1-g2   - Build levels g1..g2 in parallel" << std::endl;
+    std::cout << "  ranges           - Show k ranges and core sizes of cached levels" << std::endl;
+    std::cout << "  shell k,g        - (k,g)-core minus (k+1,g)-core" << std::endl;
+    std::cout << "  cache            - Show level cache statistics" << std::endl;
+    std::cout << "  quit/exit        - Exit program" << std::endl;
+    std::cout << "========================================" << std::endl;
+    
+    std::string input;
+    int query_count = 0;
+    double total_time = 0.0;
+    while (true) {
+        std::cout << "\n🔍 Enter command: ";
+        if (!std::getline(std::cin, input)) break;
+        input.erase(0, input.find_first_not_of(" \t"));
+        input.erase(input.find_last_not_of(" \t") + 1);
+        if (input.empty()) continue;
+        if (input == "quit" || input == "exit" || input == "q") break;
+        
+        if (input == "cache") {
+            print_lazy_cache(lazy);
+            continue;
+        }
+        if (input == "ranges" || input == "range") {
+            print_core_size_table(lazy.max_g(), [&](int level_g) { return lazy.cached(level_g) ? lazy.level(level_g)->max_k() : 0; },
+                                  [&](int k, int level_g) { return lazy.core_size(k, level_g); });
+            continue;
+        }
+        if (input.substr(0, 5) == "shell") {
+            std::string params = input.substr(5);
+            params.erase(0, params.find_first_not_of(" \t"));
+            int shell_k = 0, shell_g = 0;
+            if (!parse_kg(params, shell_k, shell_g)) {
+                std::cout << "❌ Use 'shell k,g' (e.g., 'shell 2,1')" << std::endl;
+                continue;
+            }
+            CoreResult shell = lazy.shell(shell_k, shell_g);
+            std::cout << "🐚 (" << shell_k << "," << shell_g << ")-shell: " << shell.size() << " nodes" << std::endl;
+            if (!shell.empty()) print_result_nodes(shell);
+            continue;
+        }
+        if (input.substr(0, 8) == "prefetch") {
+            int first = 0, last = 0;
+            if (sscanf(input.c_str() + 8, " %d-%d", &first, &last) < 1 || first <= 0) {
+                std::cout << "❌ Use 'prefetch g1-g2' (e.g., 'prefetch 1-8')" << std::endl;
+                continue;
+            }
+            last = std::min(std::max(first, last), lazy.max_g());
+            auto start = std::chrono::high_resolution_clock::now();
+            TaskGroup group(task_runtime());
+            for (int level_g = first; level_g <= last; level_g++) {
+                group.run([&lazy, level_g] { lazy.level(level_g); });
+            }
+            group.wait();
+            std::cout << "✅ Levels g=" << first << ".." << last << " ready (" << std::fixed << std::setprecision(3)
+                      << std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() << "s)" << std::endl;
+            print_lazy_cache(lazy);
+            continue;
+        }
+        
+        // 앞에 메서드 이름/번호가 있으면 건너뜀 ("naive 2,1", "1 2 1", "2,1", "2 1")
+        std::istringstream tokens(input);
+        std::vector<std::string> words;
+        for (std::string word; tokens >> word;) words.push_back(word);
+        bool has_method = !std::isdigit((unsigned char)words[0][0]) || words.size() >= 3 ||
+                          (words.size() == 2 && words[1].find(',') != std::string::npos);
+        std::string params;
+        for (size_t w = has_method ? 1 : 0; w < words.size(); w++) params += (params.empty() ? "" : " ") + words[w];
+        int query_k = 0, query_g = 0;
+        if (!parse_kg(params, query_k, query_g)) {
+            std::cout << "❌ Invalid format. Use 'k,g' or 'method k,g' (e.g., '2,1' or 'naive 2,1')" << std::endl;
+            continue;
+        }
+        
+        bool was_cached = lazy.cached(query_g);
+        auto query_start = std::chrono::high_resolution_clock::now();
+        auto query_result = lazy.query(query_k, query_g);
+        double query_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - query_start).count();
+        query_count++;
+        total_time += query_time;
+        
+        std::cout << (query_result.empty() ? "❌ No nodes found" : "✅ Query #" + std::to_string(query_count))
+                  << " for (" << query_k << "," << query_g << ")-core: " << query_result.size() << " nodes in "
+                  << std::fixed << std::setprecision(6) << query_time << "s"
+                  << (was_cached ? " (cached level)" : " (level built)") << std::endl;
+        if (!query_result.empty()) {
+            std::cout << "   🎯 Density: " << std::fixed << std::setprecision(2)
+                      << (double)query_result.size() / total_nodes * 100 << "%" << std::endl;
+            print_result_nodes(query_result);
+        }
+    }
+    
+    std::cout << "\n📈 Session: " << query_count << " queries";
+    if (query_count > 0) {
+        std::cout << ", avg " << std::fixed << std::setprecision(6) << total_time / query_count << "s";
+    }
+    std::cout << std::endl;
+    print_lazy_cache(lazy);
+    std::cout << "\n👋 Interactive session ended. Goodbye!" << std::endl;
+}
+
 struct LeafNodeInfo;
-std::vector<LeafNodeInfo> collect_leaf_nodes(const std::shared_ptr<TreeNode>& naive_tree);
+std::vector<LeafNodeInfo> collect_leaf_nodes(const NaiveIndex& naive_index);
 std::vector<std::pair<int, int>> select_percentile_queries(const std::vector<LeafNodeInfo>& leaf_nodes);
 
 // Leaf node 정보를 담는 구조체
@@ -107,6 +300,23 @@ int main(int argc, char* argv[]) {
         bool test_diagonal = false;
         bool interactive_mode = false;
         bool benchmark_mode = false;  // 통합 interactive 모드
+        bool contract_twins = true;   // 쌍둥이 노드 축약 전처리
+        bool kernel_bench_mode = false;  // 이웃 카운트 커널 단독 벤치마크
+        bool set_kernel_bench_mode = false;  // 정렬 배열 교집합/차집합 커널 벤치마크
+        bool load_bench_mode = false;        // 인덱스/스냅샷 로딩 경로(pread, io_uring, mmap) 비교
+        std::string snapshot_out;            // 읽은 하이퍼그래프를 스냅샷으로 저장할 경로
+        int num_threads = 0;             // 태스크 런타임 워커 수 (0이면 하드웨어 스레드 수)
+        std::string index_dir;           // interactive 모드에서 인덱스를 저장/재사용할 디렉터리
+        bool serve_mmap = false;         // 평평한 인덱스를 힙에 올리지 않고 파일 mmap으로 서빙
+        bool lazy_levels = false;        // interactive 모드: 쿼리가 닿은 g 레벨만 그때 구성
+        size_t lazy_cache_kb = 0;        // 지연 구성 레벨 캐시 상한 (0이면 무제한)
+        DistributedOptions distributed;  // --distributed=N: g 구간을 워커 프로세스들에 나눠 레벨 샤드를 만든 뒤 병합
+        int distributed_workers = 0;
+        std::string shard_dir;           // 레벨 샤드 디렉터리 (--distributed 없이 주면 있는 샤드를 병합만)
+        std::string worker_socket;       // 워커 모드: 코디네이터 소켓
+        std::string worker_range;        // 파일만으로 돌리는 워커: "B:E" 구간 하나를 샤드로 쓰고 끝
+        std::string shard_kind = "shells";
+        MapOptions map_options;
         
         // 간단한 명령행 파싱
         std::cout << "=== Command Line Arguments ===" << std::endl;
@@ -149,6 +359,149 @@ int main(int argc, char* argv[]) {
                 test_diagonal = true;
                 std::cout << "Diagonal compression test mode enabled" << std::endl;
             }
+            else if (arg == "--bench-kernel") {
+                kernel_bench_mode = true;
+                std::cout << "Counting kernel benchmark mode enabled" << std::endl;
+            }
+            else if (arg == "--bench-set-kernels") {
+                set_kernel_bench_mode = true;
+                std::cout << "Set kernel benchmark mode enabled" << std::endl;
+            }
+            else if (arg == "--bench-load") {
+                load_bench_mode = true;
+                std::cout << "Load benchmark mode enabled" << std::endl;
+            }
+            else if (arg.substr(0, 5) == "--io=") {
+                IoBackend backend;
+                if (!parse_io_backend(arg.substr(5), backend) || !select_io_backend(backend)) {
+                    std::cerr << "Unsupported I/O backend: " << arg.substr(5) << std::endl;
+                    return 1;
+                }
+                std::cout << "I/O backend set to: " << io_backend_name(active_io_backend()) << std::endl;
+            }
+            else if (arg.substr(0, 16) == "--save-snapshot=") {
+                snapshot_out = arg.substr(16);
+                std::cout << "Hypergraph snapshot will be written to: " << snapshot_out << std::endl;
+            }
+            else if (arg.substr(0, 13) == "--set-kernel=") {
+                std::string name = arg.substr(13);
+                bool selected = false;
+                for (SetKernel kernel : {SetKernel::Auto, SetKernel::Scalar, SetKernel::SSE41, SetKernel::AVX2}) {
+                    if (name == set_kernel_name(kernel)) {
+                        selected = select_set_kernel(kernel);
+                        break;
+                    }
+                }
+                if (!selected) {
+                    std::cerr << "Unknown or unsupported set kernel: " << name << std::endl;
+                    return 1;
+                }
+                std::cout << "Set kernel set to: " << set_kernel_name(active_set_kernel()) << std::endl;
+            }
+            else if (arg == "--no-partition") {
+                g_build_config.partition_components = false;
+                distributed.worker_args.push_back(arg);
+                std::cout << "Connected-component partitioning disabled" << std::endl;
+            }
+            else if (arg.substr(0, 14) == "--batch-nodes=") {
+                g_build_config.component_batch_nodes = std::stoi(arg.substr(14));
+                distributed.worker_args.push_back(arg);
+                std::cout << "Component batch size set to: " << g_build_config.component_batch_nodes << std::endl;
+            }
+            else if (arg.substr(0, 10) == "--threads=") {
+                num_threads = std::stoi(arg.substr(10));
+                std::cout << "Threads set to: " << num_threads << std::endl;
+            }
+            else if (arg.substr(0, 16) == "--leaf-encoding=") {
+                if (!parse_set_codec(arg.substr(16), g_build_config.leaf_codec)) {
+                    std::cerr << "Unknown leaf encoding: " << arg.substr(16) << std::endl;
+                    return 1;
+                }
+                std::cout << "Leaf encoding set to: " << set_codec_name(g_build_config.leaf_codec) << std::endl;
+            }
+            else if (arg.substr(0, 12) == "--index-dir=") {
+                index_dir = arg.substr(12);
+                std::cout << "Index directory set to: " << index_dir << std::endl;
+            }
+            else if (arg.substr(0, 18) == "--parallel-decode=") {
+                g_query_config.parallel_decode_nodes = std::stoul(arg.substr(18));
+                std::cout << "Parallel result decoding from " << g_query_config.parallel_decode_nodes << " stored nodes"
+                          << (g_query_config.parallel_decode_nodes == 0 ? " (disabled)" : "") << std::endl;
+            }
+            else if (arg == "--lazy") {
+                lazy_levels = true;
+                std::cout << "Interactive levels will be built on demand" << std::endl;
+            }
+            else if (arg.substr(0, 13) == "--lazy-cache=") {
+                if (!parse_memory_size(arg.substr(13), lazy_cache_kb)) {
+                    std::cerr << "Invalid lazy cache size: " << arg.substr(13) << std::endl;
+                    return 1;
+                }
+                lazy_levels = true;
+                std::cout << "Lazy level cache capped at: " << format_memory(lazy_cache_kb) << std::endl;
+            }
+            else if (arg == "--mmap") {
+                serve_mmap = true;
+                std::cout << "Serving flat indexes from mmap" << std::endl;
+            }
+            else if (arg.substr(0, 14) == "--mmap-advice=") {
+                if (!parse_map_advice(arg.substr(14), map_options.advice)) {
+                    std::cerr << "Unknown mmap advice: " << arg.substr(14) << std::endl;
+                    return 1;
+                }
+                std::cout << "mmap advice set to: " << arg.substr(14) << std::endl;
+            }
+            else if (arg == "--huge-pages") {
+                map_options.huge_pages = true;
+                std::cout << "Huge pages requested for mapped indexes" << std::endl;
+            }
+            else if (arg == "--verify-checksums") {
+                map_options.verify_checksums = true;
+                std::cout << "Mapped index checksums will be verified" << std::endl;
+            }
+            else if (arg.substr(0, 16) == "--memory-budget=") {
+                if (!parse_memory_size(arg.substr(16), g_build_config.memory_budget_kb)) {
+                    std::cerr << "Invalid memory budget: " << arg.substr(16) << std::endl;
+                    return 1;
+                }
+                std::cout << "Construction memory budget set to: " << format_memory(g_build_config.memory_budget_kb) << std::endl;
+            }
+            else if (arg.substr(0, 12) == "--spill-dir=") {
+                g_build_config.spill_dir = arg.substr(12);
+                std::cout << "Spill directory set to: " << g_build_config.spill_dir << std::endl;
+            }
+            else if (arg.substr(0, 17) == "--checkpoint-dir=") {
+                g_build_config.checkpoint_dir = arg.substr(17);
+                std::cout << "Build checkpoints go to: " << g_build_config.checkpoint_dir << std::endl;
+            }
+            else if (arg == "--resume") {
+                g_build_config.resume = true;
+                std::cout << "Resuming builds from checkpoints" << std::endl;
+            }
+            else if (arg.substr(0, 14) == "--distributed=") {
+                distributed_workers = std::stoi(arg.substr(14));
+                std::cout << "Distributed build with " << distributed_workers << " worker processes" << std::endl;
+            }
+            else if (arg.substr(0, 17) == "--levels-per-job=") {
+                distributed.levels_per_job = std::max(1, std::stoi(arg.substr(17)));
+            }
+            else if (arg.substr(0, 12) == "--shard-dir=") {
+                shard_dir = arg.substr(12);
+                std::cout << "Level shard directory set to: " << shard_dir << std::endl;
+            }
+            else if (arg.substr(0, 9) == "--worker=") {
+                worker_socket = arg.substr(9);
+            }
+            else if (arg.substr(0, 15) == "--worker-range=") {
+                worker_range = arg.substr(15);
+            }
+            else if (arg.substr(0, 13) == "--shard-kind=") {
+                shard_kind = arg.substr(13);
+            }
+            else if (arg == "--no-contract-twins") {
+                contract_twins = false;
+                std::cout << "Twin-node contraction disabled" << std::endl;
+            }
             else if (arg.substr(0, 2) == "k=") {
                 k = std::stoi(arg.substr(2));
                 std::cout << "k set to: " << k << std::endl;
@@ -174,6 +527,37 @@ int main(int argc, char* argv[]) {
             std::cout << argv[0] << " --file=filename --build=one-level" << std::endl;
             std::cout << argv[0] << " --file=filename --build=jump" << std::endl;
             std::cout << argv[0] << " --file=filename --build=diagonal" << std::endl;
+            std::cout << argv[0] << " --file=filename --bench-kernel [g=G]" << std::endl;
+            std::cout << argv[0] << " --file=filename --bench-set-kernels" << std::endl;
+            std::cout << argv[0] << " --file=filename --index-dir=DIR --bench-load" << std::endl;
+            std::cout << "\nOptions:" << std::endl;
+            std::cout << "  --no-contract-twins   Build indexes on the original hypergraph (skip twin-node contraction)" << std::endl;
+            std::cout << "  --no-partition        Decompose the whole hypergraph at once instead of per connected component" << std::endl;
+            std::cout << "  --batch-nodes=N       Components smaller than N nodes are batched together (default 4096)" << std::endl;
+            std::cout << "  --threads=N           Worker threads for construction, compression and batch queries (default: all cores)" << std::endl;
+            std::cout << "  --set-kernel=K        Sorted-set kernel: auto, avx2, sse4.1, scalar (default: auto = widest supported)" << std::endl;
+            std::cout << "  --leaf-encoding=C     Node-set encoding in built indexes: auto, varint, ef, roaring, raw (default: auto)" << std::endl;
+            std::cout << "  --index-dir=DIR       Interactive mode: load indexes saved in DIR, build and save the missing ones" << std::endl;
+            std::cout << "  --parallel-decode=N   Decode query results with N or more stored nodes on all workers (default 65536, 0 = off)" << std::endl;
+            std::cout << "  --lazy                Interactive mode: build only the g levels that queries touch, on first use" << std::endl;
+            std::cout << "  --lazy-cache=SIZE     Cap the lazily built levels (e.g. 256M), least recently used levels are dropped" << std::endl;
+            std::cout << "  --mmap                With --index-dir: serve one-level/jump/diagonal straight from the mapped files" << std::endl;
+            std::cout << "  --mmap-advice=A       madvise hint for mapped indexes: random, sequential, willneed, normal (default: random)" << std::endl;
+            std::cout << "  --huge-pages          Ask for huge pages on the mapped leaf sets (MADV_HUGEPAGE)" << std::endl;
+            std::cout << "  --verify-checksums    Check every section checksum when mapping (reads the whole file)" << std::endl;
+            std::cout << "  --io=B                Loader I/O backend: auto, io_uring, pread (default: auto = io_uring when available)" << std::endl;
+            std::cout << "  --save-snapshot=FILE  Write the loaded hypergraph as a binary snapshot (load it back with --file=FILE.kgh)" << std::endl;
+            std::cout << "  --memory-budget=SIZE  Construction peak RSS limit (e.g. 512M, 2G): stream g levels through spill files and fail if exceeded; with --index-dir," << std::endl;
+            std::cout << "                        --build=naive/one-level write finished levels straight to DIR/<type>.kgi" << std::endl;
+            std::cout << "  --spill-dir=DIR       Where spilled g levels go (default: /tmp)" << std::endl;
+            std::cout << "  --checkpoint-dir=DIR  Checkpoint every finished g level to DIR/{cores,shells}.ckpt (removed when the build ends)" << std::endl;
+            std::cout << "  --resume              Continue an interrupted build from its checkpoint (default dir: --index-dir)" << std::endl;
+            std::cout << "  --distributed=N       Compute g levels in N worker processes (g ranges over a Unix socket), then merge" << std::endl;
+            std::cout << "  --levels-per-job=N    g levels per worker job (default 8)" << std::endl;
+            std::cout << "  --shard-dir=DIR       Level shards and the worker snapshot (default: --index-dir/shards or ./shards);" << std::endl;
+            std::cout << "                        without --distributed, build by merging the shards already in DIR" << std::endl;
+            std::cout << "  --worker-range=B:E    With --file=DIR/hypergraph.kgh --shard-dir=DIR --shard-kind=cores|shells:" << std::endl;
+            std::cout << "                        write the shard for g in [B,E) and exit (file-only transport)" << std::endl;
             std::cout << "\nExamples:" << std::endl;
             std::cout << argv[0] << " --file=real/contact/network.hyp --test-core k=1 g=1" << std::endl;
             std::cout << argv[0] << " --file=real/contact/network.hyp --test-naive" << std::endl;
@@ -185,11 +569,34 @@ int main(int argc, char* argv[]) {
             return 0;
         }
         
+        if (shard_dir.empty() && distributed_workers > 0) {
+            shard_dir = index_dir.empty() ? "shards" : index_dir + "/shards";
+        }
+        
+        if (g_build_config.resume && g_build_config.checkpoint_dir.empty()) {
+            if (index_dir.empty()) {
+                std::cerr << "--resume needs --checkpoint-dir or --index-dir" << std::endl;
+                return 1;
+            }
+            g_build_config.checkpoint_dir = index_dir;
+        }
+        
+        init_task_runtime(num_threads);
+        
         // 하이퍼그래프 로드
         std::cout << "\n=== Loading Hypergraph ===" << std::endl;
         std::cout << "Loading from: " << hypergraph_file << std::endl;
         
-        Hypergraph hypergraph = load_hypergraph(hypergraph_file);
+        // .kgh는 바이너리 스냅샷 (텍스트 파싱 없이 활성 I/O 백엔드로 읽음)
+        auto hypergraph_load_start = std::chrono::high_resolution_clock::now();
+        Hypergraph hypergraph;
+        bool is_snapshot = hypergraph_file.size() > 4 && hypergraph_file.substr(hypergraph_file.size() - 4) == ".kgh";
+        if (is_snapshot) {
+            load_hypergraph_snapshot(hypergraph_file, hypergraph);
+        } else {
+            hypergraph = load_hypergraph(hypergraph_file);
+        }
+        double hypergraph_load_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - hypergraph_load_start).count();
         
         if (hypergraph.nodes().empty()) {
             std::cerr << "ERROR: Failed to load hypergraph or hypergraph is empty!" << std::endl;
@@ -199,6 +606,82 @@ int main(int argc, char* argv[]) {
         std::cout << "✅ Successfully loaded hypergraph:" << std::endl;
         std::cout << "   Nodes: " << hypergraph.nodes().size() << std::endl;
         std::cout << "   Hyperedges: " << hypergraph.E.size() << std::endl;
+        std::cout << "   Load time: " << std::fixed << std::setprecision(3) << hypergraph_load_time << "s"
+                  << (is_snapshot ? std::string(" (snapshot, ") + io_backend_name(active_io_backend()) + ")" : "") << std::endl;
+        
+        if (!snapshot_out.empty()) {
+            if (save_hypergraph_snapshot(hypergraph, snapshot_out)) {
+                std::cout << "💾 Snapshot written to " << snapshot_out << " (" << format_memory(get_file_size(snapshot_out) / 1024) << ")" << std::endl;
+            }
+        }
+        
+        // 분산 구성 워커: 코디네이터가 쓴 스냅샷은 이미 인덱스 구성용 그래프 (축약하지 않음)
+        if (!worker_socket.empty()) {
+            return run_level_worker(worker_socket, hypergraph, shard_dir);
+        }
+        if (!worker_range.empty()) {
+            size_t colon = worker_range.find(':');
+            int begin = std::stoi(worker_range.substr(0, colon));
+            int end = colon == std::string::npos ? begin + 1 : std::stoi(worker_range.substr(colon + 1));
+            int stop = build_level_shard(hypergraph, shard_kind, begin, end, level_shard_path(shard_dir, shard_kind, begin));
+            if (stop < 0) return 1;
+            std::cout << "✅ Shard " << level_shard_path(shard_dir, shard_kind, begin) << " written"
+                      << (stop < end ? " (levels end at g=" + std::to_string(stop - 1) + ")" : "") << std::endl;
+            return 0;
+        }
+        
+        // 쌍둥이 노드 축약: 인덱스 구성은 축약된 하이퍼그래프에서 수행하고 결과는 원본 노드로 펼침
+        Hypergraph contracted;
+        if (contract_twins) {
+            auto contract_start = std::chrono::high_resolution_clock::now();
+            contracted = contract_twin_nodes(hypergraph);
+            auto contract_end = std::chrono::high_resolution_clock::now();
+            
+            size_t original_count = hypergraph.node_hyperedges.size();
+            size_t contracted_count = contracted.node_hyperedges.size();
+            std::cout << "🔗 Twin contraction: " << original_count << " nodes → " << contracted_count
+                      << " supernodes (" << contracted.twins.size() << " twin groups, "
+                      << std::fixed << std::setprecision(2)
+                      << (1.0 - (double)contracted_count / original_count) * 100 << "% removed, "
+                      << std::setprecision(3)
+                      << std::chrono::duration<double>(contract_end - contract_start).count() << "s)" << std::endl;
+        } else {
+            // 축약하지 않아도 커널용 밀집 배열이 최대 노드 ID만큼 커지지 않도록 ID는 압축
+            contracted = compact_node_ids(hypergraph);
+        }
+        const Hypergraph& index_graph = contracted;
+        
+        // 하이퍼그래프를 읽은 것만으로 예산을 넘으면 어떤 구성도 그 안에서 할 수 없음
+        if (g_build_config.memory_budget_kb > 0 && get_memory_usage_kb() >= g_build_config.memory_budget_kb) {
+            std::cerr << "❌ --memory-budget=" << format_memory(g_build_config.memory_budget_kb)
+                      << " is below the RSS after loading the hypergraph (" << format_memory(get_memory_usage_kb()) << ")" << std::endl;
+            return 1;
+        }
+        
+        // 분산 구성: 모드에 필요한 레벨 종류의 샤드를 워커들이 만들고, 이후의 구성 함수는 샤드에서 레벨을 읽어 병합
+        if (distributed_workers > 0) {
+            std::vector<std::string> kinds;
+            if (test_naive || test_diagonal || interactive_mode || benchmark_mode) kinds.push_back("cores");  // diagonal 테스트는 naive와 비교
+            if (test_one_level || test_jump || test_diagonal || interactive_mode || benchmark_mode) kinds.push_back("shells");
+            distributed.workers = distributed_workers;
+            distributed.shard_dir = shard_dir;
+            int worker_threads = num_threads > 0 ? num_threads : std::max(1, (int)std::thread::hardware_concurrency() / distributed_workers);
+            distributed.worker_args.push_back("--threads=" + std::to_string(worker_threads));
+            if (!kinds.empty() && !run_distributed_levels(index_graph, kinds, distributed)) {
+                std::cerr << "❌ Distributed build failed" << std::endl;
+                return 1;
+            }
+        }
+        if (!shard_dir.empty()) {
+            g_build_config.shard_dir = shard_dir;
+        }
+        
+        // 워커 사용률은 모드 실행 구간만 측정
+        std::string mode_label = test_mode ? "test-core" : benchmark_mode ? "benchmark" : interactive_mode ? "interactive"
+                               : test_naive ? "naive" : test_one_level ? "one-level" : test_jump ? "jump"
+                               : test_diagonal ? "diagonal" : kernel_bench_mode ? "bench-kernel"
+                               : set_kernel_bench_mode ? "bench-set-kernels" : load_bench_mode ? "bench-load" : "statistics";
+        task_runtime().reset_stats();
         
         // 각종 테스트 모드들
         if (test_mode) {
@@ -269,7 +752,7 @@ int main(int argc, char* argv[]) {
             // 1-1. Naive Index
             std::cout << "  🔧 Building Naive index..." << std::endl;
             auto naive_start = std::chrono::high_resolution_clock::now();
-            auto naive_tree = naive_index_construction(hypergraph, hypergraph.E);
+            auto naive_index = naive_index_construction(index_graph, index_graph.E);
             auto naive_end = std::chrono::high_resolution_clock::now();
             double naive_construction_time = std::chrono::duration<double>(naive_end - naive_start).count();
             std::cout << "     ✅ Completed (" << std::fixed << std::setprecision(3) << naive_construction_time << "s)" << std::endl;
@@ -277,7 +760,7 @@ int main(int argc, char* argv[]) {
             // 1-2. One-Level Index
             std::cout << "  🔧 Building One-level index..." << std::endl;
             auto one_level_start = std::chrono::high_resolution_clock::now();
-            auto one_level_tree = one_level_compression(hypergraph, hypergraph.E);
+            auto one_level_index = flatten_index(one_level_compression(index_graph, index_graph.E));
             auto one_level_end = std::chrono::high_resolution_clock::now();
             double one_level_construction_time = std::chrono::duration<double>(one_level_end - one_level_start).count();
             std::cout << "     ✅ Completed (" << std::fixed << std::setprecision(3) << one_level_construction_time << "s)" << std::endl;
@@ -285,7 +768,9 @@ int main(int argc, char* argv[]) {
             // 1-3. Jump Index
             std::cout << "  🔧 Building Jump index..." << std::endl;
             auto jump_start = std::chrono::high_resolution_clock::now();
-            auto [jump_tree, compression_rate] = jump_compression(hypergraph, hypergraph.E);
+            auto [jump_tree, compression_rate] = jump_compression(index_graph, index_graph.E);
+            auto jump_index = flatten_index(jump_tree);
+            jump_tree.reset();
             auto jump_end = std::chrono::high_resolution_clock::now();
             double jump_construction_time = std::chrono::duration<double>(jump_end - jump_start).count();
             std::cout << "     ✅ Completed (" << std::fixed << std::setprecision(3) << jump_construction_time << "s)" << std::endl;
@@ -293,7 +778,9 @@ int main(int argc, char* argv[]) {
             // 1-4. Diagonal Index
             std::cout << "  🔧 Building Diagonal index..." << std::endl;
             auto diagonal_start = std::chrono::high_resolution_clock::now();
-            auto [diagonal_tree, h_time, v_time] = diagonal_compression(hypergraph, hypergraph.E);
+            auto [diagonal_tree, h_time, v_time] = diagonal_compression(index_graph, index_graph.E);
+            auto diagonal_index = flatten_index(diagonal_tree);
+            diagonal_tree.reset();
             auto diagonal_end = std::chrono::high_resolution_clock::now();
             double diagonal_construction_time = std::chrono::duration<double>(diagonal_end - diagonal_start).count();
             std::cout << "     ✅ Completed (" << std::fixed << std::setprecision(3) << diagonal_construction_time << "s)" << std::endl;
@@ -302,7 +789,7 @@ int main(int argc, char* argv[]) {
             std::cout << "\n📍 Step 2/3: Selecting benchmark queries..." << std::endl;
             
             // Leaf node 수집
-            auto leaf_nodes = collect_leaf_nodes(naive_tree);
+            auto leaf_nodes = collect_leaf_nodes(naive_index);
             std::cout << "  📊 Found " << leaf_nodes.size() << " leaf nodes" << std::endl;
             
             // Percentile 기반 쿼리 선택
@@ -326,6 +813,7 @@ int main(int argc, char* argv[]) {
             double one_level_query_total_time = 0.0;
             double jump_query_total_time = 0.0;
             double diagonal_query_total_time = 0.0;
+            size_t naive_result_nodes = 0;   // 결과를 실제로 읽었다는 확인용 (naive 결과는 구간이라 크기만 봄)
             
             int progress_count = 0;
             for (const auto& query : selected_queries) {
@@ -347,29 +835,182 @@ int main(int argc, char* argv[]) {
                 
                 // 3-2. naive query
                 start = std::chrono::high_resolution_clock::now();
-                auto result2 = querying_for_naive_index(naive_tree, query_k, query_g);
+                auto result2 = querying_for_naive_index(naive_index, query_k, query_g);
                 end = std::chrono::high_resolution_clock::now();
                 naive_query_total_time += std::chrono::duration<double>(end - start).count();
+                naive_result_nodes += result2.size();
                 
                 // 3-3. one-level query
                 start = std::chrono::high_resolution_clock::now();
-                auto result3 = querying_for_one_level(one_level_tree, query_k, query_g);
+                auto result3 = querying_for_one_level(one_level_index, query_k, query_g);
                 end = std::chrono::high_resolution_clock::now();
                 one_level_query_total_time += std::chrono::duration<double>(end - start).count();
                 
                 // 3-4. jump query
                 start = std::chrono::high_resolution_clock::now();
-                auto result4 = querying_for_two_level(jump_tree, query_k, query_g);
+                auto result4 = querying_for_two_level(jump_index, query_k, query_g);
                 end = std::chrono::high_resolution_clock::now();
                 jump_query_total_time += std::chrono::duration<double>(end - start).count();
                 
                 // 3-5. diagonal query
                 start = std::chrono::high_resolution_clock::now();
-                auto result5 = querying_for_diagonal(diagonal_tree, query_k, query_g);
+                auto result5 = querying_for_diagonal(diagonal_index, query_k, query_g);
                 end = std::chrono::high_resolution_clock::now();
                 diagonal_query_total_time += std::chrono::duration<double>(end - start).count();
             }
             
+            // 3-6. 같은 쿼리 묶음을 워커 전체로 배치 실행했을 때의 처리량
+            std::cout << "\n  🧵 Batch execution (" << task_runtime().num_workers() << " threads):" << std::endl;
+            
+            std::vector<std::pair<std::string, QueryFunction>> batch_methods = {
+                {"Naive",     [&](int k, int g) { return CoreResult(querying_for_naive_index(naive_index, k, g)); }},
+                {"One-level", [&](int k, int g) { return querying_for_one_level(one_level_index, k, g); }},
+                {"Jump",      [&](int k, int g) { return querying_for_two_level(jump_index, k, g); }},
+                {"Diagonal",  [&](int k, int g) { return querying_for_diagonal(diagonal_index, k, g); }}
+            };
+            
+            std::vector<std::vector<int>> batch_reference;   // 쿼리별 정렬된 결과 (Naive 기준)
+            for (const auto& [method_name, method] : batch_methods) {
+                auto start = std::chrono::high_resolution_clock::now();
+                auto batch_results = run_query_batch(selected_queries, method);
+                auto end = std::chrono::high_resolution_clock::now();
+                double batch_time = std::chrono::duration<double>(end - start).count();
+                
+                bool consistent = true;
+                for (size_t q = 0; q < batch_results.size(); q++) {
+                    auto nodes = batch_results[q].to_vector(true);
+                    if (batch_reference.size() < batch_results.size()) {
+                        batch_reference.push_back(std::move(nodes));
+                    } else if (nodes != batch_reference[q]) {
+                        consistent = false;
+                    }
+                }
+                
+                std::cout << "    " << std::left << std::setw(10) << method_name << std::right << " "
+                          << std::fixed << std::setprecision(6) << batch_time << "s ("
+                          << std::setprecision(2) << (batch_time > 0 ? selected_queries.size() / batch_time : 0.0) << " QPS)"
+                          << (consistent ? "" : " ⚠️  results differ from Naive") << std::endl;
+            }
+            
+            // 3-7. 같은 배치를 g별로 묶어 체인을 공유했을 때 (결과를 전부 풀어 읽는 시간까지)
+            std::cout << "\n  🔗 Shared traversal batch (query + decode every result):" << std::endl;
+            
+            auto consume = [](const std::vector<CoreResult>& results) {
+                size_t nodes = 0;
+                for (const CoreResult& result : results) {
+                    result.for_each_block([&](const int*, size_t count) {
+                        nodes += count;
+                        return true;
+                    });
+                }
+                return nodes;
+            };
+            using SharedBatch = std::function<std::vector<CoreResult>(const std::vector<std::pair<int, int>>&)>;
+            std::vector<std::tuple<std::string, QueryFunction, SharedBatch>> shared_methods = {
+                {"One-level", batch_methods[1].second, [&](const auto& queries) { return querying_batch_for_one_level(one_level_index, queries); }},
+                {"Jump",      batch_methods[2].second, [&](const auto& queries) { return querying_batch_for_two_level(jump_index, queries); }},
+                {"Diagonal",  batch_methods[3].second, [&](const auto& queries) { return querying_batch_for_diagonal(diagonal_index, queries); }}
+            };
+            // reference가 비어 있으면 같은 방법의 따로 실행한 결과와 비교
+            auto compare_shared = [&](const std::vector<std::pair<int, int>>& queries, const std::vector<std::vector<int>>& reference) {
+                for (const auto& [method_name, method, shared] : shared_methods) {
+                    auto start = std::chrono::high_resolution_clock::now();
+                    auto separate_results = run_query_batch(queries, method);
+                    size_t separate_nodes = consume(separate_results);
+                    auto middle = std::chrono::high_resolution_clock::now();
+                    auto shared_results = shared(queries);
+                    size_t shared_nodes = consume(shared_results);
+                    auto end = std::chrono::high_resolution_clock::now();
+                    double separate_time = std::chrono::duration<double>(middle - start).count();
+                    double shared_time = std::chrono::duration<double>(end - middle).count();
+                    
+                    bool consistent = separate_nodes == shared_nodes;
+                    for (size_t q = 0; q < shared_results.size() && consistent; q++) {
+                        consistent = shared_results[q].to_vector(true) ==
+                                     (reference.empty() ? separate_results[q].to_vector(true) : reference[q]);
+                    }
+                    
+                    std::cout << "    " << std::left << std::setw(10) << method_name << std::right << " "
+                              << std::fixed << std::setprecision(6) << separate_time << "s -> " << shared_time << "s ("
+                              << std::setprecision(2) << (shared_time > 0 ? separate_time / shared_time : 0.0) << "x)"
+                              << (consistent ? "" : reference.empty() ? " ⚠️  results differ from separate queries"
+                                                                      : " ⚠️  results differ from Naive") << std::endl;
+                }
+            };
+            compare_shared(selected_queries, batch_reference);
+            
+            // 뽑은 쿼리는 g마다 거의 하나라 나눌 체인이 적음: 모든 (k,g)를 한 배치로 물었을 때도 비교
+            std::vector<std::pair<int, int>> all_queries;
+            for (int g = 1; g <= one_level_index.num_levels(); g++) {
+                for (int k = 1; k <= one_level_index.level_size(g); k++) all_queries.emplace_back(k, g);
+            }
+            std::cout << "  🔗 Shared traversal batch, every (k,g) (" << all_queries.size() << " queries):" << std::endl;
+            compare_shared(all_queries, {});
+            
+            // 3-8. 같은 배치를 결과 형식별로 워커 안에서 바로 모았을 때 (Diagonal 기준)
+            int max_node = 0;
+            for (const auto& [node, hyperedges] : hypergraph.node_hyperedges) max_node = std::max(max_node, node);
+            std::cout << "\n  🧮 Result formats (Diagonal, universe " << max_node + 1 << "):" << std::endl;
+            
+            for (ResultFormat format : {ResultFormat::Sorted, ResultFormat::Bitmap, ResultFormat::Roaring}) {
+                auto start = std::chrono::high_resolution_clock::now();
+                auto outputs = run_query_batch(selected_queries, batch_methods[3].second, format, max_node + 1);
+                auto end = std::chrono::high_resolution_clock::now();
+                double format_time = std::chrono::duration<double>(end - start).count();
+                
+                size_t bytes = 0;
+                bool consistent = true;
+                for (size_t q = 0; q < outputs.size(); q++) {
+                    bytes += outputs[q].bytes();
+                    consistent = consistent && outputs[q].size() == batch_reference[q].size();
+                }
+                
+                std::cout << "    " << std::left << std::setw(10) << result_format_name(format) << std::right << " "
+                          << std::fixed << std::setprecision(6) << format_time << "s ("
+                          << std::setprecision(2) << (format_time > 0 ? selected_queries.size() / format_time : 0.0) << " QPS), "
+                          << format_memory(bytes / 1024) << (consistent ? "" : " ⚠️  sizes differ from Naive") << std::endl;
+            }
+            
+            // 3-9. 직사각형의 모든 core를 따로 받을 때와 sweep 차분으로 받을 때 (받은 노드를 모두 읽는 시간까지)
+            int sweep_g2 = std::min(10, one_level_index.num_levels());
+            int sweep_k2 = std::min(50, one_level_index.level_size(1));
+            if (sweep_g2 >= 1 && sweep_k2 >= 1) {
+                std::cout << "\n  🧹 Rectangle sweep (k=1.." << sweep_k2 << ", g=1.." << sweep_g2 << "):" << std::endl;
+                
+                auto start = std::chrono::high_resolution_clock::now();
+                size_t independent_nodes = 0;
+                for (int sweep_g = 1; sweep_g <= sweep_g2; sweep_g++) {
+                    for (int sweep_k = 1; sweep_k <= sweep_k2; sweep_k++) {
+                        querying_for_one_level(one_level_index, sweep_k, sweep_g).for_each_block([&](const int*, size_t count) {
+                            independent_nodes += count;
+                            return true;
+                        });
+                    }
+                }
+                double independent_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                
+                start = std::chrono::high_resolution_clock::now();
+                size_t delta_nodes = 0, steps = 0;
+                long long running = 0;
+                bool consistent = true;
+                sweep_core_deltas(one_level_index, jump_index, 1, sweep_k2, 1, sweep_g2, [&](const CoreDelta& step) {
+                    size_t added = 0, removed = 0;
+                    step.added.for_each_block([&](const int*, size_t count) { added += count; return true; });
+                    step.removed.for_each_block([&](const int*, size_t count) { removed += count; return true; });
+                    running += (long long)added - (long long)removed;
+                    consistent = consistent && running == (long long)step.size;
+                    delta_nodes += added + removed;
+                    steps++;
+                    return true;
+                });
+                double sweep_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                
+                std::cout << "    Independent: " << std::fixed << std::setprecision(6) << independent_time << "s, "
+                          << independent_nodes << " nodes" << std::endl;
+                std::cout << "    Sweep:       " << sweep_time << "s, " << delta_nodes << " nodes over " << steps << " steps"
+                          << (consistent ? "" : " ⚠️  deltas disagree with core sizes") << std::endl;
+            }
+            
             // === STEP 4: Results Output ===
             std::cout << "\n🎉 Benchmark completed!" << std::endl;
             std::cout << "\n📊 Summary:" << std::endl;
@@ -381,7 +1022,7 @@ int main(int argc, char* argv[]) {
             
             std::cout << "\n  Query execution total times (100 queries):" << std::endl;
             std::cout << "    find_kg_core:    " << std::fixed << std::setprecision(6) << find_kg_core_total_time << "s" << std::endl;
-            std::cout << "    Naive query:     " << naive_query_total_time << "s" << std::endl;
+            std::cout << "    Naive query:     " << naive_query_total_time << "s (" << naive_result_nodes << " result nodes)" << std::endl;
             std::cout << "    One-level query: " << one_level_query_total_time << "s" << std::endl;
             std::cout << "    Jump query:      " << jump_query_total_time << "s" << std::endl;
             std::cout << "    Diagonal query:  " << diagonal_query_total_time << "s" << std::endl;
@@ -450,6 +1091,8 @@ int main(int argc, char* argv[]) {
                 std::cout << "    " << query_times[i].first << ": " 
                           << std::fixed << std::setprecision(2) << speedup << "x slower" << std::endl;
             }    
+        } else if (interactive_mode && lazy_levels) {
+            run_lazy_interactive(index_graph, hypergraph.nodes().size(), lazy_cache_kb);
         } else if (interactive_mode) {
             // 🆕 통합 Interactive 모드
             std::cout << "\n=== Unified Interactive Mode ===" << std::endl;
@@ -458,37 +1101,115 @@ int main(int argc, char* argv[]) {
             size_t memory_before = get_memory_usage_kb();
             std::cout << "💾 Memory before construction: " << format_memory(memory_before) << std::endl;
             
+            // --index-dir: 같은 하이퍼그래프로 만든 인덱스 파일이 있으면 불러오고, 없으면 만들어서 저장
+            if (serve_mmap && index_dir.empty()) {
+                std::cerr << "⚠️  --mmap needs --index-dir, indexes stay on the heap" << std::endl;
+                serve_mmap = false;
+            }
+            if (!index_dir.empty()) {
+                std::filesystem::create_directories(index_dir);
+            }
+            auto index_file = [&](const std::string& type) {
+                return index_dir + "/" + type + ".kgi";
+            };
+            auto index_metadata = [&](const std::string& type, double construction_time) {
+                return make_index_metadata(type, hypergraph_file, index_graph, construction_time);
+            };
+            auto stored_index_usable = [&](const std::string& type) {
+                IndexMetadata stored;
+                if (index_dir.empty() || !read_index_metadata(index_file(type), stored)) {
+                    return false;
+                }
+                // 파일 이름과 크기만으로는 같은 자리에서 고친 하이퍼그래프를 못 알아보므로 내용 체크섬까지 비교
+                IndexMetadata expected = index_metadata(type, 0.0);
+                if (stored.hypergraph_filename != expected.hypergraph_filename ||
+                    stored.compression_type != type ||
+                    stored.num_nodes != expected.num_nodes ||
+                    stored.num_hyperedges != expected.num_hyperedges ||
+                    stored.graph_checksum != expected.graph_checksum) {
+                    std::cout << "   ⚠️  " << index_file(type) << " was built from a different hypergraph, rebuilding" << std::endl;
+                    return false;
+                }
+                return true;
+            };
+            auto report_saved = [&](const std::string& type, bool saved) {
+                if (saved) {
+                    std::cout << "   💾 Saved to " << index_file(type) << " ("
+                              << format_memory(get_file_size(index_file(type)) / 1024) << ")" << std::endl;
+                }
+            };
+            
             // 1. Naive Index 구성
             std::cout << "\n📍 Step 1/4: Building Naive Index..." << std::endl;
             auto naive_start = std::chrono::high_resolution_clock::now();
-            auto naive_tree = naive_index_construction(hypergraph, hypergraph.E);
+            NaiveIndex naive_index;
+            bool naive_loaded = stored_index_usable("naive") && load_naive_index(index_file("naive"), naive_index);
+            if (!naive_loaded) {
+                naive_index = naive_index_construction(index_graph, index_graph.E);
+            }
             auto naive_end = std::chrono::high_resolution_clock::now();
             auto naive_time = std::chrono::duration<double>(naive_end - naive_start).count();
-            std::cout << "   ✅ Naive index completed (" << std::fixed << std::setprecision(3) << naive_time << "s)" << std::endl;
+            std::cout << "   ✅ Naive index " << (naive_loaded ? "loaded" : "completed") << " ("
+                      << std::fixed << std::setprecision(3) << naive_time << "s)" << std::endl;
+            if (!naive_loaded && !index_dir.empty()) {
+                report_saved("naive", save_naive_index(naive_index, index_metadata("naive", naive_time), index_file("naive")));
+            }
+            
+            // 2~4. 평평한 인덱스들은 같은 방식으로 불러오거나 구성 (--mmap이면 파일을 매핑해서 mapped로 서빙)
+            auto load_or_build = [&](const std::string& type, const std::string& label,
+                                     const std::function<FlatIndex()>& build, double& seconds, MappedIndex& mapped) {
+                auto start = std::chrono::high_resolution_clock::now();
+                FlatIndex index;
+                bool loaded = stored_index_usable(type) &&
+                              (serve_mmap ? mapped.open(index_file(type), map_options) : load_flat_index(index_file(type), index));
+                if (!loaded) {
+                    index = build();
+                }
+                seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                std::cout << "   ✅ " << label << " index " << (!loaded ? "completed" : serve_mmap ? "mapped" : "loaded") << " ("
+                          << std::fixed << std::setprecision(3) << seconds << "s)" << std::endl;
+                if (!loaded && !index_dir.empty()) {
+                    report_saved(type, save_flat_index(index, index_metadata(type, seconds), index_file(type)));
+                    if (serve_mmap && mapped.open(index_file(type), map_options)) {
+                        index = FlatIndex();
+                    }
+                }
+                return index;
+            };
+            
+            MappedIndex one_level_mapped, jump_mapped, diagonal_mapped;
             
-            // 2. One-Level Index 구성
             std::cout << "\n📍 Step 2/4: Building One-Level Index..." << std::endl;
-            auto one_level_start = std::chrono::high_resolution_clock::now();
-            auto one_level_tree = one_level_compression(hypergraph, hypergraph.E);
-            auto one_level_end = std::chrono::high_resolution_clock::now();
-            auto one_level_time = std::chrono::duration<double>(one_level_end - one_level_start).count();
-            std::cout << "   ✅ One-level index completed (" << std::fixed << std::setprecision(3) << one_level_time << "s)" << std::endl;
+            double one_level_time = 0.0;
+            auto one_level_index = load_or_build("one_level", "One-level", [&] {
+                return flatten_index(one_level_compression(index_graph, index_graph.E));
+            }, one_level_time, one_level_mapped);
             
-            // 3. Jump Index 구성
             std::cout << "\n📍 Step 3/4: Building Jump Index..." << std::endl;
-            auto jump_start = std::chrono::high_resolution_clock::now();
-            auto [jump_tree, compression_rate] = jump_compression(hypergraph, hypergraph.E);
-            auto jump_end = std::chrono::high_resolution_clock::now();
-            auto jump_time = std::chrono::duration<double>(jump_end - jump_start).count();
-            std::cout << "   ✅ Jump index completed (" << std::fixed << std::setprecision(3) << jump_time << "s)" << std::endl;
+            double jump_time = 0.0;
+            auto jump_index = load_or_build("jump", "Jump", [&] {
+                return flatten_index(jump_compression(index_graph, index_graph.E).first);
+            }, jump_time, jump_mapped);
             
-            // 4. Diagonal Index 구성
             std::cout << "\n📍 Step 4/4: Building Diagonal Index..." << std::endl;
-            auto diagonal_start = std::chrono::high_resolution_clock::now();
-            auto [diagonal_tree, h_time, v_time] = diagonal_compression(hypergraph, hypergraph.E);
-            auto diagonal_end = std::chrono::high_resolution_clock::now();
-            auto diagonal_time = std::chrono::duration<double>(diagonal_end - diagonal_start).count();
-            std::cout << "   ✅ Diagonal index completed (" << std::fixed << std::setprecision(3) << diagonal_time << "s)" << std::endl;
+            double diagonal_time = 0.0;
+            auto diagonal_index = load_or_build("diagonal", "Diagonal", [&] {
+                return flatten_index(std::get<0>(diagonal_compression(index_graph, index_graph.E)));
+            }, diagonal_time, diagonal_mapped);
+            
+            // 쿼리는 뷰로만 읽음
+            FlatIndexView one_level_view = one_level_mapped.is_open() ? one_level_mapped.view() : FlatIndexView(one_level_index);
+            FlatIndexView jump_view = jump_mapped.is_open() ? jump_mapped.view() : FlatIndexView(jump_index);
+            FlatIndexView diagonal_view = diagonal_mapped.is_open() ? diagonal_mapped.view() : FlatIndexView(diagonal_index);
+            auto report_mapped = [&](const char* when) {
+                if (!serve_mmap) return;
+                std::cout << "   🗺️  Mapped indexes " << when << ": ";
+                for (const MappedIndex* mapped : {&one_level_mapped, &jump_mapped, &diagonal_mapped}) {
+                    std::cout << format_memory(mapped->resident_bytes() / 1024) << "/" << format_memory(mapped->mapped_bytes() / 1024) << " ";
+                }
+                std::cout << "resident (one-level, jump, diagonal)" << std::endl;
+            };
+            report_mapped("after startup");
             
             size_t memory_after = get_memory_usage_kb();
             size_t memory_used = memory_after - memory_before;
@@ -500,8 +1221,8 @@ int main(int argc, char* argv[]) {
             
             // 사용 가능한 범위 출력
             std::cout << "\n📋 Available query ranges:" << std::endl;
-            for (int level_g = 1; level_g <= (int)naive_tree->children.size(); level_g++) {
-                int max_k_for_g = naive_tree->children[level_g - 1]->children.size();
+            for (int level_g = 1; level_g <= (int)naive_index.num_levels(); level_g++) {
+                int max_k_for_g = naive_index.level_size(level_g);
                 if (max_k_for_g > 0) {
                     std::cout << "   g=" << level_g << ": k can be 1 to " << max_k_for_g << std::endl;
                 }
@@ -517,8 +1238,12 @@ int main(int argc, char* argv[]) {
             std::cout << "\nCommands:" << std::endl;
             std::cout << "  method k,g     - Query using method (e.g., '1 2,1' or 'naive 2,1')" << std::endl;
             std::cout << "  help           - Show this help" << std::endl;
-            std::cout << "  ranges         - Show available ranges" << std::endl;
+            std::cout << "  ranges         - Show available ranges with (k,g)-core sizes" << std::endl;
+            std::cout << "  count k,g      - Size of (k,g)-core from the stored size tables" << std::endl;
+            std::cout << "  shell k,g      - (k,g)-core minus (k+1,g)-core" << std::endl;
+            std::cout << "  sweep k1-k2,g1-g2 - Walk a (k,g) rectangle, printing only the nodes added/removed per step" << std::endl;
             std::cout << "  compare k,g    - Compare all methods with same k,g" << std::endl;
+            std::cout << "  expr E         - Union/intersection/difference of cores (e.g., 'expr (2,3) & (3,1) - (4,3)')" << std::endl;
             std::cout << "  quit/exit      - Exit program" << std::endl;
             std::cout << "========================================" << std::endl;
             
@@ -557,23 +1282,106 @@ int main(int argc, char* argv[]) {
                     std::cout << "    4 k,g  or  diag k,g      - Query using diagonal index" << std::endl;
                     std::cout << "  Other commands:" << std::endl;
                     std::cout << "    compare k,g              - Compare all methods" << std::endl;
-                    std::cout << "    ranges                   - Show valid k,g ranges" << std::endl;
+                    std::cout << "    ranges                   - Show valid k,g ranges and core sizes" << std::endl;
+                    std::cout << "    count k,g                - Core size without decoding" << std::endl;
+                    std::cout << "    shell k,g                - Nodes whose core number at g is exactly k" << std::endl;
+                    std::cout << "    sweep k1-k2,g1-g2        - Deltas across a (k,g) rectangle in containment order" << std::endl;
+                    std::cout << "    expr E                   - Evaluate E with | (union), & (intersection), - (difference)" << std::endl;
                     std::cout << "  Examples:" << std::endl;
                     std::cout << "    naive 2,1" << std::endl;
                     std::cout << "    3 2,1" << std::endl;
                     std::cout << "    compare 2,1" << std::endl;
+                    std::cout << "    expr (2,1) - (3,1)" << std::endl;
                     continue;
                 }
                 
-                // 범위 보기 명령
+                // 범위 보기 명령 (core 크기는 one-level 인덱스의 크기 표에서)
                 if (input == "ranges" || input == "range") {
-                    std::cout << "\n📋 Available query ranges:" << std::endl;
-                    for (int level_g = 1; level_g <= (int)naive_tree->children.size(); level_g++) {
-                        int max_k_for_g = naive_tree->children[level_g - 1]->children.size();
-                        if (max_k_for_g > 0) {
-                            std::cout << "   g=" << level_g << ": k can be 1 to " << max_k_for_g << std::endl;
-                        }
+                    std::cout << "\n📋 Available query ranges and (k,g)-core sizes:" << std::endl;
+                    print_core_size_table(one_level_view.num_levels(), [&](int level_g) { return one_level_view.level_size(level_g); },
+                                          [&](int k, int level_g) { return one_level_view.core_size(k, level_g); });
+                    continue;
+                }
+                
+                // 직사각형 sweep: 첫 core 다음부터는 걸음마다 더해지거나 빠지는 노드만
+                if (input.substr(0, 5) == "sweep") {
+                    int k1 = 0, k2 = 0, g1 = 0, g2 = 0;
+                    if (sscanf(input.c_str() + 5, " %d-%d,%d-%d", &k1, &k2, &g1, &g2) != 4 || k1 <= 0 || g1 <= 0 || k1 > k2 || g1 > g2) {
+                        std::cout << "❌ Use 'sweep k1-k2,g1-g2' (e.g., 'sweep 1-5,1-3')" << std::endl;
+                        continue;
+                    }
+                    
+                    auto sweep_start = std::chrono::high_resolution_clock::now();
+                    size_t delta_nodes = 0, full_nodes = 0, steps = 0;
+                    sweep_core_deltas(one_level_view, jump_view, k1, k2, g1, g2, [&](const CoreDelta& step) {
+                        size_t added = step.added.size(), removed = step.removed.size();
+                        std::cout << "   (" << step.k << "," << step.g << "): +" << added << " -" << removed
+                                  << " → " << step.size << " nodes" << std::endl;
+                        delta_nodes += added + removed;
+                        full_nodes += step.size;
+                        steps++;
+                        return true;
+                    });
+                    auto sweep_end = std::chrono::high_resolution_clock::now();
+                    
+                    std::cout << "🧹 " << steps << " cores streamed as " << delta_nodes << " node changes (independent queries: "
+                              << full_nodes << " nodes, " << std::fixed << std::setprecision(6)
+                              << std::chrono::duration<double>(sweep_end - sweep_start).count() << "s)" << std::endl;
+                    continue;
+                }
+                
+                // 크기만: 인덱스마다 저장된 크기 표에서 O(1)
+                if (input.substr(0, 5) == "count") {
+                    std::string params = input.substr(5);
+                    params.erase(0, params.find_first_not_of(" \t"));
+                    int count_k = 0, count_g = 0;
+                    if (!parse_kg(params, count_k, count_g)) {
+                        std::cout << "❌ Use 'count k,g' (e.g., 'count 2,1')" << std::endl;
+                        continue;
+                    }
+                    std::cout << "🔢 |(" << count_k << "," << count_g << ")-core| = " << one_level_view.core_size(count_k, count_g)
+                              << " (naive " << naive_index.core_size(count_k, count_g) << ", jump " << jump_view.core_size(count_k, count_g)
+                              << ", diagonal " << diagonal_view.core_size(count_k, count_g) << ")" << std::endl;
+                    continue;
+                }
+                
+                // (k,g)-core \ (k+1,g)-core: one-level leaf 하나를 그대로
+                if (input.substr(0, 5) == "shell") {
+                    std::string params = input.substr(5);
+                    params.erase(0, params.find_first_not_of(" \t"));
+                    int shell_k = 0, shell_g = 0;
+                    if (!parse_kg(params, shell_k, shell_g)) {
+                        std::cout << "❌ Use 'shell k,g' (e.g., 'shell 2,1')" << std::endl;
+                        continue;
+                    }
+                    auto shell_start = std::chrono::high_resolution_clock::now();
+                    CoreResult shell = querying_shell_for_one_level(one_level_view, shell_k, shell_g);
+                    size_t shell_size = shell.size();
+                    auto shell_end = std::chrono::high_resolution_clock::now();
+                    std::cout << "🐚 (" << shell_k << "," << shell_g << ")-shell: " << shell_size << " nodes ("
+                              << std::fixed << std::setprecision(6) << std::chrono::duration<double>(shell_end - shell_start).count()
+                              << "s)" << std::endl;
+                    if (shell_size > 0) print_result_nodes(shell);
+                    continue;
+                }
+                
+                // 집합 연산 식 (one-level 인덱스의 셸 구조 위에서 계산)
+                if (input.substr(0, 4) == "expr") {
+                    CoreExpr expr;
+                    if (!parse_core_expr(input.substr(4), expr)) {
+                        std::cout << "❌ Invalid expression. Use cores like (k,g) with |, &, - and parentheses" << std::endl;
+                        continue;
                     }
+                    
+                    auto expr_start = std::chrono::high_resolution_clock::now();
+                    CoreResult expr_result = evaluate_core_expr(one_level_view, expr);
+                    size_t expr_size = expr_result.size();
+                    auto expr_end = std::chrono::high_resolution_clock::now();
+                    
+                    std::cout << "🧮 " << core_expr_text(expr) << " → " << expr_size << " nodes ("
+                              << std::fixed << std::setprecision(6) << std::chrono::duration<double>(expr_end - expr_start).count()
+                              << "s, " << expr_result.num_pieces() << " pieces)" << std::endl;
+                    if (expr_size > 0) print_result_nodes(expr_result);
                     continue;
                 }
                 
@@ -612,25 +1420,25 @@ int main(int argc, char* argv[]) {
                     
                     // Naive
                     auto naive_query_start = std::chrono::high_resolution_clock::now();
-                    auto naive_result = querying_for_naive_index(naive_tree, query_k, query_g);
+                    auto naive_result = querying_for_naive_index(naive_index, query_k, query_g);
                     auto naive_query_end = std::chrono::high_resolution_clock::now();
                     auto naive_query_time = std::chrono::duration<double>(naive_query_end - naive_query_start).count();
                     
                     // One-level
                     auto one_level_query_start = std::chrono::high_resolution_clock::now();
-                    auto one_level_result = querying_for_one_level(one_level_tree, query_k, query_g);
+                    auto one_level_result = querying_for_one_level(one_level_view, query_k, query_g);
                     auto one_level_query_end = std::chrono::high_resolution_clock::now();
                     auto one_level_query_time = std::chrono::duration<double>(one_level_query_end - one_level_query_start).count();
                     
                     // Jump
                     auto jump_query_start = std::chrono::high_resolution_clock::now();
-                    auto jump_result = querying_for_two_level(jump_tree, query_k, query_g);
+                    auto jump_result = querying_for_two_level(jump_view, query_k, query_g);
                     auto jump_query_end = std::chrono::high_resolution_clock::now();
                     auto jump_query_time = std::chrono::duration<double>(jump_query_end - jump_query_start).count();
                     
                     // Diagonal
                     auto diagonal_query_start = std::chrono::high_resolution_clock::now();
-                    auto diagonal_result = querying_for_diagonal(diagonal_tree, query_k, query_g);
+                    auto diagonal_result = querying_for_diagonal(diagonal_view, query_k, query_g);
                     auto diagonal_query_end = std::chrono::high_resolution_clock::now();
                     auto diagonal_query_time = std::chrono::duration<double>(diagonal_query_end - diagonal_query_start).count();
                     
@@ -655,15 +1463,17 @@ int main(int argc, char* argv[]) {
                     
                     std::cout << "🏆 Fastest: " << fastest_method << " (" << std::fixed << std::setprecision(6) << fastest_time << "s)" << std::endl;
                     
-                    // 결과 일치성 확인
-                    bool results_match = (naive_result.size() == one_level_result.size() && 
-                                        one_level_result.size() == jump_result.size() && 
-                                        jump_result.size() == diagonal_result.size());
+                    // 결과 일치성 확인 (naive 구간은 이미 정렬돼 있으므로 나머지만 정렬해서 비교)
+                    std::vector<int> expected(naive_result.begin(), naive_result.end());
+                    bool results_match = true;
+                    for (const CoreResult* result : {&one_level_result, &jump_result, &diagonal_result}) {
+                        results_match = results_match && result->size() == expected.size() && result->to_vector(true) == expected;
+                    }
                     
                     if (results_match) {
-                        std::cout << "✅ All methods returned the same number of nodes" << std::endl;
+                        std::cout << "✅ All methods returned the same nodes" << std::endl;
                     } else {
-                        std::cout << "⚠️  Methods returned different numbers of nodes!" << std::endl;
+                        std::cout << "⚠️  Methods returned different nodes!" << std::endl;
                     }
                     
                     query_count++;
@@ -734,20 +1544,20 @@ int main(int argc, char* argv[]) {
                 std::cout << "🔍 Querying (" << query_k << "," << query_g << ")-core using " << method_name << " index..." << std::endl;
                 
                 auto query_start = std::chrono::high_resolution_clock::now();
-                std::unordered_set<int> query_result;
+                CoreResult query_result;
                 
                 switch (method_num) {
                     case 1:
-                        query_result = querying_for_naive_index(naive_tree, query_k, query_g);
+                        query_result = querying_for_naive_index(naive_index, query_k, query_g);
                         break;
                     case 2:
-                        query_result = querying_for_one_level(one_level_tree, query_k, query_g);
+                        query_result = querying_for_one_level(one_level_view, query_k, query_g);
                         break;
                     case 3:
-                        query_result = querying_for_two_level(jump_tree, query_k, query_g);
+                        query_result = querying_for_two_level(jump_view, query_k, query_g);
                         break;
                     case 4:
-                        query_result = querying_for_diagonal(diagonal_tree, query_k, query_g);
+                        query_result = querying_for_diagonal(diagonal_view, query_k, query_g);
                         break;
                 }
                 
@@ -767,27 +1577,7 @@ int main(int argc, char* argv[]) {
                     std::cout << "   🎯 Density: " << std::fixed << std::setprecision(2) 
                               << (double)query_result.size() / hypergraph.nodes().size() * 100 << "%" << std::endl;
                     
-                    // 결과 노드들 출력 (15개까지만)
-                    if (query_result.size() <= 15) {
-                        std::cout << "   📋 Nodes: {";
-                        bool first = true;
-                        for (int node : query_result) {
-                            if (!first) std::cout << ", ";
-                            std::cout << node;
-                            first = false;
-                        }
-                        std::cout << "}" << std::endl;
-                    } else {
-                        std::cout << "   📋 First 10 nodes: {";
-                        int count = 0;
-                        for (int node : query_result) {
-                            if (count >= 10) break;
-                            if (count > 0) std::cout << ", ";
-                            std::cout << node;
-                            count++;
-                        }
-                        std::cout << ", ...}" << std::endl;
-                    }
+                    print_result_nodes(query_result);
                 } else {
                     std::cout << "❌ No nodes found for (" << query_k << "," << query_g << ")-core using " << method_name << std::endl;
                     std::cout << "   💡 Try smaller k or g values, or type 'ranges' for valid ranges" << std::endl;
@@ -814,6 +1604,7 @@ int main(int argc, char* argv[]) {
                 std::cout << "   Jump: " << jump_time << "s" << std::endl;
                 std::cout << "   Diagonal: " << diagonal_time << "s" << std::endl;
             }
+            report_mapped("after session");
             
             std::cout << "\n👋 Interactive session ended. Goodbye!" << std::endl;
             
@@ -825,15 +1616,39 @@ int main(int argc, char* argv[]) {
             size_t memory_before = get_memory_usage_kb();
             std::cout << "💾 Memory before construction: " << format_memory(memory_before) << std::endl;
             
+            // 메모리 예산이 있으면 끝난 g 레벨을 바로 index_dir/naive.kgi에 쓰고, 다 만든 뒤 다시 불러옴
+            bool external_build = g_build_config.memory_budget_kb > 0 && !index_dir.empty();
+            if (g_build_config.memory_budget_kb > 0 && index_dir.empty()) {
+                std::cerr << "⚠️  --memory-budget without --index-dir: the index itself stays in memory and counts against the budget" << std::endl;
+            }
+            
             auto start_time = std::chrono::high_resolution_clock::now();
-            auto naive_tree = naive_index_construction(hypergraph, hypergraph.E);
+            NaiveIndex naive_index;
+            size_t construction_peak = 0;
+            if (external_build) {
+                std::filesystem::create_directories(index_dir);
+                std::string file = index_dir + "/naive.kgi";
+                if (!build_naive_index_file(index_graph, index_graph.E, file, make_index_metadata("naive", hypergraph_file, index_graph, 0.0))) {
+                    std::cerr << "❌ External naive construction failed" << std::endl;
+                    return 1;
+                }
+                construction_peak = get_peak_memory_usage_kb();
+                std::cout << "   💾 Written to " << file << " (" << format_memory(get_file_size(file) / 1024) << ")" << std::endl;
+                if (!load_naive_index(file, naive_index)) return 1;
+            } else {
+                naive_index = naive_index_construction(index_graph, index_graph.E);
+                construction_peak = get_peak_memory_usage_kb();
+            }
             auto end_time = std::chrono::high_resolution_clock::now();
             
             auto duration = std::chrono::duration<double>(end_time - start_time).count();
             
             std::cout << "\n🎉 Naive Index Construction Results:" << std::endl;
             std::cout << "   ⏱️  Construction time: " << std::fixed << std::setprecision(6) << duration << " seconds" << std::endl;
-            std::cout << "   📊 Index levels (g-values): " << naive_tree->children.size() << std::endl;
+            std::cout << "   📊 Index levels (g-values): " << naive_index.num_levels()
+                      << " (" << naive_index.num_stored_levels() << " stored, " << naive_index.stored_leaves()
+                      << " k-runs for " << naive_index.num_leaves() << " leaves)" << std::endl;
+            if (!report_memory_budget(construction_peak)) return 1;
             
             // 구성 후 메모리 측정
             size_t memory_after = get_memory_usage_kb();
@@ -841,34 +1656,24 @@ int main(int argc, char* argv[]) {
             std::cout << "   💾 Memory usage: " << format_memory(memory_used) << std::endl;
             
             // 인덱스 자체 메모리 추정
-            size_t estimated_tree_size = tree_memory(naive_tree);
+            size_t estimated_tree_size = naive_index.memory_bytes();
             std::cout << "   📦 Estimated index size: " << format_memory(estimated_tree_size / 1024) << std::endl;
             
             // === 노드 개수 계산 ===
-            int total_index_nodes = 0;
-            std::function<void(const std::shared_ptr<TreeNode>&)> count_nodes = 
-                [&](const std::shared_ptr<TreeNode>& node) {
-                    if (!node) return;
-                    total_index_nodes += node->value.size();
-                    for (const auto& aux_pair : node->aux) {
-                        total_index_nodes += aux_pair.second.size();
-                    }
-                    for (const auto& child : node->children) {
-                        count_nodes(child);
-                    }
-                };
-            count_nodes(naive_tree);
-            std::cout << "   📝 Total index node references: " << total_index_nodes << std::endl;
+            int total_index_nodes = naive_index.referenced_nodes();
+            std::cout << "   📝 Total index node references: " << total_index_nodes
+                      << " (" << naive_index.stored_nodes() << " stored after deduplication)" << std::endl;
             
             // === Percentile Query Selection and Benchmarking ===
             std::cout << "\n=== Percentile Query Benchmarking ===" << std::endl;
             
             // Leaf node 수집
-            auto leaf_nodes = collect_leaf_nodes(naive_tree);
+            auto leaf_nodes = collect_leaf_nodes(naive_index);
             std::cout << "   📊 Found " << leaf_nodes.size() << " leaf nodes" << std::endl;
             
             // 벤치마크 변수들 초기화
             double total_query_time = 0.0;
+            size_t total_result_nodes = 0;
             std::vector<std::pair<int, int>> selected_queries;
             
             if (leaf_nodes.empty()) {
@@ -904,16 +1709,17 @@ int main(int argc, char* argv[]) {
                     
                     // 쿼리 실행 및 시간 측정
                     auto query_start = std::chrono::high_resolution_clock::now();
-                    auto query_result = querying_for_naive_index(naive_tree, query.first, query.second);
+                    auto query_result = querying_for_naive_index(naive_index, query.first, query.second);
                     auto query_end = std::chrono::high_resolution_clock::now();
                     
                     double query_time = std::chrono::duration<double>(query_end - query_start).count();
                     total_query_time += query_time;
+                    total_result_nodes += query_result.size();
                 }
                 
                 // 벤치마크 결과 출력
                 std::cout << "\n🎉 Naive Index Query Benchmark Results:" << std::endl;
-                std::cout << "   📊 Total queries executed: " << selected_queries.size() << std::endl;
+                std::cout << "   📊 Total queries executed: " << selected_queries.size() << " (" << total_result_nodes << " result nodes)" << std::endl;
                 std::cout << "   ⏱️  Total query time: " << std::fixed << std::setprecision(6) << total_query_time << " seconds" << std::endl;
                 std::cout << "   ⚡ Average query time: " << std::fixed << std::setprecision(8) 
                           << total_query_time / selected_queries.size() << " seconds" << std::endl;
@@ -927,9 +1733,9 @@ int main(int argc, char* argv[]) {
             int simple_query_result_size = 0;
             double simple_query_time = 0.0;
             
-            if (naive_tree->children.size() > 0 && naive_tree->children[0]->children.size() > 0) {
+            if (naive_index.num_levels() > 0 && naive_index.level_size(1) > 0) {
                 auto query_start = std::chrono::high_resolution_clock::now();
-                const auto& query_result = querying_for_naive_index(naive_tree, 1, 1);
+                const auto& query_result = querying_for_naive_index(naive_index, 1, 1);
                 auto query_end = std::chrono::high_resolution_clock::now();
                 
                 simple_query_time = std::chrono::duration<double>(query_end - query_start).count();
@@ -970,7 +1776,7 @@ int main(int argc, char* argv[]) {
                 csv_out << dataset_name << ",";
                 csv_out << std::fixed << std::setprecision(6);
                 csv_out << duration << "," << memory_used << "," << (memory_used * 1024) << "," << total_index_nodes << ",";
-                csv_out << naive_tree->children.size() << "," << selected_queries.size() << ",";
+                csv_out << naive_index.num_levels() << "," << selected_queries.size() << ",";
                 csv_out << total_query_time << ",";
                 
                 if (selected_queries.size() > 0) {
@@ -1005,7 +1811,7 @@ int main(int argc, char* argv[]) {
             }
             
             // 메모리 정리
-            naive_tree.reset();
+            naive_index = NaiveIndex();
             std::cout << "   🗑️  Index cleaned up" << std::endl;
         } else if (test_one_level) {
             // one-level compression 인덱스 구성 테스트
@@ -1018,13 +1824,33 @@ int main(int argc, char* argv[]) {
             std::cout << "🔧 Building one-level compression index..." << std::endl;
             std::cout << "💾 Memory before construction: " << format_memory(memory_before) << std::endl;
             
+            // 메모리 예산이 있으면 레벨마다 집합을 바로 index_dir/one_level.kgi에 쓰고, 다 만든 뒤 다시 불러옴
+            bool external_build = g_build_config.memory_budget_kb > 0 && !index_dir.empty();
+            if (g_build_config.memory_budget_kb > 0 && index_dir.empty()) {
+                std::cerr << "⚠️  --memory-budget without --index-dir: the index itself stays in memory and counts against the budget" << std::endl;
+            }
+            
             auto start_time = std::chrono::high_resolution_clock::now();
-            auto one_level_tree = one_level_compression(hypergraph, hypergraph.E);
+            FlatIndex one_level_index;
+            size_t peak_after = 0;
+            if (external_build) {
+                std::filesystem::create_directories(index_dir);
+                std::string file = index_dir + "/one_level.kgi";
+                if (!build_one_level_index_file(index_graph, index_graph.E, file, make_index_metadata("one_level", hypergraph_file, index_graph, 0.0))) {
+                    std::cerr << "❌ External one-level construction failed" << std::endl;
+                    return 1;
+                }
+                peak_after = get_peak_memory_usage_kb();
+                std::cout << "   💾 Written to " << file << " (" << format_memory(get_file_size(file) / 1024) << ")" << std::endl;
+                if (!load_flat_index(file, one_level_index)) return 1;
+            } else {
+                one_level_index = flatten_index(one_level_compression(index_graph, index_graph.E));
+                peak_after = get_peak_memory_usage_kb();
+            }
             auto end_time = std::chrono::high_resolution_clock::now();
             
             // 구성 후 메모리 측정
             size_t memory_after = get_memory_usage_kb();
-            size_t peak_after = get_peak_memory_usage_kb();
             size_t memory_used = memory_after - memory_before;
             size_t peak_used = peak_after - peak_before;
             
@@ -1032,38 +1858,41 @@ int main(int argc, char* argv[]) {
             
             std::cout << "\n🎉 One-Level Compression Results:" << std::endl;
             std::cout << "   ⏱️  Construction time: " << std::fixed << std::setprecision(6) << duration << " seconds" << std::endl;
-            std::cout << "   📊 Index levels (g-values): " << one_level_tree->children.size() << std::endl;
+            std::cout << "   📊 Index levels (g-values): " << one_level_index.num_levels() << std::endl;
             
             // 메모리 정보
             std::cout << "\n💾 Memory Usage Analysis:" << std::endl;
             std::cout << "   Current memory: " << format_memory(memory_after) << std::endl;
             std::cout << "   Memory increase: " << format_memory(memory_used) << std::endl;
             std::cout << "   Peak memory increase: " << format_memory(peak_used) << std::endl;
+            if (!report_memory_budget(peak_after)) return 1;
             
             // 인덱스 자체 메모리 추정
-            size_t estimated_tree_size = tree_memory(one_level_tree);
+            size_t estimated_tree_size = one_level_index.memory_bytes();
             std::cout << "   Estimated index size: " << format_memory(estimated_tree_size / 1024) << std::endl;
+            if (!one_level_index.sets.empty()) {
+                std::cout << "   Leaf set encoding: " << format_memory(one_level_index.raw_set_bytes / 1024) << " as int arrays → "
+                          << format_memory(one_level_index.sets.size() / 1024) << " encoded (" << std::fixed << std::setprecision(2)
+                          << (double)one_level_index.raw_set_bytes / one_level_index.sets.size() << "x)" << std::endl;
+            }
             std::cout << "   Memory efficiency: " << std::fixed << std::setprecision(1) 
                       << (double)estimated_tree_size / (hypergraph.nodes().size() * sizeof(int)) << "x original data" << std::endl;
             
             // 각 레벨별 통계
             std::cout << "\n📈 Index Structure Analysis:" << std::endl;
             int total_cores = 0;
-            for (int g = 0; g < (int)one_level_tree->children.size(); g++) {
-                int level_cores = one_level_tree->children[g]->children.size();
+            for (int g = 1; g <= one_level_index.num_levels(); g++) {
+                int level_cores = one_level_index.level_size(g);
                 total_cores += level_cores;
             }
             
             std::cout << "   📊 Total cores: " << total_cores << std::endl;
             
             // 인덱스 크기 분석
-            int total_entries = 0;
-            for (int g = 0; g < (int)one_level_tree->children.size(); g++) {
-                for (int k = 0; k < (int)one_level_tree->children[g]->children.size(); k++) {
-                    total_entries += one_level_tree->children[g]->children[k]->value.size();
-                }
-            }
+            int total_entries = count_total_nodes(one_level_index, "one_level");
             std::cout << "   📝 Total index entries: " << total_entries << std::endl;
+            std::cout << "   🔁 Stored g-levels: " << one_level_index.num_stored_levels() << " of " << one_level_index.num_levels()
+                      << " (identical consecutive levels stored as runs)" << std::endl;
             std::cout << "   🔍 Storage overhead: " << std::fixed << std::setprecision(2) 
                       << (double)total_entries / hypergraph.nodes().size() << "x original nodes" << std::endl;
             
@@ -1086,7 +1915,9 @@ int main(int argc, char* argv[]) {
             std::cout << "💾 Memory before construction: " << format_memory(memory_before) << std::endl;
             
             auto start_time = std::chrono::high_resolution_clock::now();
-            auto [jump_tree, compression_rate] = jump_compression(hypergraph, hypergraph.E);
+            auto [jump_tree, compression_rate] = jump_compression(index_graph, index_graph.E);
+            auto jump_index = flatten_index(jump_tree);
+            jump_tree.reset();
             auto end_time = std::chrono::high_resolution_clock::now();
             
             // 구성 후 메모리 측정
@@ -1099,7 +1930,7 @@ int main(int argc, char* argv[]) {
             
             std::cout << "\n🎉 Jump Compression Results:" << std::endl;
             std::cout << "   ⏱️  Construction time: " << std::fixed << std::setprecision(6) << duration << " seconds" << std::endl;
-            std::cout << "   📊 Index levels (g-values): " << jump_tree->children.size() << std::endl;
+            std::cout << "   📊 Index levels (g-values): " << jump_index.num_levels() << std::endl;
             std::cout << "   🗜️  Compression rate: " << std::fixed << std::setprecision(2) << compression_rate << std::endl;
             
             // 메모리 정보
@@ -1109,29 +1940,31 @@ int main(int argc, char* argv[]) {
             std::cout << "   Peak memory increase: " << format_memory(peak_used) << std::endl;
             
             // 인덱스 자체 메모리 추정
-            size_t estimated_tree_size = tree_memory(jump_tree);
+            size_t estimated_tree_size = jump_index.memory_bytes();
             std::cout << "   Estimated index size: " << format_memory(estimated_tree_size / 1024) << std::endl;
+            if (!jump_index.sets.empty()) {
+                std::cout << "   Leaf set encoding: " << format_memory(jump_index.raw_set_bytes / 1024) << " as int arrays → "
+                          << format_memory(jump_index.sets.size() / 1024) << " encoded (" << std::fixed << std::setprecision(2)
+                          << (double)jump_index.raw_set_bytes / jump_index.sets.size() << "x)" << std::endl;
+            }
             std::cout << "   Memory efficiency: " << std::fixed << std::setprecision(1) 
                       << (double)estimated_tree_size / (hypergraph.nodes().size() * sizeof(int)) << "x original data" << std::endl;
             
             // 각 레벨별 통계
             std::cout << "\n📈 Index Structure Analysis:" << std::endl;
             int total_cores = 0;
-            for (int g = 0; g < (int)jump_tree->children.size(); g++) {
-                int level_cores = jump_tree->children[g]->children.size();
+            for (int g = 1; g <= jump_index.num_levels(); g++) {
+                int level_cores = jump_index.level_size(g);
                 total_cores += level_cores;
             }
             
             std::cout << "   📊 Total cores: " << total_cores << std::endl;
             
             // 인덱스 크기 분석
-            int total_entries = 0;
-            for (int g = 0; g < (int)jump_tree->children.size(); g++) {
-                for (int k = 0; k < (int)jump_tree->children[g]->children.size(); k++) {
-                    total_entries += jump_tree->children[g]->children[k]->value.size();
-                }
-            }
+            int total_entries = count_total_nodes(jump_index, "one_level");
             std::cout << "   📝 Total index entries: " << total_entries << std::endl;
+            std::cout << "   🔁 Stored g-levels: " << jump_index.num_stored_levels() << " of " << jump_index.num_levels()
+                      << " (identical consecutive levels stored as runs)" << std::endl;
             std::cout << "   🔍 Storage overhead: " << std::fixed << std::setprecision(2) 
                       << (double)total_entries / hypergraph.nodes().size() << "x original nodes" << std::endl;
             
@@ -1201,6 +2034,7 @@ int main(int argc, char* argv[]) {
             double naive_query_total = 0.0, one_level_query_total = 0.0;
             double jump_query_total = 0.0, diagonal_query_total = 0.0;
             double find_kg_core_total = 0.0;
+            size_t naive_result_nodes = 0;
             
             std::vector<std::pair<int, int>> benchmark_queries;
             
@@ -1215,11 +2049,12 @@ int main(int argc, char* argv[]) {
                 // === Step 1: One-Level ===
                 std::cout << "  🔧 Building One-Level..." << std::endl;
                 auto step1_start = std::chrono::high_resolution_clock::now();
-                auto progressive_tree = one_level_compression(hypergraph, hypergraph.E);
+                auto progressive_tree = one_level_compression(index_graph, index_graph.E);
                 auto step1_end = std::chrono::high_resolution_clock::now();
                 
                 step1_time = std::chrono::duration<double>(step1_end - step1_start).count();
-                one_level_memory = tree_memory(progressive_tree);
+                auto one_level_index = flatten_index(progressive_tree);
+                one_level_memory = one_level_index.memory_bytes();
                 one_level_nodes = calculate_total_node_references(progressive_tree);
                 
                 std::cout << "     ✅ One-Level: " << std::fixed << std::setprecision(3) << step1_time << "s, " 
@@ -1229,9 +2064,10 @@ int main(int argc, char* argv[]) {
                 std::cout << "  🎯 Generating benchmark queries from One-Level index..." << std::endl;
                 std::set<std::pair<int, int>> valid_queries;
                 
-                for (int g = 0; g < (int)progressive_tree->children.size(); g++) {
-                    for (int k = 0; k < (int)progressive_tree->children[g]->children.size(); k++) {
-                        valid_queries.insert({k + 1, g + 1});
+                for (int g = 1; g <= tree_max_g(progressive_tree); g++) {
+                    int level = tree_level_of(progressive_tree, g);
+                    for (int k = 0; k < (int)progressive_tree->children[level]->children.size(); k++) {
+                        valid_queries.insert({k + 1, g});
                     }
                 }
                 
@@ -1257,11 +2093,12 @@ int main(int argc, char* argv[]) {
                 std::cout << "     🔍 One-Level queries..." << std::endl;
                 for (const auto& query : benchmark_queries) {
                     auto start = std::chrono::high_resolution_clock::now();
-                    auto result = querying_for_one_level(progressive_tree, query.first, query.second);
+                    auto result = querying_for_one_level(one_level_index, query.first, query.second);
                     auto end = std::chrono::high_resolution_clock::now();
                     one_level_query_total += std::chrono::duration<double>(end - start).count();
                 }
                 std::cout << "     ⚡ " << std::fixed << std::setprecision(6) << one_level_query_total << "s" << std::endl;
+                one_level_index = FlatIndex();
                 
                 // === Step 2: Jump (기존 트리 수정) ===
                 std::cout << "  🔧 Upgrading to Jump..." << std::endl;
@@ -1275,15 +2112,9 @@ int main(int argc, char* argv[]) {
                         if (k < (int)progressive_tree->children[g]->children.size()) {
                             progressive_tree->children[g]->children[k]->jump = progressive_tree->children[g + 1]->children[k];
                             
-                            std::unordered_set<int> difference;
-                            const auto& current_value = progressive_tree->children[g]->children[k]->value;
-                            const auto& jump_value = progressive_tree->children[g]->children[k]->jump->value;
-                            
-                            for (int node : current_value) {
-                                if (jump_value.find(node) == jump_value.end()) {
-                                    difference.insert(node);
-                                }
-                            }
+                            std::vector<int> difference;
+                            sorted_difference(progressive_tree->children[g]->children[k]->value,
+                                              progressive_tree->children[g + 1]->children[k]->value, difference);
                             progressive_tree->children[g]->children[k]->value = std::move(difference);
                         }
                     }
@@ -1291,7 +2122,8 @@ int main(int argc, char* argv[]) {
                 
                 auto step2_end = std::chrono::high_resolution_clock::now();
                 step2_time = std::chrono::duration<double>(step2_end - step2_start).count();
-                jump_memory = tree_memory(progressive_tree);
+                auto jump_index = flatten_index(progressive_tree);
+                jump_memory = jump_index.memory_bytes();
                 jump_nodes = calculate_total_node_references(progressive_tree);
                 
                 std::cout << "     ✅ Jump: +" << std::fixed << std::setprecision(3) << step2_time << "s, " 
@@ -1301,39 +2133,17 @@ int main(int argc, char* argv[]) {
                 std::cout << "     🔍 Jump queries..." << std::endl;
                 for (const auto& query : benchmark_queries) {
                     auto start = std::chrono::high_resolution_clock::now();
-                    auto result = querying_for_two_level(progressive_tree, query.first, query.second);
+                    auto result = querying_for_two_level(jump_index, query.first, query.second);
                     auto end = std::chrono::high_resolution_clock::now();
                     jump_query_total += std::chrono::duration<double>(end - start).count();
                 }
                 std::cout << "     ⚡ " << std::fixed << std::setprecision(6) << jump_query_total << "s" << std::endl;
+                jump_index = FlatIndex();
                 
                 // === Step 3: Diagonal (기존 트리 수정) ===
                 std::cout << "  🔧 Upgrading to Diagonal..." << std::endl;
                 auto step3_start = std::chrono::high_resolution_clock::now();
                 
-                // 집합 연산 헬퍼 함수들
-                auto set_intersection = [](const std::unordered_set<int>& set1, const std::unordered_set<int>& set2) {
-                    std::unordered_set<int> result;
-                    result.reserve(std::min(set1.size(), set2.size()));
-                    for (int element : set1) {
-                        if (set2.find(element) != set2.end()) {
-                            result.insert(element);
-                        }
-                    }
-                    return result;
-                };
-                
-                auto set_difference = [](const std::unordered_set<int>& set1, const std::unordered_set<int>& set2) {
-                    std::unordered_set<int> result;
-                    result.reserve(set1.size());
-                    for (int element : set1) {
-                        if (set2.find(element) == set2.end()) {
-                            result.insert(element);
-                        }
-                    }
-                    return result;
-                };
-                
                 // Diagonal compression logic
                 for (int g = 0; g < (int)progressive_tree->children.size(); g++) {
                     if (progressive_tree->children[g]->children.empty()) continue;
@@ -1389,7 +2199,8 @@ int main(int argc, char* argv[]) {
                 
                 auto step3_end = std::chrono::high_resolution_clock::now();
                 step3_time = std::chrono::duration<double>(step3_end - step3_start).count();
-                diagonal_memory = tree_memory(progressive_tree);
+                auto diagonal_index = flatten_index(progressive_tree);
+                diagonal_memory = diagonal_index.memory_bytes();
                 diagonal_nodes = calculate_total_node_references(progressive_tree);
                 
                 std::cout << "     ✅ Diagonal: +" << std::fixed << std::setprecision(3) << step3_time << "s, " 
@@ -1399,7 +2210,7 @@ int main(int argc, char* argv[]) {
                 std::cout << "     🔍 Diagonal queries..." << std::endl;
                 for (const auto& query : benchmark_queries) {
                     auto start = std::chrono::high_resolution_clock::now();
-                    auto result = querying_for_diagonal(progressive_tree, query.first, query.second);
+                    auto result = querying_for_diagonal(diagonal_index, query.first, query.second);
                     auto end = std::chrono::high_resolution_clock::now();
                     diagonal_query_total += std::chrono::duration<double>(end - start).count();
                 }
@@ -1410,6 +2221,7 @@ int main(int argc, char* argv[]) {
                 
                 // === 🗑️ Progressive 인덱스들 정리 ===
                 progressive_tree.reset();
+                diagonal_index = FlatIndex();
                 size_t memory_cleaned = get_memory_usage_kb();
                 std::cout << "  🗑️  Progressive indexes DELETED. Memory: " << format_memory(memory_cleaned) << std::endl;
                 
@@ -1431,12 +2243,12 @@ int main(int argc, char* argv[]) {
                 std::cout << "  ⚠️  This will likely use the most memory..." << std::endl;
                 
                 auto naive_start = std::chrono::high_resolution_clock::now();
-                auto naive_tree = naive_index_construction(hypergraph, hypergraph.E);
+                auto naive_index = naive_index_construction(index_graph, index_graph.E);
                 auto naive_end = std::chrono::high_resolution_clock::now();
                 
                 naive_time = std::chrono::duration<double>(naive_end - naive_start).count();
-                naive_memory = tree_memory(naive_tree);
-                naive_nodes = calculate_total_node_references(naive_tree);
+                naive_memory = naive_index.memory_bytes();
+                naive_nodes = naive_index.referenced_nodes();
                 
                 size_t memory_after = get_memory_usage_kb();
                 
@@ -1455,15 +2267,17 @@ int main(int argc, char* argv[]) {
                     
                     // naive query 측정
                     start = std::chrono::high_resolution_clock::now();
-                    auto result2 = querying_for_naive_index(naive_tree, query.first, query.second);
+                    auto result2 = querying_for_naive_index(naive_index, query.first, query.second);
                     end = std::chrono::high_resolution_clock::now();
                     naive_query_total += std::chrono::duration<double>(end - start).count();
+                    naive_result_nodes += result2.size();
                 }
                 std::cout << "  ✅ Benchmarks completed: " << std::fixed << std::setprecision(6) 
-                          << naive_query_total << "s (naive), " << find_kg_core_total << "s (find_kg_core)" << std::endl;
+                          << naive_query_total << "s (naive, " << naive_result_nodes << " result nodes), "
+                          << find_kg_core_total << "s (find_kg_core)" << std::endl;
                 
                 // === 🗑️ NAIVE INDEX 삭제 ===
-                naive_tree.reset();
+                naive_index = NaiveIndex();
                 size_t memory_final = get_memory_usage_kb();
                 std::cout << "  🗑️ Naive index DELETED. Memory: " << format_memory(memory_final) << std::endl;
             }
@@ -1535,6 +2349,246 @@ int main(int argc, char* argv[]) {
             std::cout << "  ✅ All progressive indexes built from single construction call" << std::endl;
             std::cout << "  ✅ Naive (largest) processed last when progressive indexes are cleared" << std::endl;
             std::cout << "  ✅ Immediate cleanup after each phase" << std::endl;
+        } else if (kernel_bench_mode) {
+            // 이웃 카운트 커널 단독 비교: 해시맵 vs 밀집 카운터 (리셋 / epoch) vs 작은 g 특수화
+            std::cout << "\n=== Counting Kernel Benchmark ===" << std::endl;
+            
+            int max_node = 0;
+            for (const auto& pair : index_graph.node_hyperedges) {
+                max_node = std::max(max_node, pair.first);
+            }
+            std::vector<bool> active(max_node + 1, false);
+            std::vector<int> node_list;
+            for (const auto& pair : index_graph.node_hyperedges) {
+                active[pair.first] = true;
+                node_list.push_back(pair.first);
+            }
+            std::sort(node_list.begin(), node_list.end());
+            
+            const int rounds = 5;
+            std::vector<int> g_values = {g};
+            if (g == 1) g_values = {1, 2, 3};
+            
+            // 워밍업 (스크래치 배열 할당, 페이지 폴트를 측정에서 제외)
+            for (int v : node_list) count_valid_neighbors_with_bitmap(index_graph, v, g_values[0], active, max_node);
+            for (int v : node_list) count_valid_neighbors_dense(index_graph, v, g_values[0], active, max_node, false);
+            for (int v : node_list) count_valid_neighbors_dense(index_graph, v, g_values[0], active, max_node, true);
+            
+            for (int bench_g : g_values) {
+                long long hash_total = 0, reset_total = 0, epoch_total = 0, small_total = 0;
+                
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int r = 0; r < rounds; r++) {
+                    for (int v : node_list) hash_total += count_valid_neighbors_with_bitmap(index_graph, v, bench_g, active, max_node);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                double hash_time = std::chrono::duration<double>(end - start).count();
+                
+                start = std::chrono::high_resolution_clock::now();
+                for (int r = 0; r < rounds; r++) {
+                    for (int v : node_list) reset_total += count_valid_neighbors_dense(index_graph, v, bench_g, active, max_node, false);
+                }
+                end = std::chrono::high_resolution_clock::now();
+                double reset_time = std::chrono::duration<double>(end - start).count();
+                
+                start = std::chrono::high_resolution_clock::now();
+                for (int r = 0; r < rounds; r++) {
+                    for (int v : node_list) epoch_total += count_valid_neighbors_dense(index_graph, v, bench_g, active, max_node, true);
+                }
+                end = std::chrono::high_resolution_clock::now();
+                double epoch_time = std::chrono::duration<double>(end - start).count();
+                
+                start = std::chrono::high_resolution_clock::now();
+                small_total = sum_valid_neighbors_small_g(index_graph, node_list, bench_g, rounds);
+                end = std::chrono::high_resolution_clock::now();
+                double small_time = std::chrono::duration<double>(end - start).count();
+                
+                std::cout << "\n📊 g=" << bench_g << " (" << node_list.size() << " nodes x " << rounds << " rounds)" << std::endl;
+                std::cout << "   Hash map:      " << std::fixed << std::setprecision(6) << hash_time << "s" << std::endl;
+                std::cout << "   Dense (reset): " << reset_time << "s (" << std::setprecision(2) << hash_time / reset_time << "x)" << std::endl;
+                std::cout << "   Dense (epoch): " << std::setprecision(6) << epoch_time << "s (" << std::setprecision(2) << hash_time / epoch_time << "x)" << std::endl;
+                
+                std::cout << "   Specialized:   " << std::setprecision(6) << small_time << "s (" << std::setprecision(2) << hash_time / small_time << "x)" << std::endl;
+                
+                if (hash_total == reset_total && hash_total == epoch_total && hash_total == small_total) {
+                    std::cout << "   ✅ All kernels agree (" << hash_total << " valid neighbors)" << std::endl;
+                } else {
+                    std::cout << "   ⚠️  Kernel results differ: " << hash_total << " / " << reset_total << " / " << epoch_total << " / " << small_total << std::endl;
+                }
+            }
+        } else if (set_kernel_bench_mode) {
+            // 정렬 배열 교집합/차집합 커널 비교: 크기가 비슷한 경우와 한쪽이 훨씬 작은 경우
+            std::cout << "\n=== Set Kernel Benchmark ===" << std::endl;
+            
+            std::vector<SetKernel> kernels;
+            for (SetKernel kernel : {SetKernel::Scalar, SetKernel::SSE41, SetKernel::AVX2}) {
+                if (set_kernel_supported(kernel)) kernels.push_back(kernel);
+            }
+            SetKernel default_kernel = active_set_kernel();
+            
+            std::mt19937 rng(42);
+            auto random_sorted = [&](size_t count, int universe) {
+                std::unordered_set<int> picked;
+                while (picked.size() < count) picked.insert(rng() % universe);
+                std::vector<int> sorted(picked.begin(), picked.end());
+                std::sort(sorted.begin(), sorted.end());
+                return sorted;
+            };
+            
+            // (큰 쪽, 작은 쪽) 크기, 노드 ID 범위는 큰 쪽의 4배
+            const std::vector<std::pair<size_t, size_t>> shapes = {
+                {10000, 10000}, {100000, 100000}, {100000, 10000}, {100000, 1000}, {100000, 100}};
+            const size_t work = 20000000;  // 조합마다 처리할 원소 수 (반복 횟수 결정)
+            
+            for (const auto& shape : shapes) {
+                auto a = random_sorted(shape.first, shape.first * 4);
+                auto b = random_sorted(shape.second, shape.first * 4);
+                int rounds = std::max<size_t>(1, work / (a.size() + b.size()));
+                
+                std::cout << "\n📊 |A|=" << a.size() << ", |B|=" << b.size() << " (" << rounds << " rounds)" << std::endl;
+                
+                double scalar_intersect = 0.0, scalar_difference = 0.0;
+                size_t expected_intersect = 0, expected_difference = 0;
+                for (SetKernel kernel : kernels) {
+                    select_set_kernel(kernel);
+                    std::vector<int> out;
+                    size_t intersect_total = 0, difference_total = 0;
+                    
+                    auto start = std::chrono::high_resolution_clock::now();
+                    for (int r = 0; r < rounds; r++) {
+                        sorted_intersection(a, b, out);
+                        intersect_total += out.size();
+                    }
+                    auto end = std::chrono::high_resolution_clock::now();
+                    double intersect_time = std::chrono::duration<double>(end - start).count();
+                    
+                    start = std::chrono::high_resolution_clock::now();
+                    for (int r = 0; r < rounds; r++) {
+                        sorted_difference(a, b, out);
+                        difference_total += out.size();
+                    }
+                    end = std::chrono::high_resolution_clock::now();
+                    double difference_time = std::chrono::duration<double>(end - start).count();
+                    
+                    if (kernel == SetKernel::Scalar) {
+                        scalar_intersect = intersect_time;
+                        scalar_difference = difference_time;
+                        expected_intersect = intersect_total;
+                        expected_difference = difference_total;
+                    }
+                    
+                    std::cout << "   " << std::left << std::setw(8) << set_kernel_name(kernel) << std::right
+                              << " ∩ " << std::fixed << std::setprecision(6) << intersect_time << "s ("
+                              << std::setprecision(2) << scalar_intersect / intersect_time << "x), "
+                              << "\\ " << std::setprecision(6) << difference_time << "s ("
+                              << std::setprecision(2) << scalar_difference / difference_time << "x)";
+                    if (intersect_total != expected_intersect || difference_total != expected_difference) {
+                        std::cout << " ⚠️  results differ from scalar";
+                    }
+                    std::cout << std::endl;
+                }
+            }
+            
+            // 실제 diagonal 압축 전체 시간 (커널별)
+            std::cout << "\n📊 Diagonal compression on " << hypergraph_file << std::endl;
+            for (SetKernel kernel : kernels) {
+                select_set_kernel(kernel);
+                auto start = std::chrono::high_resolution_clock::now();
+                auto diagonal = diagonal_compression(index_graph, index_graph.E);
+                auto end = std::chrono::high_resolution_clock::now();
+                std::cout << "   " << std::left << std::setw(8) << set_kernel_name(kernel) << std::right << " "
+                          << std::fixed << std::setprecision(3) << std::chrono::duration<double>(end - start).count()
+                          << "s (" << count_total_nodes(std::get<0>(diagonal), "diag") << " stored nodes)" << std::endl;
+            }
+            select_set_kernel(default_kernel);
+        } else if (load_bench_mode) {
+            // 시작 시간 비교: 인덱스 파일(--index-dir의 *.kgi)과 하이퍼그래프 스냅샷을 경로별로 읽음
+            // 콜드는 매 회 파일을 페이지 캐시에서 내린 뒤, 웜은 캐시에 있는 상태
+            std::cout << "\n=== Load Path Benchmark ===" << std::endl;
+            if (index_dir.empty()) {
+                std::cerr << "⚠️  --bench-load needs --index-dir with saved indexes" << std::endl;
+                return 1;
+            }
+            
+            std::string snapshot_file = index_dir + "/hypergraph.kgh";
+            std::filesystem::create_directories(index_dir);
+            if (!std::filesystem::exists(snapshot_file)) {
+                save_hypergraph_snapshot(hypergraph, snapshot_file);
+            }
+            
+            std::vector<IoBackend> backends = {IoBackend::Pread};
+            if (io_backend_supported(IoBackend::Uring)) backends.push_back(IoBackend::Uring);
+            IoBackend default_backend = active_io_backend();
+            const int rounds = 10;
+            
+            // rounds번 반복한 평균 시간 (cold면 매번 캐시를 내림)
+            auto measure = [&](const std::string& file, bool cold, const std::function<bool()>& load) {
+                double total = 0.0;
+                for (int r = 0; r < rounds; r++) {
+                    if (cold) drop_file_cache(file);
+                    auto start = std::chrono::high_resolution_clock::now();
+                    if (!load()) return -1.0;
+                    total += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+                }
+                return total / rounds;
+            };
+            auto print_row = [&](const std::string& path, double cold, double warm) {
+                std::cout << "   " << std::left << std::setw(18) << path << std::right << std::fixed << std::setprecision(6)
+                          << " cold " << cold << "s, warm " << warm << "s" << std::endl;
+            };
+            
+            for (const std::string type : {"naive", "one_level", "jump", "diagonal"}) {
+                std::string file = index_dir + "/" + type + ".kgi";
+                if (!std::filesystem::exists(file)) continue;
+                std::cout << "\n📊 " << file << " (" << format_memory(get_file_size(file) / 1024) << ")" << std::endl;
+                
+                for (IoBackend backend : backends) {
+                    select_io_backend(backend);
+                    auto load = [&] {
+                        if (type == "naive") {
+                            NaiveIndex index;
+                            return load_naive_index(file, index);
+                        }
+                        FlatIndex index;
+                        return load_flat_index(file, index);
+                    };
+                    print_row(io_backend_name(backend), measure(file, true, load), measure(file, false, load));
+                }
+                if (type == "naive") continue;
+                
+                // mmap: 열기만 (쿼리가 필요한 페이지만 나중에 읽음) / 열고 모든 집합 페이지를 건드림
+                auto map_only = [&] {
+                    MappedIndex mapped;
+                    return mapped.open(file);
+                };
+                auto map_touch = [&] {
+                    MappedIndex mapped;
+                    if (!mapped.open(file, MapOptions{MapAdvice::Sequential, false, false})) return false;
+                    const FlatIndexView& view = mapped.view();
+                    volatile uint8_t sink = 0;
+                    for (size_t i = 0; i < view.sets.size(); i += 4096) sink = sink + view.sets[i];
+                    return true;
+                };
+                print_row("mmap (open)", measure(file, true, map_only), measure(file, false, map_only));
+                print_row("mmap (touch all)", measure(file, true, map_touch), measure(file, false, map_touch));
+            }
+            
+            std::cout << "\n📊 Hypergraph: " << hypergraph_file << " vs " << snapshot_file << " ("
+                      << format_memory(get_file_size(snapshot_file) / 1024) << ")" << std::endl;
+            if (!is_snapshot) {
+                auto parse_text = [&] { return !load_hypergraph(hypergraph_file).E.empty(); };
+                print_row("text parse", measure(hypergraph_file, true, parse_text), measure(hypergraph_file, false, parse_text));
+            }
+            for (IoBackend backend : backends) {
+                select_io_backend(backend);
+                auto load_snapshot = [&] {
+                    Hypergraph loaded;
+                    return load_hypergraph_snapshot(snapshot_file, loaded);
+                };
+                print_row(std::string("snapshot ") + io_backend_name(backend),
+                          measure(snapshot_file, true, load_snapshot), measure(snapshot_file, false, load_snapshot));
+            }
+            select_io_backend(default_backend);
         }
         
         else {
@@ -1566,6 +2620,8 @@ int main(int argc, char* argv[]) {
             std::cout << "   " << argv[0] << " --file=" << hypergraph_file << " --test-diagonal" << std::endl;
         }
         
+        task_runtime().print_utilization(mode_label);
+        
         std::cout << "\n✅ Program completed successfully!" << std::endl;
         
     } catch (const std::exception& e) {
@@ -1576,13 +2632,12 @@ int main(int argc, char* argv[]) {
     return 0;
 }
 
-std::vector<LeafNodeInfo> collect_leaf_nodes(const std::shared_ptr<TreeNode>& naive_tree) {
+std::vector<LeafNodeInfo> collect_leaf_nodes(const NaiveIndex& naive_index) {
     std::vector<LeafNodeInfo> leaf_nodes;
     
-    for (int g = 0; g < (int)naive_tree->children.size(); g++) {
-        for (int k = 0; k < (int)naive_tree->children[g]->children.size(); k++) {
-            auto& leaf = naive_tree->children[g]->children[k];
-            size_t node_size = leaf->value.size();
+    for (int g = 0; g < naive_index.num_levels(); g++) {
+        for (int k = 0; k < naive_index.level_size(g + 1); k++) {
+            size_t node_size = naive_index.query(k + 1, g + 1).size();
             
             // k는 1부터 시작, g도 1부터 시작
             leaf_nodes.emplace_back(k + 1, g + 1, node_size);
@@ -1,24 +1,39 @@
 #include "kg_index.h"
+#include <cctype>
+#include <climits>
+#include <numeric>
 
+int tree_level_of(const std::shared_ptr<TreeNode>& tree, int g) {
+    if (!tree) return -1;
+    
+    // run 표가 없는 트리 (직접 만든 트리 등)는 레벨마다 children 하나
+    if (tree->level_runs.empty()) {
+        return (g <= 0 || g > (int)tree->children.size()) ? -1 : g - 1;
+    }
+    return tree->level_runs.level_of(g);
+}
+
+int tree_max_g(const std::shared_ptr<TreeNode>& tree) {
+    if (!tree) return 0;
+    return tree->level_runs.empty() ? (int)tree->children.size() : tree->level_runs.max_g();
+}
 
 // One level 인덱스 쿼리
 std::unordered_set<int> querying_for_one_level(const std::shared_ptr<TreeNode>& tree, int k, int g) {
     std::unordered_set<int> empty_result;
     
-    if (!tree || tree->children.empty()) return empty_result;
-    
-    int max_g = tree->children.size();
-    if (g > max_g || g <= 0) {
+    int level = tree_level_of(tree, g);
+    if (level < 0) {
         return empty_result;
     }
     
-    int max_k = tree->children[g - 1]->children.size();
+    int max_k = tree->children[level]->children.size();
     if (k > max_k || k <= 0) {
         return empty_result;
     }
     
     std::unordered_set<int> core;
-    auto header = tree->children[g - 1]->children[k - 1];
+    auto header = tree->children[level]->children[k - 1];
     
     while (header) {
         for (int node : header->value) {
@@ -34,20 +49,18 @@ std::unordered_set<int> querying_for_one_level(const std::shared_ptr<TreeNode>&
 std::unordered_set<int> querying_for_two_level(const std::shared_ptr<TreeNode>& tree, int k, int g) {
     std::unordered_set<int> empty_result;
     
-    if (!tree || tree->children.empty()) return empty_result;
-    
-    int max_g = tree->children.size();
-    if (g > max_g || g <= 0) {
+    int level = tree_level_of(tree, g);
+    if (level < 0) {
         return empty_result;
     }
     
-    int max_k = tree->children[g - 1]->children.size();
+    int max_k = tree->children[level]->children.size();
     if (k > max_k || k <= 0) {
         return empty_result;
     }
     
     std::vector<std::shared_ptr<TreeNode>> starters;
-    auto header = tree->children[g - 1]->children[k - 1];
+    auto header = tree->children[level]->children[k - 1];
     
     // jump 포인터를 따라가며 시작점들 수집
     while (header) {
@@ -68,24 +81,29 @@ std::unordered_set<int> querying_for_two_level(const std::shared_ptr<TreeNode>&
     return core;
 }
 
+// node의 aux[1..max_i]를 core에 추가 (i마다 찾지 않고 실제로 있는 aux만 훑음: 체인 길이에 대해 선형)
+static void insert_tree_aux_upto(const TreeNode& node, int max_i, std::unordered_set<int>& core) {
+    for (const auto& [i, nodes] : node.aux) {
+        if (i >= 1 && i <= max_i) core.insert(nodes.begin(), nodes.end());
+    }
+}
+
 // Diagonal 인덱스 쿼리
 std::unordered_set<int> querying_for_diagonal(const std::shared_ptr<TreeNode>& tree, int k, int g) {
     std::unordered_set<int> empty_result;
     
-    if (!tree || tree->children.empty()) return empty_result;
-    
-    int max_g = tree->children.size();
-    if (g > max_g || g <= 0) {
+    int level = tree_level_of(tree, g);
+    if (level < 0) {
         return empty_result;
     }
     
-    int max_k = tree->children[g - 1]->children.size();
+    int max_k = tree->children[level]->children.size();
     if (k > max_k || k <= 0) {
         return empty_result;
     }
     
     std::vector<std::shared_ptr<TreeNode>> starters;
-    auto header = tree->children[g - 1]->children[k - 1];
+    auto header = tree->children[level]->children[k - 1];
     
     // jump 포인터를 따라가며 시작점들 수집
     while (header) {
@@ -103,16 +121,7 @@ std::unordered_set<int> querying_for_diagonal(const std::shared_ptr<TreeNode>& t
         }
         
         // s != 0인 경우 aux[1]부터 aux[s]까지 추가
-        if (s != 0) {
-            for (int i = 1; i <= s; i++) {
-                auto aux_it = head->aux.find(i);
-                if (aux_it != head->aux.end()) {
-                    for (int node : aux_it->second) {
-                        core.insert(node);
-                    }
-                }
-            }
-        }
+        insert_tree_aux_upto(*head, s, core);
         
         head = head->next;
         int cnt = 1;
@@ -122,14 +131,7 @@ std::unordered_set<int> querying_for_diagonal(const std::shared_ptr<TreeNode>& t
                 core.insert(node);
             }
             
-            for (int i = 1; i <= cnt; i++) {
-                auto aux_it = head->aux.find(i);
-                if (aux_it != head->aux.end()) {
-                    for (int node : aux_it->second) {
-                        core.insert(node);
-                    }
-                }
-            }
+            insert_tree_aux_upto(*head, cnt, core);
             
             head = head->next;
             cnt++;
@@ -139,6 +141,1178 @@ std::unordered_set<int> querying_for_diagonal(const std::shared_ptr<TreeNode>& t
     return core;
 }
 
+// ============================================================================
+// 쿼리 결과 (조각 목록)
+// ============================================================================
+
+QueryConfig g_query_config;
+
+void CoreResult::add_set(const uint8_t* encoded) {
+    size_t count = encoded_set_size(encoded);
+    if (count == 0) return;
+    pieces.push_back(Piece{encoded, NodeSpan()});
+    total += count;
+    distinct = kUnknown;
+}
+
+void CoreResult::add_span(NodeSpan span) {
+    if (span.empty()) return;
+    pieces.push_back(Piece{nullptr, span});
+    total += span.size();
+    distinct = kUnknown;
+}
+
+// 조각 내용을 그대로 (겹치는 원소도 여러 번)
+bool CoreResult::for_each_piece_block(const std::function<bool(const int*, size_t)>& block) const {
+    for (const Piece& piece : pieces) {
+        bool going = piece.encoded ? decode_sorted_set_blocks(piece.encoded, block) : block(piece.span.begin(), piece.span.size());
+        if (!going) return false;
+    }
+    return true;
+}
+
+bool CoreResult::for_each_block(const std::function<bool(const int*, size_t)>& block) const {
+    if (!overlapping || pieces.size() <= 1) {
+        return for_each_piece_block(block);
+    }
+    
+    // 처음 보는 원소만 버퍼에 모아 넘김 (비트맵은 필요한 만큼만 늘림)
+    constexpr size_t kBlock = 256;
+    std::vector<uint64_t> seen;
+    int buffer[kBlock];
+    size_t filled = 0;
+    bool going = for_each_piece_block([&](const int* first, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            size_t word = first[i] >> 6;
+            if (word >= seen.size()) seen.resize(std::max(word + 1, seen.size() * 2), 0);
+            uint64_t bit = 1ULL << (first[i] & 63);
+            if (seen[word] & bit) continue;
+            seen[word] |= bit;
+            buffer[filled++] = first[i];
+            if (filled == kBlock) {
+                filled = 0;
+                if (!block(buffer, kBlock)) return false;
+            }
+        }
+        return true;
+    });
+    if (going && filled > 0) going = block(buffer, filled);
+    return going;
+}
+
+// 저장된 core 크기(조각 헤더의 원소 수)로 판단하므로 작은 쿼리는 스레드를 건드리지 않음
+bool CoreResult::decode_in_parallel() const {
+    return g_query_config.parallel_decode_nodes > 0 && total >= g_query_config.parallel_decode_nodes &&
+           pieces.size() > 1 && task_runtime().num_workers() > 1;
+}
+
+// 조각마다 출력 위치가 원소 수 누적합으로 정해지므로 워커끼리 동기화 없이 제자리에 풂
+void CoreResult::decode_pieces_parallel(int* out) const {
+    std::vector<size_t> offsets(pieces.size() + 1, 0);
+    for (size_t p = 0; p < pieces.size(); p++) {
+        const Piece& piece = pieces[p];
+        offsets[p + 1] = offsets[p] + (piece.encoded ? encoded_set_size(piece.encoded) : piece.span.size());
+    }
+    
+    task_runtime().parallel_for(0, pieces.size(), [&](int begin, int end) {
+        for (int p = begin; p < end; p++) {
+            const Piece& piece = pieces[p];
+            if (piece.encoded) decode_sorted_set(piece.encoded, out + offsets[p]);
+            else std::copy(piece.span.begin(), piece.span.end(), out + offsets[p]);
+        }
+    }, 1);
+}
+
+// 겹치는 결과: 조각들을 나란히 푼 뒤 원자적 OR로 비트맵에 모음
+std::vector<uint64_t> CoreResult::distinct_bitmap_parallel() const {
+    std::vector<int> scratch(total);
+    decode_pieces_parallel(scratch.data());
+    
+    // 조각마다 정렬돼 있으므로 최대 노드는 조각 끝 원소들 중 최댓값
+    int max_node = 0;
+    size_t end = 0;
+    for (const Piece& piece : pieces) {
+        end += piece.encoded ? encoded_set_size(piece.encoded) : piece.span.size();
+        max_node = std::max(max_node, scratch[end - 1]);
+    }
+    
+    constexpr int kGrain = 1 << 14;
+    std::vector<uint64_t> bitmap(max_node / 64 + 1, 0);
+    task_runtime().parallel_for(0, scratch.size(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            __atomic_fetch_or(&bitmap[scratch[i] >> 6], 1ULL << (scratch[i] & 63), __ATOMIC_RELAXED);
+        }
+    }, kGrain);
+    return bitmap;
+}
+
+constexpr int kWordsPerChunk = 1 << 10;
+
+// 비트맵 워드 구간별 켜진 비트 수의 누적합 (counts.back()이 전체 수)
+static std::vector<size_t> count_bitmap_chunks(const std::vector<uint64_t>& bitmap) {
+    int chunks = (bitmap.size() + kWordsPerChunk - 1) / kWordsPerChunk;
+    std::vector<size_t> counts(chunks + 1, 0);
+    task_runtime().parallel_for(0, chunks, [&](int begin, int end) {
+        for (int c = begin; c < end; c++) {
+            size_t last = std::min(bitmap.size(), (size_t)(c + 1) * kWordsPerChunk);
+            for (size_t w = (size_t)c * kWordsPerChunk; w < last; w++) counts[c + 1] += __builtin_popcountll(bitmap[w]);
+        }
+    }, 1);
+    for (int c = 0; c < chunks; c++) counts[c + 1] += counts[c];
+    return counts;
+}
+
+// 구간마다 누적합 위치부터 오름차순으로 꺼냄
+static void extract_bitmap_chunks(const std::vector<uint64_t>& bitmap, const std::vector<size_t>& counts, int* out) {
+    task_runtime().parallel_for(0, counts.size() - 1, [&](int begin, int end) {
+        for (int c = begin; c < end; c++) {
+            int* next = out + counts[c];
+            size_t last = std::min(bitmap.size(), (size_t)(c + 1) * kWordsPerChunk);
+            for (size_t w = (size_t)c * kWordsPerChunk; w < last; w++) {
+                for (uint64_t word = bitmap[w]; word; word &= word - 1) {
+                    *next++ = (int)(w * 64 + __builtin_ctzll(word));
+                }
+            }
+        }
+    }, 1);
+}
+
+size_t CoreResult::size() const {
+    if (!overlapping || pieces.size() <= 1) return total;
+    if (distinct == kUnknown) {
+        if (decode_in_parallel()) {
+            distinct = count_bitmap_chunks(distinct_bitmap_parallel()).back();
+            return distinct;
+        }
+        size_t count = 0;
+        for_each_block([&](const int*, size_t n) {
+            count += n;
+            return true;
+        });
+        distinct = count;
+    }
+    return distinct;
+}
+
+// int와 uint32_t는 서로의 부호 있는/없는 짝이라 같은 메모리를 int*로 채워도 됨 (노드 ID는 음수가 아님)
+template <typename Id>
+std::vector<Id> CoreResult::collect(bool sorted) const {
+    static_assert(sizeof(Id) == sizeof(int), "node IDs are decoded as int");
+    std::vector<Id> nodes;
+    if (overlapping && pieces.size() > 1) {
+        if (decode_in_parallel()) {
+            // 비트맵에서 꺼내면 이미 정렬돼 있음
+            std::vector<uint64_t> bitmap = distinct_bitmap_parallel();
+            std::vector<size_t> counts = count_bitmap_chunks(bitmap);
+            nodes.resize(counts.back());
+            extract_bitmap_chunks(bitmap, counts, reinterpret_cast<int*>(nodes.data()));
+            return nodes;
+        }
+        nodes.reserve(total);
+        for_each_block([&](const int* first, size_t count) {
+            nodes.insert(nodes.end(), first, first + count);
+            return true;
+        });
+    } else {
+        // 크기를 이미 알므로 한 번만 할당하고 조각마다 제자리에 풂
+        nodes.resize(total);
+        int* out = reinterpret_cast<int*>(nodes.data());
+        if (decode_in_parallel()) {
+            decode_pieces_parallel(out);
+        } else {
+            for (const Piece& piece : pieces) {
+                out = piece.encoded ? decode_sorted_set(piece.encoded, out) : std::copy(piece.span.begin(), piece.span.end(), out);
+            }
+        }
+    }
+    if (sorted && pieces.size() > 1) {
+        std::sort(nodes.begin(), nodes.end());
+    }
+    return nodes;
+}
+
+std::vector<int> CoreResult::to_vector(bool sorted) const {
+    return collect<int>(sorted);
+}
+
+std::vector<uint32_t> CoreResult::to_sorted_ids() const {
+    return collect<uint32_t>(true);
+}
+
+std::vector<uint64_t> CoreResult::to_bitmap(size_t universe) const {
+    // 비트를 켜는 것이므로 겹치는 조각도 거를 필요 없음 (큰 결과는 조각별로 나눠 원자적 OR)
+    if (universe > 0 && decode_in_parallel()) {
+        std::vector<uint64_t> bitmap((universe + 63) / 64, 0);
+        task_runtime().parallel_for(0, pieces.size(), [&](int begin, int end) {
+            for (int p = begin; p < end; p++) {
+                auto mark = [&](const int* first, size_t count) {
+                    for (size_t i = 0; i < count; i++) {
+                        __atomic_fetch_or(&bitmap[first[i] >> 6], 1ULL << (first[i] & 63), __ATOMIC_RELAXED);
+                    }
+                    return true;
+                };
+                if (pieces[p].encoded) decode_sorted_set_blocks(pieces[p].encoded, mark);
+                else mark(pieces[p].span.begin(), pieces[p].span.size());
+            }
+        }, 1);
+        return bitmap;
+    }
+    if (universe == 0 && overlapping && decode_in_parallel()) {
+        return distinct_bitmap_parallel();
+    }
+    
+    // universe를 모르면 조각 끝 원소를 볼 때마다 필요한 만큼 늘림
+    std::vector<uint64_t> bitmap((universe + 63) / 64, 0);
+    for_each_piece_block([&](const int* first, size_t count) {
+        if (count > 0 && (size_t)(first[count - 1] >> 6) >= bitmap.size()) bitmap.resize((first[count - 1] >> 6) + 1, 0);
+        for (size_t i = 0; i < count; i++) bitmap[first[i] >> 6] |= 1ULL << (first[i] & 63);
+        return true;
+    });
+    return bitmap;
+}
+
+std::vector<uint8_t> CoreResult::to_roaring() const {
+    std::vector<int> nodes = collect<int>(true);
+    std::vector<uint8_t> encoded;
+    encode_sorted_set(nodes.data(), nodes.data() + nodes.size(), SetCodec::Roaring, encoded);
+    return encoded;
+}
+
+std::unordered_set<int> CoreResult::to_set() const {
+    std::unordered_set<int> nodes;
+    nodes.reserve(total);
+    for_each_piece_block([&](const int* first, size_t count) {
+        nodes.insert(first, first + count);
+        return true;
+    });
+    return nodes;
+}
+
+QueryOutput CoreResult::to_output(ResultFormat format, size_t universe) const {
+    QueryOutput output;
+    output.format = format;
+    switch (format) {
+        case ResultFormat::Sorted:
+            output.sorted = to_sorted_ids();
+            output.count = output.sorted.size();
+            break;
+        case ResultFormat::Bitmap:
+            output.bitmap = to_bitmap(universe);
+            if (overlapping && pieces.size() > 1 && distinct == kUnknown) {
+                size_t count = 0;
+                for (uint64_t word : output.bitmap) count += __builtin_popcountll(word);
+                distinct = count;
+            }
+            output.count = size();
+            break;
+        case ResultFormat::Roaring:
+            output.roaring = to_roaring();
+            output.count = encoded_set_size(output.roaring.data());
+            break;
+    }
+    return output;
+}
+
+bool QueryOutput::contains(int node) const {
+    if (node < 0) return false;
+    switch (format) {
+        case ResultFormat::Sorted:
+            return std::binary_search(sorted.begin(), sorted.end(), (uint32_t)node);
+        case ResultFormat::Bitmap:
+            return (size_t)(node >> 6) < bitmap.size() && (bitmap[node >> 6] >> (node & 63) & 1);
+        case ResultFormat::Roaring: {
+            // 블록은 오름차순이므로 node 이상이 나오면 멈춤
+            bool found = false;
+            if (roaring.empty()) return false;
+            decode_sorted_set_blocks(roaring.data(), [&](const int* first, size_t count) {
+                if (count == 0 || first[count - 1] < node) return true;
+                found = std::binary_search(first, first + count, node);
+                return false;
+            });
+            return found;
+        }
+    }
+    return false;
+}
+
+const char* result_format_name(ResultFormat format) {
+    switch (format) {
+        case ResultFormat::Sorted: return "sorted";
+        case ResultFormat::Bitmap: return "bitmap";
+        case ResultFormat::Roaring: return "roaring";
+    }
+    return "?";
+}
+
+bool parse_result_format(const std::string& name, ResultFormat& format) {
+    for (ResultFormat f : {ResultFormat::Sorted, ResultFormat::Bitmap, ResultFormat::Roaring}) {
+        if (name == result_format_name(f)) {
+            format = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// 평평한 레이아웃 쿼리 (포인터 트리 버전과 같은 순서로 같은 집합을 가리킴)
+// 뷰만 읽으므로 힙 인덱스와 mmap한 인덱스 파일에서 똑같이 동작
+// ============================================================================
+
+static void add_flat_set(const FlatIndexView& index, uint32_t set, CoreResult& core) {
+    if (set != FlatIndex::kNull) core.add_set(index.sets.data() + set);
+}
+
+// 쿼리마다 가리키는 집합들을 순서대로 visit(set)으로 넘김 (결과 조립과 배치 쿼리가 같은 순회를 씀)
+template <typename Visit>
+static void walk_one_level(const FlatIndexView& index, int k, int g, Visit&& visit) {
+    uint32_t header = index.node_at(k, g);
+    while (header != FlatIndex::kNull) {
+        const auto& node = index.nodes[header];
+        visit(node.value);
+        header = node.next;
+    }
+}
+
+// jump 포인터를 따라가며 시작점마다 next 체인을 모음 (g마다 같은 노드가 다시 나올 수 있음)
+template <typename Visit>
+static void walk_two_level(const FlatIndexView& index, int k, int g, Visit&& visit) {
+    uint32_t starter = index.node_at(k, g);
+    while (starter != FlatIndex::kNull) {
+        uint32_t s = starter;
+        while (s != FlatIndex::kNull) {
+            const auto& node = index.nodes[s];
+            visit(node.value);
+            s = node.next;
+        }
+        starter = index.nodes[starter].jump;
+    }
+}
+
+// node의 aux[1..max_i] (조밀 배열이라 앞쪽 min(max_i, 상한)개를 그대로 읽음)
+// 집합 번호: 노드 value는 노드 번호, aux는 노드 수 + aux 번호 (뷰 크기 안에서 조밀)
+template <typename Visit>
+static void walk_aux_upto(const FlatIndexView& index, const FlatIndex::Node& node, int max_i, Visit&& visit) {
+    uint32_t end = node.aux_begin + std::min<uint32_t>(std::max(max_i, 0), node.aux_end - node.aux_begin);
+    for (uint32_t a = node.aux_begin; a < end; a++) {
+        visit(index.aux_entries[a].set, (uint32_t)index.nodes.size() + a);
+    }
+}
+
+// visit(set, 집합 번호)
+template <typename Visit>
+static void walk_diagonal(const FlatIndexView& index, int k, int g, Visit&& visit) {
+    uint32_t starter = index.node_at(k, g);
+    for (int s = 0; starter != FlatIndex::kNull; s++) {
+        const auto& head = index.nodes[starter];
+        visit(head.value, starter);
+        
+        // s번째 시작점은 aux[1..s]까지 포함
+        walk_aux_upto(index, head, s, visit);
+        
+        uint32_t n = head.next;
+        for (int cnt = 1; n != FlatIndex::kNull; cnt++) {
+            const auto& node = index.nodes[n];
+            visit(node.value, n);
+            walk_aux_upto(index, node, cnt, visit);
+            n = node.next;
+        }
+        
+        starter = head.jump;
+    }
+}
+
+CoreResult querying_for_one_level(const FlatIndexView& index, int k, int g) {
+    CoreResult core;
+    walk_one_level(index, k, g, [&](uint32_t set) { add_flat_set(index, set, core); });
+    return core;
+}
+
+CoreResult querying_for_two_level(const FlatIndexView& index, int k, int g) {
+    CoreResult core;
+    walk_two_level(index, k, g, [&](uint32_t set) { add_flat_set(index, set, core); });
+    core.set_overlapping();
+    return core;
+}
+
+CoreResult querying_for_diagonal(const FlatIndexView& index, int k, int g) {
+    CoreResult core;
+    walk_diagonal(index, k, g, [&](uint32_t set, uint32_t) { add_flat_set(index, set, core); });
+    core.set_overlapping();
+    return core;
+}
+
+QueryOutput querying_for_one_level(const FlatIndexView& index, int k, int g, ResultFormat format, size_t universe) {
+    return querying_for_one_level(index, k, g).to_output(format, universe);
+}
+
+QueryOutput querying_for_two_level(const FlatIndexView& index, int k, int g, ResultFormat format, size_t universe) {
+    return querying_for_two_level(index, k, g).to_output(format, universe);
+}
+
+QueryOutput querying_for_diagonal(const FlatIndexView& index, int k, int g, ResultFormat format, size_t universe) {
+    return querying_for_diagonal(index, k, g).to_output(format, universe);
+}
+
+// candidates에서 upper에 든 노드를 뺀 정렬된 배열 하나 (겹치는 candidates는 한 번씩만)
+static std::shared_ptr<std::vector<int>> subtract_nodes(const CoreResult& candidates, const CoreResult& upper) {
+    std::vector<uint64_t> removed = upper.to_bitmap();
+    auto shell = std::make_shared<std::vector<int>>();
+    candidates.for_each_block([&](const int* first, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            size_t word = first[i] >> 6;
+            if (word < removed.size() && (removed[word] >> (first[i] & 63) & 1)) continue;
+            shell->push_back(first[i]);
+        }
+        return true;
+    });
+    std::sort(shell->begin(), shell->end());
+    return shell;
+}
+
+static CoreResult subtract_core(const CoreResult& candidates, const CoreResult& upper) {
+    auto nodes = subtract_nodes(candidates, upper);
+    CoreResult result(NodeSpan{nodes->data(), nodes->size()});
+    result.keep_alive(nodes);
+    return result;
+}
+
+CoreResult querying_shell_for_one_level(const FlatIndexView& index, int k, int g) {
+    CoreResult shell;
+    uint32_t n = index.node_at(k, g);
+    if (n != FlatIndex::kNull) add_flat_set(index, index.nodes[n].value, shell);
+    return shell;
+}
+
+// 값(k,g') = shell_g'(k) \ shell_g'+1(k)들은 서로 겹치지 않고 (k,g)-shell을 덮음
+// g'에서 core 번호가 k여도 g에서는 더 클 수 있으므로 (k+1,g)-core에 든 노드만 뺌
+CoreResult querying_shell_for_two_level(const FlatIndexView& index, int k, int g) {
+    CoreResult heads;
+    for (uint32_t starter = index.node_at(k, g); starter != FlatIndex::kNull; starter = index.nodes[starter].jump) {
+        add_flat_set(index, index.nodes[starter].value, heads);
+    }
+    if (heads.empty()) return heads;
+    return subtract_core(heads, querying_for_two_level(index, k + 1, g));
+}
+
+CoreResult querying_shell_for_diagonal(const FlatIndexView& index, int k, int g) {
+    CoreResult core = querying_for_diagonal(index, k, g);
+    if (core.empty()) return core;
+    return subtract_core(core, querying_for_diagonal(index, k + 1, g));
+}
+
+// 여러 (k,g) 쿼리를 태스크 런타임 워커들에 나눠 실행 (results[i]는 queries[i]의 결과)
+std::vector<CoreResult> run_query_batch(const std::vector<std::pair<int, int>>& queries,
+                                        const QueryFunction& query) {
+    std::vector<CoreResult> results(queries.size());
+    
+    // 쿼리마다 비용 차이가 크므로 한 개씩 쪼갤 수 있게 grain 1
+    task_runtime().parallel_for(0, queries.size(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            results[i] = query(queries[i].first, queries[i].second);
+        }
+    }, 1);
+    
+    return results;
+}
+
+std::vector<QueryOutput> run_query_batch(const std::vector<std::pair<int, int>>& queries,
+                                         const QueryFunction& query, ResultFormat format, size_t universe) {
+    std::vector<QueryOutput> results(queries.size());
+    task_runtime().parallel_for(0, queries.size(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            results[i] = query(queries[i].first, queries[i].second).to_output(format, universe);
+        }
+    }, 1);
+    return results;
+}
+
+// ============================================================================
+// 탐색을 공유하는 배치 쿼리
+// ============================================================================
+//
+// 쿼리들을 g로 묶고 k로 정렬해서 같은 체인은 배치 전체에서 한 번만 풂
+//   one-level/jump: 저장된 레벨마다 그 레벨에 닿는 쿼리들 중 가장 작은 k부터 next 체인을 한 번 따라감
+//                   (k,g)-core는 g에서 jump로 닿는 레벨들의 k 이상인 조각들이므로, g 묶음마다 조각을 k 내림차순으로 두면
+//                   각 결과는 앞쪽 구간 = 바로 큰 k 결과에 k 칸을 더한 것
+//                   jump는 한 노드가 여러 레벨에 다시 나오므로 묶음마다 처음 본 (가장 큰 k의) 자리에만 남겨 칸끼리 겹치지 않게 함
+//   diagonal      : aux 구간이 시작 위치에 따라 달라 쿼리마다 따라가되 같은 집합은 배치 전체에서 한 번만 풂
+// 두 쿼리 이상이 읽는 집합만 공유 버퍼에 풀고 (버퍼는 결과들이 keep_alive로 붙잡음), 한 번만 읽히는 집합은 인코딩된 채 결과에 넣음
+
+namespace {
+
+// g가 같은 쿼리 번호들 (k 오름차순): 묶음들이 정렬된 번호 배열 하나를 나눠 씀
+struct QueryGroup {
+    const size_t* first;
+    const size_t* last;
+    
+    const size_t* begin() const { return first; }
+    const size_t* end() const { return last; }
+    size_t size() const { return last - first; }
+    size_t operator[](size_t i) const { return first[i]; }
+};
+
+struct QueryGroups {
+    std::vector<size_t> order;
+    std::vector<size_t> bounds;   // 묶음 i는 order[bounds[i]..bounds[i + 1])
+    
+    size_t size() const { return bounds.size() - 1; }
+    QueryGroup operator[](size_t i) const { return {order.data() + bounds[i], order.data() + bounds[i + 1]}; }
+};
+
+QueryGroups group_queries_by_g(const std::vector<std::pair<int, int>>& queries) {
+    QueryGroups groups;
+    groups.order.resize(queries.size());
+    std::iota(groups.order.begin(), groups.order.end(), 0);
+    std::sort(groups.order.begin(), groups.order.end(), [&](size_t a, size_t b) {
+        return queries[a].second != queries[b].second ? queries[a].second < queries[b].second
+                                                       : queries[a].first < queries[b].first;
+    });
+    
+    const std::vector<size_t>& order = groups.order;
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i == 0 || queries[order[i]].second != queries[order[i - 1]].second) groups.bounds.push_back(i);
+    }
+    groups.bounds.push_back(order.size());
+    return groups;
+}
+
+// 묶음에서 가장 작은 양수 k (k <= 0인 쿼리는 빈 결과, 없으면 0)
+int smallest_k(const std::vector<std::pair<int, int>>& queries, const QueryGroup& group) {
+    for (size_t q : group) {
+        if (queries[q].first >= 1) return queries[q].first;
+    }
+    return 0;
+}
+
+// 모아 둔 집합들을 버퍼 하나에 이어서 풂 (spans[i]가 sets[i], 큰 배치는 집합들을 워커에 나눔)
+std::shared_ptr<std::vector<int>> decode_shared(const FlatIndexView& index, const std::vector<uint32_t>& sets,
+                                               std::vector<NodeSpan>& spans) {
+    std::vector<size_t> offsets(sets.size() + 1, 0);
+    for (size_t i = 0; i < sets.size(); i++) offsets[i + 1] = offsets[i] + index.set_size(sets[i]);
+    
+    auto arena = std::make_shared<std::vector<int>>(offsets.back());
+    spans.resize(sets.size());
+    constexpr int kGrain = 64;
+    task_runtime().parallel_for(0, sets.size(), [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            int* out = arena->data() + offsets[i];
+            decode_sorted_set(index.sets.data() + sets[i], out);
+            spans[i] = NodeSpan{out, offsets[i + 1] - offsets[i]};
+        }
+    }, kGrain);
+    return arena;
+}
+
+// 배치 안에서 집합마다 몇 번 쓰였는지와 풀어 둔 칸 (집합 번호로 바로 찾는 조밀 배열)
+// epoch 도장이라 배치마다 배열을 지우지 않음
+class SetUseScratch {
+public:
+    void begin(size_t num_sets) {
+        if (uses.size() < num_sets) {
+            uses.resize(num_sets, 0);
+            slots.resize(num_sets, 0);
+            stamps.resize(num_sets, 0);
+        }
+        if (++epoch == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+    }
+    
+    // 이 배치에서 처음 보면 true
+    bool add(uint32_t id) {
+        if (stamps[id] != epoch) {
+            stamps[id] = epoch;
+            uses[id] = 1;
+            return true;
+        }
+        uses[id]++;
+        return false;
+    }
+    
+    uint32_t use_count(uint32_t id) const { return uses[id]; }
+    uint32_t& slot(uint32_t id) { return slots[id]; }
+    
+private:
+    std::vector<uint32_t> uses;
+    std::vector<uint32_t> slots;
+    std::vector<uint32_t> stamps;
+    uint32_t epoch = 0;
+};
+
+SetUseScratch& set_use_scratch() {
+    static thread_local SetUseScratch scratch;
+    return scratch;
+}
+
+// 풀어 둔 칸이 있으면 그 구간, 없으면 인코딩된 집합 그대로 (쿼리마다 따라갈 때와 같음)
+void add_slot(const FlatIndexView& index, uint32_t set, uint32_t slot, const std::vector<NodeSpan>& spans, CoreResult& core) {
+    if (slot != FlatIndex::kNull) core.add_span(spans[slot]);
+    else add_flat_set(index, set, core);
+}
+
+// 풀어 둔 레벨 next 체인 위의 조각 (레벨마다 k 오름차순, slot은 배치 버퍼의 칸)
+struct LevelShell {
+    int k;
+    uint32_t slot;
+};
+
+std::vector<CoreResult> run_chain_batch(const FlatIndexView& index, bool jump, const std::vector<std::pair<int, int>>& queries) {
+    std::vector<CoreResult> results(queries.size());
+    QueryGroups groups = group_queries_by_g(queries);
+    
+    // 묶음마다 닿는 저장된 레벨들 (레벨, 그 레벨에서 시작하는 k)과 레벨마다 그 레벨을 읽는 쿼리 수
+    // 묶음 i가 닿는 레벨은 reached[reached_begin[i]..reached_begin[i + 1])
+    int levels = index.num_stored_levels();
+    std::vector<std::pair<int, int>> reached;
+    std::vector<size_t> reached_begin(groups.size() + 1, 0);
+    std::vector<int> valid(groups.size(), 0);
+    std::vector<int> uses(levels, 0);
+    std::vector<int> need(levels, INT_MAX);
+    for (size_t i = 0; i < groups.size(); i++) {
+        for (size_t q : groups[i]) valid[i] += queries[q].first >= 1;
+        int k_min = smallest_k(queries, groups[i]);
+        for (uint32_t starter = k_min > 0 ? index.node_at(k_min, queries[groups[i][0]].second) : FlatIndex::kNull;
+             starter != FlatIndex::kNull; starter = jump ? index.nodes[starter].jump : FlatIndex::kNull) {
+            int l = std::upper_bound(index.level_begin.begin(), index.level_begin.end(), starter) - index.level_begin.begin() - 1;
+            int k = (int)(starter - index.level_begin[l]) + 1;
+            reached.emplace_back(l, k);
+            uses[l] += valid[i];
+            need[l] = std::min(need[l], k);
+        }
+        reached_begin[i + 1] = reached.size();
+    }
+    
+    // 두 쿼리 이상이 읽는 레벨마다 한 번: 닿는 쿼리들 중 가장 작은 k부터 체인을 버퍼 하나에 풂 (체인 위 노드의 레벨 안 위치가 k)
+    // g가 달라도 같은 레벨에 닿으면 같은 구간을 나눠 씀, 한 쿼리만 읽는 레벨은 나눌 것이 없으므로 그 쿼리가 제자리에서 읽음
+    // 레벨 l의 조각은 shells[shell_begin[l]..shell_begin[l + 1])
+    std::vector<LevelShell> shells;
+    std::vector<size_t> shell_begin(levels + 1, 0);
+    std::vector<uint32_t> sets;
+    for (int l = 0; l < levels; l++) {
+        shell_begin[l] = shells.size();
+        if (uses[l] < 2) continue;
+        for (uint32_t n = index.level_begin[l] + need[l] - 1; n != FlatIndex::kNull; n = index.nodes[n].next) {
+            if (index.nodes[n].value == FlatIndex::kNull) continue;
+            shells.push_back({(int)(n - index.level_begin[l]) + 1, (uint32_t)sets.size()});
+            sets.push_back(index.nodes[n].value);
+        }
+    }
+    shell_begin[levels] = shells.size();
+    std::vector<NodeSpan> spans;
+    auto arena = decode_shared(index, sets, spans);
+    
+    int max_node = 0;
+    for (const NodeSpan& span : spans) {
+        if (!span.empty()) max_node = std::max(max_node, span.begin()[span.size() - 1]);
+    }
+    
+    task_runtime().parallel_for(0, groups.size(), [&](int begin, int end) {
+        std::vector<uint64_t> seen;
+        for (int i = begin; i < end; i++) {
+            QueryGroup group = groups[i];
+            size_t reached_end = reached_begin[i + 1];
+            
+            // 쿼리가 하나면 나눌 앞쪽 구간이 없으므로 닿는 레벨들의 k 이상 조각을 그대로 (jump는 레벨끼리 겹침)
+            if (valid[i] <= 1) {
+                for (size_t q : group) {
+                    int k = queries[q].first;
+                    if (k < 1) continue;
+                    CoreResult core;
+                    for (size_t r = reached_begin[i]; r < reached_end; r++) {
+                        auto [l, start] = reached[r];
+                        if (uses[l] < 2) {
+                            for (uint32_t n = index.level_begin[l] + start - 1; n != FlatIndex::kNull; n = index.nodes[n].next) {
+                                if ((int)(n - index.level_begin[l]) + 1 >= k) add_flat_set(index, index.nodes[n].value, core);
+                            }
+                            continue;
+                        }
+                        for (size_t s = shell_begin[l]; s < shell_begin[l + 1]; s++) {
+                            if (shells[s].k >= k) core.add_span(spans[shells[s].slot]);
+                        }
+                    }
+                    if (reached_end - reached_begin[i] > 1) core.set_overlapping();
+                    if (!sets.empty()) core.keep_alive(arena);
+                    results[q] = std::move(core);
+                }
+                continue;
+            }
+            int k_min = smallest_k(queries, group);
+            
+            // 닿는 레벨들의 k_min 이상 조각을 k 내림차순으로 (같은 k는 레벨 순서대로, 두 쿼리 이상이 읽으므로 모두 풀려 있음)
+            std::vector<std::pair<int, NodeSpan>> pieces;
+            for (size_t r = reached_begin[i]; r < reached_end; r++) {
+                int l = reached[r].first;
+                for (size_t s = shell_begin[l]; s < shell_begin[l + 1]; s++) {
+                    if (shells[s].k >= k_min) pieces.emplace_back(shells[s].k, spans[shells[s].slot]);
+                }
+            }
+            std::stable_sort(pieces.begin(), pieces.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+            
+            std::shared_ptr<const void> owner = arena;
+            if (jump && !pieces.empty()) {
+                // 조각 안 순서를 지키며 처음 보는 노드만 남기므로 걸러진 조각도 정렬돼 있음
+                size_t stored = 0;
+                for (const auto& piece : pieces) stored += piece.second.size();
+                auto filtered = std::make_shared<std::vector<int>>(stored);
+                seen.assign(max_node / 64 + 1, 0);
+                int* out = filtered->data();
+                for (auto& piece : pieces) {
+                    int* first = out;
+                    for (int v : piece.second) {
+                        uint64_t bit = 1ULL << (v & 63);
+                        if (seen[v >> 6] & bit) continue;
+                        seen[v >> 6] |= bit;
+                        *out++ = v;
+                    }
+                    piece.second = NodeSpan{first, (size_t)(out - first)};
+                }
+                owner = filtered;
+            }
+            
+            // 큰 k부터: 앞쪽 구간이 k 이상인 조각들
+            size_t used = 0;
+            for (size_t j = group.size(); j-- > 0;) {
+                size_t q = group[j];
+                int k = queries[q].first;
+                while (used < pieces.size() && pieces[used].first >= k) used++;
+                CoreResult core;
+                if (k >= 1) {
+                    for (size_t p = 0; p < used; p++) core.add_span(pieces[p].second);
+                }
+                core.keep_alive(owner);
+                results[q] = std::move(core);
+            }
+        }
+    }, 1);
+    return results;
+}
+
+std::vector<CoreResult> run_diagonal_batch(const FlatIndexView& index, const std::vector<std::pair<int, int>>& queries) {
+    // 쿼리마다 닿는 집합 번호를 모으고 두 번 이상 쓰인 집합만 한 번 풂
+    SetUseScratch& scratch = set_use_scratch();
+    scratch.begin(index.nodes.size() + index.aux_entries.size());
+    auto set_of = [&](uint32_t id) {
+        return id < index.nodes.size() ? index.nodes[id].value : index.aux_entries[id - index.nodes.size()].set;
+    };
+    
+    // 쿼리 q가 닿는 집합 번호는 refs[ref_range[q].first..ref_range[q].second)
+    std::vector<uint32_t> distinct;
+    std::vector<uint32_t> refs;
+    std::vector<std::pair<size_t, size_t>> ref_range(queries.size());
+    for (size_t q : group_queries_by_g(queries).order) {
+        ref_range[q].first = refs.size();
+        walk_diagonal(index, queries[q].first, queries[q].second, [&](uint32_t set, uint32_t id) {
+            if (set == FlatIndex::kNull) return;
+            if (scratch.add(id)) distinct.push_back(id);
+            refs.push_back(id);
+        });
+        ref_range[q].second = refs.size();
+    }
+    
+    std::vector<uint32_t> sets;
+    for (uint32_t id : distinct) {
+        scratch.slot(id) = scratch.use_count(id) > 1 ? (uint32_t)sets.size() : FlatIndex::kNull;
+        if (scratch.use_count(id) > 1) sets.push_back(set_of(id));
+    }
+    
+    std::vector<NodeSpan> spans;
+    auto arena = decode_shared(index, sets, spans);
+    std::vector<CoreResult> results(queries.size());
+    for (size_t q = 0; q < queries.size(); q++) {
+        for (size_t r = ref_range[q].first; r < ref_range[q].second; r++) {
+            add_slot(index, set_of(refs[r]), scratch.slot(refs[r]), spans, results[q]);
+        }
+        results[q].set_overlapping();
+        if (!sets.empty()) results[q].keep_alive(arena);
+    }
+    return results;
+}
+
+}  // namespace
+
+std::vector<CoreResult> querying_batch_for_one_level(const FlatIndexView& index, const std::vector<std::pair<int, int>>& queries) {
+    return run_chain_batch(index, false, queries);
+}
+
+std::vector<CoreResult> querying_batch_for_two_level(const FlatIndexView& index, const std::vector<std::pair<int, int>>& queries) {
+    return run_chain_batch(index, true, queries);
+}
+
+std::vector<CoreResult> querying_batch_for_diagonal(const FlatIndexView& index, const std::vector<std::pair<int, int>>& queries) {
+    return run_diagonal_batch(index, queries);
+}
+
+// ============================================================================
+// 직사각형 sweep (차분 스트림)
+// ============================================================================
+
+// (k,g) -> (k,g+1)에서 빠지는 노드 (저장된 레벨이 같으면 없음): 저장된 차분만 따라감
+// jump 값(k',l) = shell_l(k') \ shell_l+1(k') (k' ≥ k)들이 (k,g)-core \ (k,g+1)-core를 덮음
+//   k' = k인 값은 통째로 빠짐
+//   k' > k인 값의 노드는 g+1에서 core 번호가 k'보다 작으므로 (k,g+1)..(k'-1,g+1) leaf에 없을 때만 빠짐
+//   → 가장 큰 k' 아래의 g+1 leaf들만 풀어서 거름 ((k,g+1)-core 전체는 만들지 않음)
+// (k,g)의 jump가 (k,g+1) 노드로 이어지지 않으면 (두 뷰의 레벨이 어긋남) 저장된 차분이 없으므로
+// 그때만 (k,g)-core에서 (k,g+1)-core 전체를 뺌
+static CoreResult removed_by_g_step(const FlatIndexView& one_level, const FlatIndexView& jump, int k, int g) {
+    CoreResult removed;
+    if (jump.level_of(g) == jump.level_of(g + 1)) return removed;
+    
+    uint32_t n = jump.node_at(k, g);
+    if (n == FlatIndex::kNull ? one_level.core_size(k, g) > 0 : jump.nodes[n].jump != jump.node_at(k, g + 1)) {
+        return subtract_core(querying_for_one_level(one_level, k, g), querying_for_one_level(one_level, k, g + 1));
+    }
+    if (n == FlatIndex::kNull) return removed;
+    add_flat_set(jump, jump.nodes[n].value, removed);
+    
+    CoreResult candidates;
+    uint32_t level_first = jump.level_begin[jump.level_of(g)];
+    int k_max = k;
+    for (n = jump.nodes[n].next; n != FlatIndex::kNull; n = jump.nodes[n].next) {
+        if (jump.nodes[n].value == FlatIndex::kNull) continue;
+        add_flat_set(jump, jump.nodes[n].value, candidates);
+        k_max = std::max(k_max, (int)(n - level_first) + 1);
+    }
+    if (!candidates.empty()) {
+        CoreResult kept;
+        for (int k_kept = k; k_kept < k_max; k_kept++) {
+            uint32_t leaf = one_level.node_at(k_kept, g + 1);
+            if (leaf == FlatIndex::kNull) break;
+            add_flat_set(one_level, one_level.nodes[leaf].value, kept);
+        }
+        auto rest = subtract_nodes(candidates, kept);
+        removed.add_span(NodeSpan{rest->data(), rest->size()});
+        removed.keep_alive(rest);
+    }
+    return removed;
+}
+
+bool sweep_core_deltas(const FlatIndexView& one_level, const FlatIndexView& jump, int k1, int k2, int g1, int g2,
+                       const DeltaSink& sink) {
+    k1 = std::max(k1, 1);
+    g1 = std::max(g1, 1);
+    if (k1 > k2 || g1 > g2) return true;
+    
+    CoreDelta step;
+    step.k = k1;
+    step.g = g1;
+    step.added = querying_for_one_level(one_level, k1, g1);
+    step.size = one_level.core_size(k1, g1);
+    if (!sink(step)) return false;
+    
+    for (int g = g1; g <= g2; g++) {
+        // 짝수 번째 행은 k가 커지는 쪽 (shell이 빠짐), 홀수 번째 행은 작아지는 쪽 (shell이 더해짐)
+        bool up = (g - g1) % 2 == 0;
+        if (g > g1) {
+            // 직전 행이 끝난 k에서 g만 하나 늘림
+            step = CoreDelta();
+            step.k = up ? k1 : k2;
+            step.g = g;
+            step.removed = removed_by_g_step(one_level, jump, step.k, g - 1);
+            step.size = one_level.core_size(step.k, g);
+            if (!sink(step)) return false;
+        }
+        for (int i = 1; i <= k2 - k1; i++) {
+            step = CoreDelta();
+            step.k = up ? k1 + i : k2 - i;
+            step.g = g;
+            if (up) step.removed = querying_shell_for_one_level(one_level, step.k - 1, g);
+            else step.added = querying_shell_for_one_level(one_level, step.k, g);
+            step.size = one_level.core_size(step.k, g);
+            if (!sink(step)) return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// core 식 (합/교/차)
+// ============================================================================
+
+CoreExpr CoreExpr::core(int k, int g) {
+    CoreExpr expr;
+    expr.k = k;
+    expr.g = g;
+    return expr;
+}
+
+static CoreExpr combine(CoreExpr::Op op, const CoreExpr& a, const CoreExpr& b) {
+    CoreExpr expr;
+    expr.op = op;
+    expr.left = std::make_shared<const CoreExpr>(a);
+    expr.right = std::make_shared<const CoreExpr>(b);
+    return expr;
+}
+
+CoreExpr operator|(const CoreExpr& a, const CoreExpr& b) { return combine(CoreExpr::Op::Union, a, b); }
+CoreExpr operator&(const CoreExpr& a, const CoreExpr& b) { return combine(CoreExpr::Op::Intersection, a, b); }
+CoreExpr operator-(const CoreExpr& a, const CoreExpr& b) { return combine(CoreExpr::Op::Difference, a, b); }
+
+namespace {
+
+class ExprParser {
+public:
+    explicit ExprParser(const std::string& text) : text(text) {}
+    
+    bool parse(CoreExpr& expr) {
+        if (!parse_union(expr)) return false;
+        skip_spaces();
+        return pos == text.size();
+    }
+    
+private:
+    // union := term (('|' | '-') term)*
+    bool parse_union(CoreExpr& expr) {
+        if (!parse_term(expr)) return false;
+        while (true) {
+            char op = peek();
+            if (op != '|' && op != '-') return true;
+            pos++;
+            CoreExpr right;
+            if (!parse_term(right)) return false;
+            expr = op == '|' ? expr | right : expr - right;
+        }
+    }
+    
+    // term := factor ('&' factor)*
+    bool parse_term(CoreExpr& expr) {
+        if (!parse_factor(expr)) return false;
+        while (peek() == '&') {
+            pos++;
+            CoreExpr right;
+            if (!parse_factor(right)) return false;
+            expr = expr & right;
+        }
+        return true;
+    }
+    
+    // factor := '(' k ',' g ')' | '(' union ')'
+    bool parse_factor(CoreExpr& expr) {
+        if (peek() != '(') return false;
+        pos++;
+        size_t start = pos;
+        int k, g;
+        if (parse_int(k) && peek() == ',' && (pos++, parse_int(g)) && peek() == ')') {
+            pos++;
+            expr = CoreExpr::core(k, g);
+            return true;
+        }
+        pos = start;
+        if (!parse_union(expr) || peek() != ')') return false;
+        pos++;
+        return true;
+    }
+    
+    bool parse_int(int& value) {
+        skip_spaces();
+        size_t start = pos;
+        while (pos < text.size() && std::isdigit((unsigned char)text[pos])) pos++;
+        if (pos == start || pos - start > 9) return false;
+        value = std::stoi(text.substr(start, pos - start));
+        return true;
+    }
+    
+    char peek() {
+        skip_spaces();
+        return pos < text.size() ? text[pos] : '\0';
+    }
+    
+    void skip_spaces() {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) pos++;
+    }
+    
+    const std::string& text;
+    size_t pos = 0;
+};
+
+// 계산 중간값: 인덱스 구조로 나타낼 수 있으면 풀지 않고 그대로 둠 (level은 저장된 레벨 번호)
+//   Core   : (k, level)-core
+//   Shells : level의 셸 k..k_end-1 = (k, level)-core \ (k_end, level)-core (one-level 체인의 앞부분)
+//   Nodes  : 정렬된 노드 배열
+struct ExprValue {
+    enum class Kind { Empty, Core, Shells, Nodes };
+    Kind kind = Kind::Empty;
+    int k = 0;
+    int k_end = 0;
+    int level = -1;
+    std::shared_ptr<const std::vector<int>> nodes;
+};
+
+class ExprEvaluator {
+public:
+    explicit ExprEvaluator(const FlatIndexView& index) : index(index) {}
+    
+    ExprValue evaluate(const CoreExpr& expr) {
+        if (expr.op == CoreExpr::Op::Core) return core(expr.k, expr.g);
+        ExprValue a = evaluate(*expr.left);
+        ExprValue b = evaluate(*expr.right);
+        switch (expr.op) {
+            case CoreExpr::Op::Union: return unite(a, b);
+            case CoreExpr::Op::Intersection: return intersect(a, b);
+            default: return subtract(a, b);
+        }
+    }
+    
+    CoreResult to_result(const ExprValue& value) const {
+        CoreResult result;
+        switch (value.kind) {
+            case ExprValue::Kind::Empty:
+                break;
+            case ExprValue::Kind::Core:
+            case ExprValue::Kind::Shells:
+                walk_shells(value, [&](uint32_t set) { add_flat_set(index, set, result); });
+                break;
+            case ExprValue::Kind::Nodes:
+                result.add_span(NodeSpan{value.nodes->data(), value.nodes->size()});
+                result.keep_alive(value.nodes);
+                break;
+        }
+        return result;
+    }
+    
+private:
+    using Kind = ExprValue::Kind;
+    
+    int level_size(int level) const { return index.stored_level_size(level); }
+    
+    // 범위 밖이면 빈 값, 같은 run으로 합쳐진 g들은 같은 레벨이므로 같은 core
+    ExprValue core(int k, int g) const {
+        ExprValue value;
+        int level = index.level_of(g);
+        if (level < 0 || k <= 0 || k > level_size(level)) return value;
+        value.kind = Kind::Core;
+        value.k = k;
+        value.level = level;
+        return value;
+    }
+    
+    ExprValue shells(int level, int k, int k_end) const {
+        if (k_end > level_size(level)) {
+            ExprValue value;
+            if (k <= level_size(level)) {
+                value.kind = Kind::Core;
+                value.k = k;
+                value.level = level;
+            }
+            return value;
+        }
+        ExprValue value;
+        if (k >= k_end) return value;
+        value.kind = Kind::Shells;
+        value.k = k;
+        value.k_end = k_end;
+        value.level = level;
+        return value;
+    }
+    
+    ExprValue nodes(std::vector<int> sorted) const {
+        ExprValue value;
+        if (sorted.empty()) return value;
+        value.kind = Kind::Nodes;
+        value.nodes = std::make_shared<const std::vector<int>>(std::move(sorted));
+        return value;
+    }
+    
+    bool structural(const ExprValue& v) const { return v.kind == Kind::Core || v.kind == Kind::Shells; }
+    int end_of(const ExprValue& v) const { return v.kind == Kind::Core ? level_size(v.level) + 1 : v.k_end; }
+    
+    // 구조적인 a가 (k, level)-core b에 들어가는지: a의 모든 노드는 (a.k, a.level)-core에 있음
+    bool inside_core(const ExprValue& a, const ExprValue& b) const {
+        return b.kind == Kind::Core && structural(a) && a.k >= b.k && a.level >= b.level;
+    }
+    
+    // level의 셸 k..end-1의 value 집합들 (k는 체인 위 레벨 안 위치)
+    template <typename Visit>
+    void walk_shells(const ExprValue& value, Visit&& visit) const {
+        int end = end_of(value);
+        uint32_t base = index.level_begin[value.level];
+        for (uint32_t n = base + value.k - 1; n != FlatIndex::kNull && (int)(n - base) + 1 < end; n = index.nodes[n].next) {
+            visit(index.nodes[n].value);
+        }
+    }
+    
+    std::vector<int> materialize(const ExprValue& value) const {
+        if (value.kind == Kind::Nodes) return *value.nodes;
+        return to_result(value).to_vector(true);
+    }
+    
+    ExprValue unite(const ExprValue& a, const ExprValue& b) const {
+        if (a.kind == Kind::Empty) return b;
+        if (b.kind == Kind::Empty) return a;
+        if (inside_core(a, b)) return b;
+        if (inside_core(b, a)) return a;
+        // 같은 레벨의 이어지거나 겹치는 셸 구간은 구간 하나
+        if (structural(a) && structural(b) && a.level == b.level &&
+            std::max(a.k, b.k) <= std::min(end_of(a), end_of(b))) {
+            return shells(a.level, std::min(a.k, b.k), std::max(end_of(a), end_of(b)));
+        }
+        
+        std::vector<int> left = materialize(a), right = materialize(b), out;
+        out.reserve(left.size() + right.size());
+        std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(out));
+        return nodes(std::move(out));
+    }
+    
+    ExprValue intersect(const ExprValue& a, const ExprValue& b) const {
+        if (a.kind == Kind::Empty || b.kind == Kind::Empty) return ExprValue();
+        if (inside_core(a, b)) return a;
+        if (inside_core(b, a)) return b;
+        if (structural(a) && structural(b) && a.level == b.level) {
+            return shells(a.level, std::max(a.k, b.k), std::min(end_of(a), end_of(b)));
+        }
+        
+        // 구조로 못 줄이면 양쪽을 정렬된 배열로 풀어 병합
+        std::vector<int> left = materialize(a), right = materialize(b), out;
+        out.reserve(std::min(left.size(), right.size()));
+        std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(out));
+        return nodes(std::move(out));
+    }
+    
+    ExprValue subtract(const ExprValue& a, const ExprValue& b) const {
+        if (a.kind == Kind::Empty) return a;
+        if (b.kind == Kind::Empty) return a;
+        if (inside_core(a, b)) return ExprValue();
+        if (structural(a) && structural(b) && a.level == b.level) {
+            // 셸 구간끼리의 차: 남는 부분이 한 구간이면 그대로
+            if (b.k <= a.k) return shells(a.level, std::max(a.k, end_of(b)), end_of(a));
+            if (end_of(b) >= end_of(a)) return shells(a.level, a.k, std::min(end_of(a), b.k));
+        }
+        
+        std::vector<int> left = materialize(a), right = materialize(b), out;
+        out.reserve(left.size());
+        std::set_difference(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(out));
+        return nodes(std::move(out));
+    }
+    
+    const FlatIndexView& index;
+};
+
+}  // namespace
+
+bool parse_core_expr(const std::string& text, CoreExpr& expr) {
+    return ExprParser(text).parse(expr);
+}
+
+std::string core_expr_text(const CoreExpr& expr) {
+    switch (expr.op) {
+        case CoreExpr::Op::Core:
+            return "(" + std::to_string(expr.k) + "," + std::to_string(expr.g) + ")";
+        case CoreExpr::Op::Union:
+            return "(" + core_expr_text(*expr.left) + " | " + core_expr_text(*expr.right) + ")";
+        case CoreExpr::Op::Intersection:
+            return "(" + core_expr_text(*expr.left) + " & " + core_expr_text(*expr.right) + ")";
+        case CoreExpr::Op::Difference:
+            return "(" + core_expr_text(*expr.left) + " - " + core_expr_text(*expr.right) + ")";
+    }
+    return "?";
+}
+
+CoreResult evaluate_core_expr(const FlatIndexView& one_level, const CoreExpr& expr) {
+    ExprEvaluator evaluator(one_level);
+    return evaluator.to_result(evaluator.evaluate(expr));
+}
+
 // 유틸리티 함수들
 int count_total_nodes(const std::shared_ptr<TreeNode>& tree, const std::string& type) {
     if (!tree) return 0;
@@ -182,6 +1356,24 @@ int count_total_nodes(const std::shared_ptr<TreeNode>& tree, const std::string&
     }
 }
 
+int count_total_nodes(const FlatIndex& index, const std::string& type) {
+    // 노드 하나를 여러 번 가리키는 포인터가 없으므로 저장된 집합 전체가 저장된 노드 수
+    if (type == "naive" || type == "diag") {
+        return index.stored_nodes();
+    }
+    
+    // 트리 버전처럼 저장된 레벨마다 k=1에서 next 체인의 value만 셈 (run으로 합쳐진 레벨은 한 번)
+    int total = 0;
+    for (int l = 0; l < index.num_stored_levels(); l++) {
+        uint32_t n = index.stored_level_size(l) > 0 ? index.level_begin[l] : FlatIndex::kNull;
+        while (n != FlatIndex::kNull) {
+            total += index.set_size(index.nodes[n].value);
+            n = index.nodes[n].next;
+        }
+    }
+    return total;
+}
+
 // 기타 유틸리티 함수들 (임시 구현)
 std::map<int, int> count_each_nodes(const std::shared_ptr<TreeNode>& tree, const std::string& type) {
     return std::map<int, int>();
@@ -0,0 +1,391 @@
+#include "kg_index.h"
+#include <cstring>
+
+// ============================================================================
+// 노드 ID 집합 인코딩
+// ============================================================================
+//
+// 모든 인코딩은 [codec 1바이트][원소 수 varint][본문] 형태
+//   Raw         : uint32 리틀 엔디언 배열
+//   DeltaVarint : 첫 값과 이후 간격들의 LEB128
+//   EliasFano   : [최솟값 varint][하위 비트 수 1바이트][하위 비트들][상위 비트 단항 부호]
+//   Roaring     : [청크 수 varint] 청크마다 [상위 16비트 간격 varint][원소 수-1 varint][컨테이너]
+//                 컨테이너는 원소가 4096개를 넘으면 8KB 비트맵, 아니면 하위 16비트 배열
+
+namespace {
+
+constexpr int kRoaringArrayMax = 4096;
+constexpr size_t kRoaringBitmapBytes = 8192;
+
+size_t varint_bytes(uint32_t value) {
+    size_t bytes = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+void put_varint(uint32_t value, std::vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t get_varint(const uint8_t*& data) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (*data & 0x80) {
+        value |= static_cast<uint32_t>(*data++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint32_t>(*data++) << shift;
+    return value;
+}
+
+int floor_log2(uint64_t x) {
+    int bits = -1;
+    while (x) {
+        x >>= 1;
+        bits++;
+    }
+    return bits;
+}
+
+// Elias-Fano 하위 비트 수: log2(범위 / 원소 수)
+int elias_fano_low_bits(uint32_t span, size_t count) {
+    if (count == 0 || span <= count) return 0;
+    return floor_log2(span / count);
+}
+
+size_t elias_fano_body_bytes(const uint32_t* first, size_t count) {
+    uint32_t base = first[0];
+    uint32_t span = first[count - 1] - base + 1;
+    int low = elias_fano_low_bits(span, count);
+    size_t low_bytes = (count * low + 7) / 8;
+    size_t high_bits = count + ((first[count - 1] - base) >> low) + 1;
+    return varint_bytes(base) + 1 + low_bytes + (high_bits + 7) / 8;
+}
+
+size_t roaring_body_bytes(const uint32_t* first, size_t count) {
+    size_t bytes = 0;
+    size_t chunks = 0;
+    uint32_t prev_key = 0;
+    for (size_t i = 0; i < count;) {
+        uint32_t key = first[i] >> 16;
+        size_t j = i;
+        while (j < count && (first[j] >> 16) == key) j++;
+        size_t card = j - i;
+        bytes += varint_bytes(key - prev_key) + varint_bytes(card - 1);
+        bytes += card > (size_t)kRoaringArrayMax ? kRoaringBitmapBytes : card * 2;
+        prev_key = key;
+        chunks++;
+        i = j;
+    }
+    return varint_bytes(chunks) + bytes;
+}
+
+size_t body_bytes(const uint32_t* first, size_t count, SetCodec codec) {
+    if (count == 0) return 0;
+    switch (codec) {
+        case SetCodec::Raw:
+            return count * sizeof(uint32_t);
+        case SetCodec::DeltaVarint: {
+            size_t bytes = varint_bytes(first[0]);
+            for (size_t i = 1; i < count; i++) {
+                bytes += varint_bytes(first[i] - first[i - 1]);
+            }
+            return bytes;
+        }
+        case SetCodec::EliasFano:
+            return elias_fano_body_bytes(first, count);
+        case SetCodec::Roaring:
+            return roaring_body_bytes(first, count);
+        default:
+            return 0;
+    }
+}
+
+// 크기를 직접 계산해서 가장 작은 인코딩 선택 (밀도가 높을수록 Roaring/Elias-Fano 쪽)
+SetCodec choose_codec(const uint32_t* first, size_t count) {
+    SetCodec best = SetCodec::DeltaVarint;
+    size_t best_bytes = body_bytes(first, count, best);
+    for (SetCodec codec : {SetCodec::EliasFano, SetCodec::Roaring, SetCodec::Raw}) {
+        size_t bytes = body_bytes(first, count, codec);
+        if (bytes < best_bytes) {
+            best = codec;
+            best_bytes = bytes;
+        }
+    }
+    return best;
+}
+
+void encode_elias_fano(const uint32_t* first, size_t count, std::vector<uint8_t>& out) {
+    uint32_t base = first[0];
+    uint32_t span = first[count - 1] - base + 1;
+    int low = elias_fano_low_bits(span, count);
+    put_varint(base, out);
+    out.push_back(static_cast<uint8_t>(low));
+
+    size_t low_begin = out.size();
+    out.resize(low_begin + (count * low + 7) / 8, 0);
+    size_t high_bits = count + ((first[count - 1] - base) >> low) + 1;
+    size_t high_begin = out.size();
+    out.resize(high_begin + (high_bits + 7) / 8, 0);
+
+    uint32_t low_mask = low == 0 ? 0 : (0xFFFFFFFFu >> (32 - low));
+    for (size_t i = 0; i < count; i++) {
+        uint32_t x = first[i] - base;
+
+        uint32_t bits = x & low_mask;
+        size_t pos = i * low;
+        for (int b = 0; b < low; b++, pos++) {
+            if (bits >> b & 1) out[low_begin + pos / 8] |= 1u << (pos % 8);
+        }
+
+        size_t high = (x >> low) + i;
+        out[high_begin + high / 8] |= 1u << (high % 8);
+    }
+}
+
+void encode_roaring(const uint32_t* first, size_t count, std::vector<uint8_t>& out) {
+    size_t chunks = 0;
+    for (size_t i = 0; i < count; chunks++) {
+        uint32_t key = first[i] >> 16;
+        while (i < count && (first[i] >> 16) == key) i++;
+    }
+    put_varint(chunks, out);
+
+    uint32_t prev_key = 0;
+    for (size_t i = 0; i < count;) {
+        uint32_t key = first[i] >> 16;
+        size_t j = i;
+        while (j < count && (first[j] >> 16) == key) j++;
+        size_t card = j - i;
+        put_varint(key - prev_key, out);
+        put_varint(card - 1, out);
+
+        if (card > (size_t)kRoaringArrayMax) {
+            size_t begin = out.size();
+            out.resize(begin + kRoaringBitmapBytes, 0);
+            for (size_t t = i; t < j; t++) {
+                uint32_t lowbits = first[t] & 0xFFFF;
+                out[begin + lowbits / 8] |= 1u << (lowbits % 8);
+            }
+        } else {
+            for (size_t t = i; t < j; t++) {
+                out.push_back(static_cast<uint8_t>(first[t]));
+                out.push_back(static_cast<uint8_t>(first[t] >> 8));
+            }
+        }
+        prev_key = key;
+        i = j;
+    }
+}
+
+// 본문을 디코딩하면서 원소마다 emit 호출 (오름차순)
+template <typename Emit>
+void decode_with(const uint8_t* data, Emit&& emit) {
+    SetCodec codec = static_cast<SetCodec>(*data++);
+    uint32_t count = get_varint(data);
+    if (count == 0) return;
+
+    switch (codec) {
+        case SetCodec::Raw:
+            for (uint32_t i = 0; i < count; i++, data += 4) {
+                uint32_t value;
+                std::memcpy(&value, data, 4);
+                emit(static_cast<int>(value));
+            }
+            break;
+
+        case SetCodec::DeltaVarint: {
+            uint32_t value = get_varint(data);
+            emit(static_cast<int>(value));
+            for (uint32_t i = 1; i < count; i++) {
+                value += get_varint(data);
+                emit(static_cast<int>(value));
+            }
+            break;
+        }
+
+        case SetCodec::EliasFano: {
+            uint32_t base = get_varint(data);
+            int low = *data++;
+            const uint8_t* low_bits = data;
+            const uint8_t* high_bits = data + (static_cast<size_t>(count) * low + 7) / 8;
+
+            size_t pos = 0;
+            uint32_t i = 0;
+            for (size_t byte = 0; i < count; byte++) {
+                uint32_t word = high_bits[byte];
+                while (word) {
+                    int bit = __builtin_ctz(word);
+                    word &= word - 1;
+                    uint32_t high = static_cast<uint32_t>(byte * 8 + bit - i);
+
+                    uint32_t lowbits = 0;
+                    for (int b = 0; b < low; b++, pos++) {
+                        lowbits |= static_cast<uint32_t>(low_bits[pos / 8] >> (pos % 8) & 1) << b;
+                    }
+                    emit(static_cast<int>(base + ((high << low) | lowbits)));
+                    if (++i == count) break;
+                }
+            }
+            break;
+        }
+
+        case SetCodec::Roaring: {
+            uint32_t chunks = get_varint(data);
+            uint32_t key = 0;
+            for (uint32_t c = 0; c < chunks; c++) {
+                key += get_varint(data);
+                uint32_t card = get_varint(data) + 1;
+                uint32_t high = key << 16;
+
+                if (card > (uint32_t)kRoaringArrayMax) {
+                    for (size_t w = 0; w < kRoaringBitmapBytes / 8; w++) {
+                        uint64_t word;
+                        std::memcpy(&word, data + w * 8, 8);
+                        while (word) {
+                            int bit = __builtin_ctzll(word);
+                            word &= word - 1;
+                            emit(static_cast<int>(high | (w * 64 + bit)));
+                        }
+                    }
+                    data += kRoaringBitmapBytes;
+                } else {
+                    for (uint32_t t = 0; t < card; t++, data += 2) {
+                        emit(static_cast<int>(high | data[0] | (static_cast<uint32_t>(data[1]) << 8)));
+                    }
+                }
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+SetCodec encode_sorted_set(const int* first, const int* last, SetCodec codec, std::vector<uint8_t>& out) {
+    const uint32_t* values = reinterpret_cast<const uint32_t*>(first);
+    size_t count = last - first;
+    if (codec == SetCodec::Auto) {
+        codec = count == 0 ? SetCodec::Raw : choose_codec(values, count);
+    }
+
+    out.push_back(static_cast<uint8_t>(codec));
+    put_varint(count, out);
+    if (count == 0) return codec;
+
+    switch (codec) {
+        case SetCodec::Raw:
+            for (size_t i = 0; i < count; i++) {
+                for (int b = 0; b < 4; b++) {
+                    out.push_back(static_cast<uint8_t>(values[i] >> (8 * b)));
+                }
+            }
+            break;
+        case SetCodec::DeltaVarint:
+            put_varint(values[0], out);
+            for (size_t i = 1; i < count; i++) {
+                put_varint(values[i] - values[i - 1], out);
+            }
+            break;
+        case SetCodec::EliasFano:
+            encode_elias_fano(values, count, out);
+            break;
+        case SetCodec::Roaring:
+            encode_roaring(values, count, out);
+            break;
+        default:
+            break;
+    }
+    return codec;
+}
+
+size_t encoded_set_bytes(const int* first, const int* last, SetCodec codec) {
+    const uint32_t* values = reinterpret_cast<const uint32_t*>(first);
+    size_t count = last - first;
+    if (codec == SetCodec::Auto) {
+        codec = count == 0 ? SetCodec::Raw : choose_codec(values, count);
+    }
+    return 1 + varint_bytes(count) + body_bytes(values, count, codec);
+}
+
+SetCodec encoded_set_codec(const uint8_t* data) {
+    return static_cast<SetCodec>(*data);
+}
+
+size_t encoded_set_size(const uint8_t* data) {
+    data++;
+    return get_varint(data);
+}
+
+void decode_sorted_set(const uint8_t* data, std::unordered_set<int>& out) {
+    decode_with(data, [&](int node) { out.insert(node); });
+}
+
+void decode_sorted_set(const uint8_t* data, std::vector<int>& out) {
+    out.reserve(out.size() + encoded_set_size(data));
+    decode_with(data, [&](int node) { out.push_back(node); });
+}
+
+int* decode_sorted_set(const uint8_t* data, int* out) {
+    decode_with(data, [&](int node) { *out++ = node; });
+    return out;
+}
+
+bool decode_sorted_set_blocks(const uint8_t* data, const std::function<bool(const int*, size_t)>& block) {
+    const uint8_t* body = data + 1;
+    uint32_t count = get_varint(body);
+    if (count == 0) return true;
+    
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // raw 본문이 int 정렬에 맞으면 저장된 배열 자체가 블록
+    if (encoded_set_codec(data) == SetCodec::Raw && reinterpret_cast<uintptr_t>(body) % alignof(int) == 0) {
+        return block(reinterpret_cast<const int*>(body), count);
+    }
+#endif
+    
+    constexpr size_t kBlock = 256;
+    int buffer[kBlock];
+    size_t filled = 0;
+    bool going = true;
+    decode_with(data, [&](int node) {
+        if (!going) return;
+        buffer[filled++] = node;
+        if (filled == kBlock) {
+            going = block(buffer, filled);
+            filled = 0;
+        }
+    });
+    if (going && filled > 0) going = block(buffer, filled);
+    return going;
+}
+
+const char* set_codec_name(SetCodec codec) {
+    switch (codec) {
+        case SetCodec::Raw: return "raw";
+        case SetCodec::DeltaVarint: return "varint";
+        case SetCodec::EliasFano: return "ef";
+        case SetCodec::Roaring: return "roaring";
+        case SetCodec::Auto: return "auto";
+    }
+    return "?";
+}
+
+bool parse_set_codec(const std::string& name, SetCodec& codec) {
+    for (SetCodec c : {SetCodec::Auto, SetCodec::Raw, SetCodec::DeltaVarint, SetCodec::EliasFano, SetCodec::Roaring}) {
+        if (name == set_codec_name(c)) {
+            codec = c;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,414 @@
+#include "kg_index.h"
+#include <immintrin.h>
+
+// ============================================================================
+// 정렬된 배열 교집합/차집합 커널
+// ============================================================================
+//
+// 크기가 비슷하면 블록 병합: a와 b에서 블록(SSE 4개, AVX2 8개)을 하나씩 꺼내 모든 회전끼리 비교하고
+// 최댓값이 작은 쪽 블록을 넘김. 한쪽이 훨씬 작으면 작은 쪽 원소마다 큰 쪽을 갤로핑 탐색
+// 결과는 out 뒤에 붙이지 않고 out을 덮어씀
+
+namespace {
+
+// 이 비율 이상 크기가 차이 나면 갤로핑
+constexpr size_t kGallopRatio = 8;
+
+using KernelFn = void (*)(const int*, size_t, const int*, size_t, std::vector<int>&);
+
+// ---------------------------------------------------------------------------
+// 스칼라
+// ---------------------------------------------------------------------------
+
+// [first, last)에서 value 이상인 첫 위치 (지수 탐색 후 이분 탐색)
+const int* gallop(const int* first, const int* last, int value) {
+    size_t step = 1;
+    const int* probe = first;
+    while (probe < last && *probe < value) {
+        first = probe + 1;
+        probe = first + step;
+        step *= 2;
+    }
+    return std::lower_bound(first, std::min(probe, last), value);
+}
+
+void intersect_gallop(const int* small, size_t ns, const int* large, size_t nl, std::vector<int>& out) {
+    const int* pos = large;
+    const int* end = large + nl;
+    for (size_t i = 0; i < ns && pos < end; i++) {
+        pos = gallop(pos, end, small[i]);
+        if (pos < end && *pos == small[i]) out.push_back(small[i]);
+    }
+}
+
+void intersect_scalar_merge(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    size_t i = 0, j = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            i++;
+        } else if (b[j] < a[i]) {
+            j++;
+        } else {
+            out.push_back(a[i]);
+            i++;
+            j++;
+        }
+    }
+}
+
+void difference_scalar_merge(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    size_t i = 0, j = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            out.push_back(a[i++]);
+        } else if (b[j] < a[i]) {
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+    out.insert(out.end(), a + i, a + na);
+}
+
+// a가 작으면 a 원소마다 b를 갤로핑, b가 작으면 b 원소가 있는 자리만 a에서 잘라냄
+void difference_gallop(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    if (na <= nb) {
+        const int* pos = b;
+        const int* end = b + nb;
+        for (size_t i = 0; i < na; i++) {
+            pos = gallop(pos, end, a[i]);
+            if (pos == end || *pos != a[i]) out.push_back(a[i]);
+        }
+    } else {
+        const int* pos = a;
+        const int* end = a + na;
+        for (size_t j = 0; j < nb && pos < end; j++) {
+            const int* hit = gallop(pos, end, b[j]);
+            out.insert(out.end(), pos, hit);
+            pos = (hit < end && *hit == b[j]) ? hit + 1 : hit;
+        }
+        out.insert(out.end(), pos, end);
+    }
+}
+
+bool skewed(size_t na, size_t nb) {
+    return na * kGallopRatio < nb || nb * kGallopRatio < na;
+}
+
+void intersect_scalar(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    if (skewed(na, nb)) {
+        if (na < nb) intersect_gallop(a, na, b, nb, out);
+        else intersect_gallop(b, nb, a, na, out);
+        return;
+    }
+    intersect_scalar_merge(a, na, b, nb, out);
+}
+
+void difference_scalar(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    if (skewed(na, nb)) {
+        difference_gallop(a, na, b, nb, out);
+        return;
+    }
+    difference_scalar_merge(a, na, b, nb, out);
+}
+
+// ---------------------------------------------------------------------------
+// SSE4.1 (4개 블록)
+// ---------------------------------------------------------------------------
+
+// 4비트 마스크 -> 해당 int들을 앞으로 모으는 pshufb 마스크
+struct ShuffleTable4 {
+    alignas(16) uint8_t masks[16][16];
+    ShuffleTable4() {
+        for (int m = 0; m < 16; m++) {
+            int pos = 0;
+            for (int lane = 0; lane < 4; lane++) {
+                if (m >> lane & 1) {
+                    for (int b = 0; b < 4; b++) masks[m][pos * 4 + b] = lane * 4 + b;
+                    pos++;
+                }
+            }
+            for (int b = pos * 4; b < 16; b++) masks[m][b] = 0x80;
+        }
+    }
+};
+
+const ShuffleTable4& shuffle_table4() {
+    static const ShuffleTable4 table;
+    return table;
+}
+
+__attribute__((target("sse4.1")))
+inline int match_mask_sse(__m128i va, __m128i vb) {
+    __m128i m = _mm_cmpeq_epi32(va, vb);
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+    return _mm_movemask_ps(_mm_castsi128_ps(m));
+}
+
+__attribute__((target("sse4.1")))
+inline size_t compact_sse(__m128i va, int mask, int* dst) {
+    const auto& table = shuffle_table4();
+    __m128i shuffle = _mm_load_si128(reinterpret_cast<const __m128i*>(table.masks[mask]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(va, shuffle));
+    return __builtin_popcount(mask);
+}
+
+__attribute__((target("sse4.1")))
+void intersect_sse(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    if (skewed(na, nb)) {
+        intersect_scalar(a, na, b, nb, out);
+        return;
+    }
+
+    out.resize(std::min(na, nb) + 4);
+    int* dst = out.data();
+    size_t i = 0, j = 0;
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        dst += compact_sse(va, match_mask_sse(va, vb), dst);
+
+        int amax = a[i + 3], bmax = b[j + 3];
+        if (amax <= bmax) i += 4;
+        if (bmax <= amax) j += 4;
+    }
+    size_t count = dst - out.data();
+    out.resize(count);
+    intersect_scalar_merge(a + i, na - i, b + j, nb - j, out);
+}
+
+__attribute__((target("sse4.1")))
+void difference_sse(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    if (skewed(na, nb)) {
+        difference_scalar(a, na, b, nb, out);
+        return;
+    }
+
+    out.resize(na + 4);
+    int* dst = out.data();
+    size_t i = 0, j = 0;
+    int found = 0;  // 현재 a 블록에서 b에 있는 원소들
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        found |= match_mask_sse(va, vb);
+
+        int amax = a[i + 3], bmax = b[j + 3];
+        if (amax <= bmax) {
+            dst += compact_sse(va, ~found & 0xF, dst);
+            found = 0;
+            i += 4;
+        }
+        if (bmax <= amax) j += 4;
+    }
+    out.resize(dst - out.data());
+
+    // 비교하다 만 a 블록은 찾은 원소를 빼고 나머지 b와 스칼라로 마무리
+    std::vector<int> rest;
+    for (size_t t = 0; t < 4 && found && i + t < na; t++) {
+        if (!(found >> t & 1)) rest.push_back(a[i + t]);
+    }
+    if (found) {
+        i += 4;
+        difference_scalar_merge(rest.data(), rest.size(), b + j, nb - j, out);
+    }
+    difference_scalar_merge(a + i, na - i, b + j, nb - j, out);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 (8개 블록)
+// ---------------------------------------------------------------------------
+
+// 8비트 마스크 -> 해당 int들을 앞으로 모으는 permutevar8x32 인덱스
+struct PermuteTable8 {
+    alignas(32) int32_t indices[256][8];
+    PermuteTable8() {
+        for (int m = 0; m < 256; m++) {
+            int pos = 0;
+            for (int lane = 0; lane < 8; lane++) {
+                if (m >> lane & 1) indices[m][pos++] = lane;
+            }
+            for (; pos < 8; pos++) indices[m][pos] = 0;
+        }
+    }
+};
+
+const PermuteTable8& permute_table8() {
+    static const PermuteTable8 table;
+    return table;
+}
+
+__attribute__((target("avx2")))
+inline int match_mask_avx2(__m256i va, __m256i vb) {
+    __m256i m = _mm256_cmpeq_epi32(va, vb);
+    for (int r = 1; r < 8; r++) {
+        __m256i rot = _mm256_setr_epi32(r, (r + 1) & 7, (r + 2) & 7, (r + 3) & 7,
+                                        (r + 4) & 7, (r + 5) & 7, (r + 6) & 7, (r + 7) & 7);
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_permutevar8x32_epi32(vb, rot)));
+    }
+    return _mm256_movemask_ps(_mm256_castsi256_ps(m));
+}
+
+__attribute__((target("avx2")))
+inline size_t compact_avx2(__m256i va, int mask, int* dst) {
+    const auto& table = permute_table8();
+    __m256i perm = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.indices[mask]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permutevar8x32_epi32(va, perm));
+    return __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2")))
+void intersect_avx2(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    if (skewed(na, nb)) {
+        intersect_scalar(a, na, b, nb, out);
+        return;
+    }
+
+    out.resize(std::min(na, nb) + 8);
+    int* dst = out.data();
+    size_t i = 0, j = 0;
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        dst += compact_avx2(va, match_mask_avx2(va, vb), dst);
+
+        int amax = a[i + 7], bmax = b[j + 7];
+        if (amax <= bmax) i += 8;
+        if (bmax <= amax) j += 8;
+    }
+    out.resize(dst - out.data());
+    intersect_scalar_merge(a + i, na - i, b + j, nb - j, out);
+}
+
+__attribute__((target("avx2")))
+void difference_avx2(const int* a, size_t na, const int* b, size_t nb, std::vector<int>& out) {
+    if (skewed(na, nb)) {
+        difference_scalar(a, na, b, nb, out);
+        return;
+    }
+
+    out.resize(na + 8);
+    int* dst = out.data();
+    size_t i = 0, j = 0;
+    int found = 0;
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        found |= match_mask_avx2(va, vb);
+
+        int amax = a[i + 7], bmax = b[j + 7];
+        if (amax <= bmax) {
+            dst += compact_avx2(va, ~found & 0xFF, dst);
+            found = 0;
+            i += 8;
+        }
+        if (bmax <= amax) j += 8;
+    }
+    out.resize(dst - out.data());
+
+    std::vector<int> rest;
+    for (size_t t = 0; t < 8 && found && i + t < na; t++) {
+        if (!(found >> t & 1)) rest.push_back(a[i + t]);
+    }
+    if (found) {
+        i += 8;
+        difference_scalar_merge(rest.data(), rest.size(), b + j, nb - j, out);
+    }
+    difference_scalar_merge(a + i, na - i, b + j, nb - j, out);
+}
+
+// ---------------------------------------------------------------------------
+// 디스패치
+// ---------------------------------------------------------------------------
+
+bool cpu_supports(SetKernel kernel) {
+    switch (kernel) {
+        case SetKernel::Scalar: return true;
+        case SetKernel::SSE41: return __builtin_cpu_supports("sse4.1");
+        case SetKernel::AVX2: return __builtin_cpu_supports("avx2");
+        default: return false;
+    }
+}
+
+SetKernel best_kernel() {
+    if (cpu_supports(SetKernel::AVX2)) return SetKernel::AVX2;
+    if (cpu_supports(SetKernel::SSE41)) return SetKernel::SSE41;
+    return SetKernel::Scalar;
+}
+
+struct KernelTable {
+    SetKernel kernel;
+    KernelFn intersect;
+    KernelFn difference;
+};
+
+KernelTable make_table(SetKernel kernel) {
+    switch (kernel) {
+        case SetKernel::AVX2: return {kernel, intersect_avx2, difference_avx2};
+        case SetKernel::SSE41: return {kernel, intersect_sse, difference_sse};
+        default: return {SetKernel::Scalar, intersect_scalar, difference_scalar};
+    }
+}
+
+KernelTable& active_table() {
+    static KernelTable table = make_table(best_kernel());
+    return table;
+}
+
+}  // namespace
+
+bool select_set_kernel(SetKernel kernel) {
+    if (kernel == SetKernel::Auto) kernel = best_kernel();
+    if (!cpu_supports(kernel)) return false;
+    active_table() = make_table(kernel);
+    return true;
+}
+
+SetKernel active_set_kernel() {
+    return active_table().kernel;
+}
+
+bool set_kernel_supported(SetKernel kernel) {
+    return kernel == SetKernel::Auto || cpu_supports(kernel);
+}
+
+const char* set_kernel_name(SetKernel kernel) {
+    switch (kernel) {
+        case SetKernel::Auto: return "auto";
+        case SetKernel::Scalar: return "scalar";
+        case SetKernel::SSE41: return "sse4.1";
+        case SetKernel::AVX2: return "avx2";
+    }
+    return "?";
+}
+
+void sorted_intersection(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& out) {
+    out.clear();
+    if (a.empty() || b.empty()) return;
+    active_table().intersect(a.data(), a.size(), b.data(), b.size(), out);
+}
+
+void sorted_difference(const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& out) {
+    out.clear();
+    if (b.empty()) {
+        out = a;
+        return;
+    }
+    if (a.empty()) return;
+    active_table().difference(a.data(), a.size(), b.data(), b.size(), out);
+}
+
+std::vector<int> set_intersection(const std::vector<int>& set1, const std::vector<int>& set2) {
+    std::vector<int> result;
+    sorted_intersection(set1, set2, result);
+    return result;
+}
+
+std::vector<int> set_difference(const std::vector<int>& set1, const std::vector<int>& set2) {
+    std::vector<int> result;
+    sorted_difference(set1, set2, result);
+    return result;
+}
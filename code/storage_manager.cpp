@@ -1,18 +1,1177 @@
 #include "kg_index.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "index files are written in host byte order (little-endian)");
+
+// ============================================================================
+// 바이너리 인덱스 파일 형식
+// ============================================================================
+//
+// [헤더 24바이트][섹션 표: 섹션마다 32바이트][섹션들 (64바이트 정렬, 집합 섹션은 페이지 정렬)]
+//   헤더     : magic "KGINDEX\0", 형식 버전 u32, 섹션 수 u32, 파일 크기 u64
+//   섹션 표  : id u32, 예약 u32, 오프셋 u64, 크기 u64, 체크섬 u64
+// 섹션 본문은 메모리 레이아웃 그대로의 배열이라 읽을 때 벡터 하나에 한 번에 읽거나 mmap한 채로 씀
+
+namespace {
+
+constexpr char kMagic[8] = {'K', 'G', 'I', 'N', 'D', 'E', 'X', '\0'};
+constexpr uint32_t kFormatVersion = 4;  // 2: 레벨별 집합 구간 표, 페이지 정렬된 집합 섹션, 3: 노드별 aux를 i 순서 조밀 배열로, 4: 레벨 노드별 core 크기
+constexpr size_t kSectionAlign = 64;
+constexpr size_t kPageBytes = 4096;
+
+enum SectionId : uint32_t {
+    kSectionMeta = 1,
+    kSectionLevelRuns = 2,
+    kSectionLevelBegin = 3,
+    kSectionNodes = 4,
+    kSectionAuxEntries = 5,
+    kSectionSets = 6,
+    kSectionFlatInfo = 7,
+    kSectionLevelMaxK = 8,
+    kSectionKRuns = 9,
+    kSectionArena = 10,
+    kSectionNaiveInfo = 11,
+    kSectionLevelSets = 12,
+    kSectionCoreSizes = 13,
+
+    // 하이퍼그래프 스냅샷
+    kSectionGraphInfo = 20,
+    kSectionEdgeBlock = 21,     // 여러 개: [하이퍼엣지 수][크기들][노드들] (u32)
+    kSectionTwins = 22,         // [대표][원소 수][원소들]의 반복
+    kSectionOriginalIds = 23,
+};
+
+constexpr size_t kEdgeBlockWords = 1 << 18;  // 스냅샷 하이퍼엣지 블록 크기 (약 1MB)
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+    uint64_t file_size;
+};
+
+struct SectionEntry {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(FileHeader) == 24, "unexpected header layout");
+static_assert(sizeof(SectionEntry) == 32, "unexpected section entry layout");
+static_assert(sizeof(FlatIndex::Node) == 28, "unexpected node layout");
+static_assert(sizeof(FlatIndex::AuxEntry) == 8, "unexpected aux entry layout");
+
+// 8바이트 단위 FNV 변형 (섹션 손상 검출용), 나눠서 들어오는 본문도 이어서 계산
+class SectionChecksum {
+public:
+    explicit SectionChecksum(uint64_t size) : hash(1469598103934665603ULL ^ size) {}
+
+    void update(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (pending > 0 && pending < 8 && size > 0) {
+            carry[pending++] = *bytes++;
+            size--;
+        }
+        if (pending == 8) {
+            mix(carry);
+            pending = 0;
+        }
+        for (; size >= 8; bytes += 8, size -= 8) {
+            mix(bytes);
+        }
+        std::memcpy(carry, bytes, size);
+        pending += size;
+    }
+
+    uint64_t value() const {
+        uint64_t result = hash;
+        for (size_t i = 0; i < pending; i++) {
+            result = (result ^ carry[i]) * 1099511628211ULL;
+        }
+        return result;
+    }
+
+private:
+    void mix(const uint8_t* bytes) {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t hash;
+    uint8_t carry[8];
+    size_t pending = 0;
+};
+
+uint64_t section_checksum(const void* data, size_t size) {
+    SectionChecksum checksum(size);
+    checksum.update(data, size);
+    return checksum.value();
+}
+
+struct SectionData {
+    uint32_t id;
+    const void* data;
+    size_t size;
+    size_t align;
+};
+
+template <typename T>
+SectionData section(uint32_t id, const std::vector<T>& values, size_t align = kSectionAlign) {
+    return SectionData{id, values.data(), values.size() * sizeof(T), align};
+}
+
+bool check_header(const FileHeader& header, uint64_t actual_size, const std::string& filename) {
+    const char* reason = nullptr;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) reason = "not an index file";
+    else if (header.version != kFormatVersion) reason = "unsupported format version";
+    else if (actual_size < header.file_size) reason = "truncated file";
+    if (reason) {
+        std::cerr << "❌ " << filename << ": " << reason << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool write_all(int fd, const void* data, size_t size, uint64_t offset) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t done = pwrite(fd, bytes, size, offset);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+        bytes += done;
+        size -= done;
+        offset += done;
+    }
+    return true;
+}
+
+// 스트림으로 이미 쓴 섹션의 체크섬 (파일에서 다시 읽으며 계산)
+bool stream_checksum(SectionStream& stream, uint64_t& checksum) {
+    SectionChecksum running(stream.size());
+    std::vector<uint8_t> chunk(1 << 20);
+    for (uint64_t position = 0; position < stream.size(); position += chunk.size()) {
+        size_t size = std::min<uint64_t>(chunk.size(), stream.size() - position);
+        if (!stream.read(position, chunk.data(), size)) return false;
+        running.update(chunk.data(), size);
+    }
+    checksum = running.value();
+    return true;
+}
+
+// stream이 있으면 그 파일의 SectionStream::kStart에 이미 쓰인 섹션(stream_id)을 첫 섹션으로 두고 나머지를 뒤에 붙임
+bool write_sections(const std::string& filename, const std::vector<SectionData>& sections,
+                    SectionStream* stream = nullptr, uint32_t stream_id = 0) {
+    std::vector<SectionEntry> table;
+    uint64_t offset = sizeof(FileHeader) + (sections.size() + (stream ? 1 : 0)) * sizeof(SectionEntry);
+    if (stream) {
+        if (stream->target() != filename || offset > SectionStream::kStart || !stream->flush()) {
+            std::cerr << "❌ Cannot finish streamed index " << stream->target() << " as " << filename << std::endl;
+            return false;
+        }
+        SectionEntry entry = {stream_id, 0, SectionStream::kStart, stream->size(), 0};
+        if (!stream_checksum(*stream, entry.checksum)) {
+            std::cerr << "❌ Cannot read back streamed section of " << filename << std::endl;
+            return false;
+        }
+        table.push_back(entry);
+        offset = SectionStream::kStart + stream->size();
+    }
+    for (const SectionData& data : sections) {
+        offset = (offset + data.align - 1) / data.align * data.align;
+        table.push_back(SectionEntry{data.id, 0, offset, data.size, section_checksum(data.data, data.size)});
+        offset += data.size;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.num_sections = table.size();
+    header.file_size = offset;
+
+    // 완성된 파일만 보이도록 임시 파일에 쓰고 이름을 바꿈 (섹션 사이 패딩은 0으로 읽히는 빈 구간)
+    std::string temp = filename + ".tmp";
+    int fd = stream ? stream->descriptor() : open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "❌ Cannot open " << temp << " for writing" << std::endl;
+        return false;
+    }
+
+    bool ok = write_all(fd, &header, sizeof(header), 0) &&
+              write_all(fd, table.data(), table.size() * sizeof(SectionEntry), sizeof(header));
+    for (size_t i = 0; ok && i < sections.size(); i++) {
+        const SectionEntry& entry = table[i + (stream ? 1 : 0)];
+        ok = write_all(fd, sections[i].data, sections[i].size, entry.offset);
+    }
+    ok = ok && ftruncate(fd, offset) == 0;
+    if (!stream && close(fd) != 0) ok = false;
+
+    if (!ok) {
+        std::cerr << "❌ Failed writing " << temp << std::endl;
+        if (!stream) std::remove(temp.c_str());
+        return false;
+    }
+    if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::cerr << "❌ Cannot rename " << temp << " to " << filename << std::endl;
+        if (!stream) std::remove(temp.c_str());
+        return false;
+    }
+    if (stream) stream->release();
+    return true;
+}
+
+// 섹션 표를 읽어 두고, 필요한 섹션들을 등록한 뒤 한꺼번에 읽음
+// 읽기는 활성 I/O 백엔드(io_uring이면 큐 깊이를 두고 동시에)로, 섹션이 도착하는 대로 체크섬 확인과
+// 등록된 디코딩이 남은 읽기와 겹쳐 실행됨
+class SectionReader {
+public:
+    bool open(const std::string& filename) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) return false;
+        name = filename;
+
+        FileHeader header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return fail("truncated header");
+        in.seekg(0, std::ios::end);
+        if (!check_header(header, in.tellg(), filename)) return false;
+        in.seekg(sizeof(header));
+
+        table.resize(header.num_sections);
+        if (!in.read(reinterpret_cast<char*>(table.data()), table.size() * sizeof(SectionEntry))) {
+            return fail("truncated section table");
+        }
+        return true;
+    }
+
+    bool has(uint32_t id) const {
+        return find(id) != nullptr;
+    }
+
+    // id가 같은 섹션들 (파일 순서)
+    std::vector<const SectionEntry*> all(uint32_t id) const {
+        std::vector<const SectionEntry*> entries;
+        for (const auto& entry : table) {
+            if (entry.id == id) entries.push_back(&entry);
+        }
+        return entries;
+    }
+
+    // 섹션을 out에 읽도록 등록 (크기는 여기서 한 번에 맞춤), decode는 섹션이 도착해 검증된 직후 호출
+    template <typename T>
+    bool want(uint32_t id, std::vector<T>& out, std::function<bool()> decode = nullptr) {
+        const SectionEntry* entry = find(id);
+        if (!entry) return fail("missing section " + std::to_string(id));
+        return want(*entry, out, std::move(decode));
+    }
+
+    template <typename T>
+    bool want(const SectionEntry& entry, std::vector<T>& out, std::function<bool()> decode = nullptr) {
+        if (entry.size % sizeof(T) != 0) return fail("bad size for section " + std::to_string(entry.id));
+        out.resize(entry.size / sizeof(T));
+        targets.push_back(Target{&entry, out.data(), std::move(decode)});
+        return true;
+    }
+
+    bool read_all() {
+        std::vector<ReadRange> ranges;
+        for (const Target& target : targets) {
+            ranges.push_back(ReadRange{target.entry->offset, target.entry->size, target.data});
+        }
+        std::string problem;
+        bool ok = read_file_ranges(name, ranges, [&](size_t i) {
+            const Target& target = targets[i];
+            if (section_checksum(target.data, target.entry->size) != target.entry->checksum) {
+                problem = "checksum mismatch in section " + std::to_string(target.entry->id);
+                return false;
+            }
+            if (target.decode && !target.decode()) {
+                problem = "bad contents in section " + std::to_string(target.entry->id);
+                return false;
+            }
+            return true;
+        });
+        targets.clear();
+        if (!ok) return fail(problem.empty() ? "read failed" : problem);
+        return true;
+    }
+
+private:
+    struct Target {
+        const SectionEntry* entry;
+        void* data;
+        std::function<bool()> decode;
+    };
+
+    std::vector<SectionEntry> table;
+    std::vector<Target> targets;
+    std::string name;
+
+    const SectionEntry* find(uint32_t id) const {
+        for (const auto& entry : table) {
+            if (entry.id == id) return &entry;
+        }
+        return nullptr;
+    }
+
+    bool fail(const std::string& reason) {
+        std::cerr << "❌ " << name << ": " << reason << std::endl;
+        return false;
+    }
+};
+
+// 메타데이터 섹션: 문자열은 u32 길이 + 바이트, 숫자는 고정 폭
+void put_bytes(std::vector<uint8_t>& out, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+void put_string(std::vector<uint8_t>& out, const std::string& value) {
+    uint32_t length = value.size();
+    put_bytes(out, &length, sizeof(length));
+    put_bytes(out, value.data(), value.size());
+}
+
+std::vector<uint8_t> encode_metadata(const IndexMetadata& metadata) {
+    std::vector<uint8_t> out;
+    put_string(out, metadata.creation_time);
+    put_string(out, metadata.hypergraph_filename);
+    put_string(out, metadata.compression_type);
+    int64_t numbers[4] = {metadata.num_nodes, metadata.num_hyperedges, metadata.max_g_level,
+                          (int64_t)metadata.file_size_bytes};
+    put_bytes(out, numbers, sizeof(numbers));
+    put_bytes(out, &metadata.construction_time, sizeof(double));
+    put_bytes(out, &metadata.graph_checksum, sizeof(uint64_t));
+    return out;
+}
+
+bool decode_metadata(const std::vector<uint8_t>& data, IndexMetadata& metadata) {
+    size_t pos = 0;
+    auto get_bytes = [&](void* dst, size_t size) {
+        if (pos + size > data.size()) return false;
+        std::memcpy(dst, data.data() + pos, size);
+        pos += size;
+        return true;
+    };
+    auto get_string = [&](std::string& value) {
+        uint32_t length;
+        if (!get_bytes(&length, sizeof(length)) || pos + length > data.size()) return false;
+        value.assign(reinterpret_cast<const char*>(data.data() + pos), length);
+        pos += length;
+        return true;
+    };
+
+    int64_t numbers[4];
+    if (!get_string(metadata.creation_time) || !get_string(metadata.hypergraph_filename) ||
+        !get_string(metadata.compression_type) || !get_bytes(numbers, sizeof(numbers)) ||
+        !get_bytes(&metadata.construction_time, sizeof(double))) {
+        return false;
+    }
+    metadata.num_nodes = numbers[0];
+    metadata.num_hyperedges = numbers[1];
+    metadata.max_g_level = numbers[2];
+    metadata.file_size_bytes = numbers[3];
+    // 체크섬 이전에 쓴 파일은 여기서 끝남 (0 = 모름)
+    metadata.graph_checksum = 0;
+    if (pos < data.size() && !get_bytes(&metadata.graph_checksum, sizeof(uint64_t))) {
+        return false;
+    }
+    return true;
+}
+
+// 메타데이터 섹션을 읽도록 등록 (metadata가 없으면 건너뜀)
+bool want_metadata(SectionReader& reader, std::vector<uint8_t>& bytes, IndexMetadata* metadata) {
+    if (!metadata) return true;
+    return reader.want(kSectionMeta, bytes, [&bytes, metadata] { return decode_metadata(bytes, *metadata); });
+}
+
+}  // namespace
+
+size_t level_group_padding(size_t position, size_t size) {
+    size_t in_page = position % kPageBytes;
+    if (in_page != 0 && in_page + size > kPageBytes && size >= kPageBytes / 4) {
+        return kPageBytes - in_page;
+    }
+    return 0;
+}
+
+namespace {
+
+// 파일 안의 집합 배치: 저장된 레벨마다 모여 있는 구간(flatten_index의 level_set_begin)을 그대로 두되
+// 페이지 경계에 걸치는 큰 구간(1/4 페이지 이상)은 새 페이지에서 시작 -> 한 g 레벨 쿼리가 건드리는 페이지 수 최소
+// 작은 레벨들은 한 페이지에 같이 두므로 패딩은 집합 크기를 넘지 않음
+struct PagedSets {
+    std::vector<uint8_t> sets;
+    std::vector<uint32_t> level_set_begin;
+    std::vector<FlatIndex::Node> nodes;
+    std::vector<FlatIndex::AuxEntry> aux_entries;
+};
+
+PagedSets page_align_levels(const FlatIndex& index) {
+    PagedSets paged;
+    paged.nodes = index.nodes;
+    paged.aux_entries = index.aux_entries;
+
+    // 구간 경계들 (마지막 구간은 체인 밖 aux 집합들)
+    std::vector<uint32_t> bounds = index.level_set_begin;
+    if (bounds.empty()) bounds.push_back(0);
+    bounds.push_back(index.sets.size());
+
+    std::vector<uint32_t> shift(bounds.size() - 1);
+    for (size_t group = 0; group + 1 < bounds.size(); group++) {
+        size_t size = bounds[group + 1] - bounds[group];
+        paged.sets.resize(paged.sets.size() + level_group_padding(paged.sets.size(), size), 0);
+        shift[group] = paged.sets.size() - bounds[group];
+        paged.level_set_begin.push_back(paged.sets.size());
+        paged.sets.insert(paged.sets.end(), index.sets.begin() + bounds[group], index.sets.begin() + bounds[group + 1]);
+    }
+
+    // 빈 구간과 경계가 겹치면 실제로 집합이 있는 마지막 구간이 선택됨
+    auto relocate = [&](uint32_t& set) {
+        if (set == FlatIndex::kNull) return;
+        size_t group = std::upper_bound(bounds.begin(), bounds.end() - 1, set) - bounds.begin() - 1;
+        set += shift[group];
+    };
+    for (auto& node : paged.nodes) relocate(node.value);
+    for (auto& entry : paged.aux_entries) relocate(entry.set);
+    return paged;
+}
+
+// 평평한 인덱스를 다시 포인터 트리로 (집합은 디코딩해서 정렬된 배열로)
+std::shared_ptr<TreeNode> tree_from_flat(const FlatIndex& index) {
+    auto root = std::make_shared<TreeNode>("root");
+    root->level_runs = index.level_runs;
+
+    std::vector<std::shared_ptr<TreeNode>> nodes(index.nodes.size());
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const auto& flat = index.nodes[n];
+        nodes[n] = std::make_shared<TreeNode>(flat.k == 0 ? "aux" : "");
+        index.decode_into(flat.value, nodes[n]->value);
+        for (uint32_t a = flat.aux_begin; a < flat.aux_end; a++) {
+            const auto& entry = index.aux_entries[a];
+            if (entry.set != FlatIndex::kNull) index.decode_into(entry.set, nodes[n]->aux[entry.i]);
+        }
+    }
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const auto& flat = index.nodes[n];
+        if (flat.next != FlatIndex::kNull) nodes[n]->next = nodes[flat.next];
+        if (flat.jump != FlatIndex::kNull) nodes[n]->jump = nodes[flat.jump];
+    }
+
+    for (int l = 0; l < index.num_stored_levels(); l++) {
+        auto level = std::make_shared<TreeNode>("");
+        for (uint32_t n = index.level_begin[l]; n < index.level_begin[l + 1]; n++) {
+            level->children.push_back(nodes[n]);
+        }
+        level->core_sizes.assign(index.core_sizes.begin() + index.level_begin[l], index.core_sizes.begin() + index.level_begin[l + 1]);
+        root->children.push_back(level);
+    }
+    return root;
+}
+
+}  // namespace
+
+// ============================================================================
+// 평평한 인덱스 / naive 인덱스 저장과 불러오기
+// ============================================================================
+
+bool save_flat_index(const FlatIndex& index, const IndexMetadata& metadata, const std::string& filename) {
+    std::vector<uint8_t> meta = encode_metadata(metadata);
+    std::vector<uint64_t> info = {index.raw_set_bytes};
+
+    // 외부 메모리 구성: 집합들은 이미 레벨 단위로 페이지 정렬해서 파일에 써 둠
+    if (index.streamed_sets) {
+        return write_sections(filename, {
+            section(kSectionMeta, meta),
+            section(kSectionFlatInfo, info),
+            section(kSectionLevelRuns, index.level_runs.first_g),
+            section(kSectionLevelBegin, index.level_begin),
+            section(kSectionLevelSets, index.level_set_begin),
+            section(kSectionCoreSizes, index.core_sizes),
+            section(kSectionNodes, index.nodes),
+            section(kSectionAuxEntries, index.aux_entries),
+        }, index.streamed_sets.get(), kSectionSets);
+    }
+
+    PagedSets paged = page_align_levels(index);
+
+    return write_sections(filename, {
+        section(kSectionMeta, meta),
+        section(kSectionFlatInfo, info),
+        section(kSectionLevelRuns, index.level_runs.first_g),
+        section(kSectionLevelBegin, index.level_begin),
+        section(kSectionLevelSets, paged.level_set_begin),
+        section(kSectionCoreSizes, index.core_sizes),
+        section(kSectionNodes, paged.nodes),
+        section(kSectionAuxEntries, paged.aux_entries),
+        section(kSectionSets, paged.sets, kPageBytes),
+    });
+}
+
+bool load_flat_index(const std::string& filename, FlatIndex& index, IndexMetadata* metadata) {
+    SectionReader reader;
+    if (!reader.open(filename)) return false;
+    if (reader.has(kSectionKRuns)) {
+        std::cerr << "❌ " << filename << ": naive index file, not a flat index" << std::endl;
+        return false;
+    }
+
+    FlatIndex loaded;
+    std::vector<uint8_t> meta;
+    std::vector<uint64_t> info;
+    if (!want_metadata(reader, meta, metadata) ||
+        !reader.want(kSectionFlatInfo, info) ||
+        !reader.want(kSectionLevelRuns, loaded.level_runs.first_g) ||
+        !reader.want(kSectionLevelBegin, loaded.level_begin) ||
+        !reader.want(kSectionLevelSets, loaded.level_set_begin) ||
+        !reader.want(kSectionCoreSizes, loaded.core_sizes) ||
+        !reader.want(kSectionNodes, loaded.nodes) ||
+        !reader.want(kSectionAuxEntries, loaded.aux_entries) ||
+        !reader.want(kSectionSets, loaded.sets) ||
+        !reader.read_all() || info.size() != 1) {
+        return false;
+    }
+    if (loaded.level_begin.empty() || loaded.core_sizes.size() != loaded.level_begin.back() ||
+        loaded.level_begin.back() > loaded.nodes.size()) {
+        std::cerr << "❌ " << filename << ": inconsistent level tables" << std::endl;
+        return false;
+    }
+    loaded.raw_set_bytes = info[0];
+
+    index = std::move(loaded);
+    return true;
+}
+
+bool save_naive_index(const NaiveIndex& index, const IndexMetadata& metadata, const std::string& filename) {
+    std::vector<uint8_t> meta = encode_metadata(metadata);
+    std::vector<uint64_t> info = {index.logical_leaves, index.unique_count, index.referenced};
+
+    std::vector<SectionData> sections = {
+        section(kSectionMeta, meta),
+        section(kSectionNaiveInfo, info),
+        section(kSectionLevelRuns, index.level_runs.first_g),
+        section(kSectionLevelBegin, index.level_begin),
+        section(kSectionLevelMaxK, index.level_max_k),
+        section(kSectionKRuns, index.k_runs),
+    };
+    if (index.arena_stream) {
+        return write_sections(filename, sections, index.arena_stream.get(), kSectionArena);
+    }
+    sections.push_back(section(kSectionArena, index.arena));
+    return write_sections(filename, sections);
+}
+
+bool load_naive_index(const std::string& filename, NaiveIndex& index, IndexMetadata* metadata) {
+    SectionReader reader;
+    if (!reader.open(filename)) return false;
+
+    NaiveIndex loaded;
+    std::vector<uint8_t> meta;
+    std::vector<uint64_t> info;
+    if (!want_metadata(reader, meta, metadata) ||
+        !reader.want(kSectionNaiveInfo, info) ||
+        !reader.want(kSectionLevelRuns, loaded.level_runs.first_g) ||
+        !reader.want(kSectionLevelBegin, loaded.level_begin) ||
+        !reader.want(kSectionLevelMaxK, loaded.level_max_k) ||
+        !reader.want(kSectionKRuns, loaded.k_runs) ||
+        !reader.want(kSectionArena, loaded.arena) ||
+        !reader.read_all() || info.size() != 3) {
+        return false;
+    }
+    loaded.logical_leaves = info[0];
+    loaded.unique_count = info[1];
+    loaded.referenced = info[2];
+
+    index = std::move(loaded);
+    return true;
+}
+
+bool read_index_metadata(const std::string& filename, IndexMetadata& metadata) {
+    SectionReader reader;
+    std::vector<uint8_t> meta;
+    return reader.open(filename) && want_metadata(reader, meta, &metadata) && reader.read_all();
+}
+
+// ============================================================================
+// 구성 중 인덱스 파일에 바로 쓰는 섹션
+// ============================================================================
+
+namespace {
+constexpr size_t kStreamBufferBytes = 1 << 20;
+}
+
+SectionStream::~SectionStream() {
+    if (fd < 0) return;
+    close(fd);
+    if (!committed) std::remove((filename + ".tmp").c_str());
+}
+
+bool SectionStream::open(const std::string& target) {
+    filename = target;
+    std::string temp = filename + ".tmp";
+    fd = ::open(temp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "❌ Cannot open " << temp << " for writing" << std::endl;
+        return false;
+    }
+    buffer.reserve(kStreamBufferBytes);
+    return true;
+}
+
+bool SectionStream::append(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        size_t take = std::min(size, kStreamBufferBytes - buffer.size());
+        buffer.insert(buffer.end(), bytes, bytes + take);
+        bytes += take;
+        size -= take;
+        if (buffer.size() == kStreamBufferBytes && !flush()) return false;
+    }
+    return !error;
+}
+
+bool SectionStream::pad(size_t size) {
+    static const uint8_t zeros[kPageBytes] = {};
+    for (; size > kPageBytes; size -= kPageBytes) {
+        if (!append(zeros, kPageBytes)) return false;
+    }
+    return append(zeros, size);
+}
+
+bool SectionStream::flush() {
+    if (error || fd < 0) return false;
+    if (!buffer.empty()) {
+        if (!write_all(fd, buffer.data(), buffer.size(), kStart + written)) {
+            std::cerr << "❌ Failed writing " << filename << ".tmp" << std::endl;
+            error = true;
+            return false;
+        }
+        written += buffer.size();
+        buffer.clear();
+    }
+    return true;
+}
+
+bool SectionStream::read(uint64_t position, void* out, size_t size) {
+    if (position + size > written && !flush()) return false;
+    char* dest = static_cast<char*>(out);
+    while (size > 0) {
+        ssize_t got = pread(fd, dest, size, kStart + position);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        dest += got;
+        size -= got;
+        position += got;
+    }
+    return true;
+}
+
+// ============================================================================
+// 하이퍼그래프 스냅샷
+// ============================================================================
+
+bool save_hypergraph_snapshot(const Hypergraph& hypergraph, const std::string& filename) {
+    // 하이퍼엣지들을 약 kEdgeBlockWords 단위 블록으로 (블록마다 따로 디코딩할 수 있게)
+    std::vector<std::vector<uint32_t>> blocks;
+    std::vector<uint32_t> sizes, nodes;
+    auto flush = [&] {
+        if (sizes.empty()) return;
+        std::vector<uint32_t> block;
+        block.reserve(1 + sizes.size() + nodes.size());
+        block.push_back(sizes.size());
+        block.insert(block.end(), sizes.begin(), sizes.end());
+        block.insert(block.end(), nodes.begin(), nodes.end());
+        blocks.push_back(std::move(block));
+        sizes.clear();
+        nodes.clear();
+    };
+    for (const auto& edge : hypergraph.E) {
+        std::vector<int> sorted(edge.begin(), edge.end());
+        std::sort(sorted.begin(), sorted.end());
+        sizes.push_back(sorted.size());
+        nodes.insert(nodes.end(), sorted.begin(), sorted.end());
+        if (sizes.size() + nodes.size() >= kEdgeBlockWords) flush();
+    }
+    flush();
+
+    std::vector<int> reps;
+    for (const auto& group : hypergraph.twins) reps.push_back(group.first);
+    std::sort(reps.begin(), reps.end());
+    std::vector<int32_t> twins;
+    for (int rep : reps) {
+        const auto& members = hypergraph.twins.at(rep);
+        twins.push_back(rep);
+        twins.push_back(members.size());
+        twins.insert(twins.end(), members.begin(), members.end());
+    }
+
+    std::vector<uint64_t> info = {hypergraph.E.size(), blocks.size()};
+    std::vector<SectionData> sections = {
+        section(kSectionGraphInfo, info),
+        section(kSectionTwins, twins),
+        section(kSectionOriginalIds, hypergraph.original_ids),
+    };
+    for (const auto& block : blocks) {
+        sections.push_back(section(kSectionEdgeBlock, block));
+    }
+    return write_sections(filename, sections);
+}
+
+bool load_hypergraph_snapshot(const std::string& filename, Hypergraph& hypergraph) {
+    SectionReader reader;
+    if (!reader.open(filename)) return false;
+    if (!reader.has(kSectionGraphInfo)) {
+        std::cerr << "❌ " << filename << ": not a hypergraph snapshot" << std::endl;
+        return false;
+    }
+
+    std::vector<const SectionEntry*> entries = reader.all(kSectionEdgeBlock);
+    std::vector<std::vector<uint32_t>> words(entries.size());
+    std::vector<std::vector<std::unordered_set<int>>> edges(entries.size());
+
+    // 블록이 도착하면 바로 하이퍼엣지 집합들을 만듦 (나머지 블록은 아직 읽는 중)
+    auto decode_block = [&](size_t b) {
+        const std::vector<uint32_t>& block = words[b];
+        if (block.empty() || 1 + (size_t)block[0] > block.size()) return false;
+        size_t count = block[0];
+        size_t pos = 1 + count;
+        edges[b].reserve(count);
+        for (size_t e = 0; e < count; e++) {
+            size_t size = block[1 + e];
+            if (pos + size > block.size()) return false;
+            edges[b].emplace_back(block.begin() + pos, block.begin() + pos + size);
+            pos += size;
+        }
+        words[b] = std::vector<uint32_t>();
+        return true;
+    };
+
+    Hypergraph loaded;
+    std::vector<uint64_t> info;
+    std::vector<int32_t> twins;
+    if (!reader.want(kSectionGraphInfo, info) ||
+        !reader.want(kSectionTwins, twins) ||
+        !reader.want(kSectionOriginalIds, loaded.original_ids)) {
+        return false;
+    }
+    for (size_t b = 0; b < entries.size(); b++) {
+        if (!reader.want(*entries[b], words[b], [&decode_block, b] { return decode_block(b); })) return false;
+    }
+    if (!reader.read_all() || info.size() != 2 || info[1] != entries.size()) {
+        return false;
+    }
+
+    // 노드별 하이퍼엣지 목록은 차수만큼 미리 잡아 재할당 없이 채움
+    std::unordered_map<int, size_t> degree;
+    for (const auto& block : edges) {
+        for (const auto& edge : block) {
+            for (int node : edge) degree[node]++;
+        }
+    }
+    loaded.E.reserve(info[0]);
+    loaded.node_hyperedges.reserve(degree.size());
+    for (const auto& entry : degree) {
+        loaded.node_hyperedges[entry.first].reserve(entry.second);
+    }
+    for (auto& block : edges) {
+        for (const auto& edge : block) {
+            loaded.add_hyperedge(edge);
+        }
+        block = std::vector<std::unordered_set<int>>();
+    }
+    if (loaded.E.size() != info[0]) {
+        std::cerr << "❌ " << filename << ": expected " << info[0] << " hyperedges, found " << loaded.E.size() << std::endl;
+        return false;
+    }
+    for (size_t pos = 0; pos + 2 <= twins.size();) {
+        int rep = twins[pos];
+        size_t count = twins[pos + 1];
+        if (pos + 2 + count > twins.size()) break;
+        loaded.twins[rep].assign(twins.begin() + pos + 2, twins.begin() + pos + 2 + count);
+        pos += 2 + count;
+    }
+
+    hypergraph = std::move(loaded);
+    return true;
+}
+
+uint64_t hypergraph_checksum(const Hypergraph& hypergraph) {
+    // 하이퍼엣지마다 정렬된 노드로 해시를 만들어 더함 (순서 무관)
+    auto mix = [](uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return x;
+    };
+    uint64_t sum = hypergraph.E.size();
+    std::vector<int> sorted;
+    for (const auto& hyperedge : hypergraph.E) {
+        sorted.assign(hyperedge.begin(), hyperedge.end());
+        std::sort(sorted.begin(), sorted.end());
+        sum += mix(section_checksum(sorted.data(), sorted.size() * sizeof(int)));
+    }
+    for (const auto& [rep, members] : hypergraph.twins) {
+        sum += mix(((uint64_t)rep << 32 | members.size()) ^ 0x7477696e73ULL);
+    }
+    return mix(sum) ^ section_checksum(hypergraph.original_ids.data(), hypergraph.original_ids.size() * sizeof(int));
+}
+
+// ============================================================================
+// g 레벨 체크포인트
+// ============================================================================
+//
+// [헤더: magic "KGCKPT\0\0", 버전 u32, 첫 g u32, 입력 체크섬 u64]
+// 레벨마다 [g u32, 집합 수 u32, 본문 크기 u64, 본문 체크섬 u64][본문: 집합마다 인코딩 길이 u32 + DeltaVarint 인코딩]
+
+namespace {
+
+constexpr char kCheckpointMagic[8] = {'K', 'G', 'C', 'K', 'P', 'T', '\0', '\0'};
+constexpr uint32_t kCheckpointVersion = 1;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t first_g;
+    uint64_t input_checksum;
+};
+
+struct LevelRecord {
+    uint32_t g;
+    uint32_t num_sets;
+    uint64_t payload_bytes;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(CheckpointHeader) == 24, "unexpected checkpoint header layout");
+static_assert(sizeof(LevelRecord) == 24, "unexpected level record layout");
+
+bool read_exact(int fd, void* out, size_t size, uint64_t offset) {
+    char* dest = static_cast<char*>(out);
+    while (size > 0) {
+        ssize_t got = pread(fd, dest, size, offset);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        dest += got;
+        size -= got;
+        offset += got;
+    }
+    return true;
+}
+
+}  // namespace
+
+LevelCheckpoint::~LevelCheckpoint() {
+    if (fd >= 0) close(fd);
+}
+
+bool LevelCheckpoint::open(const std::string& target, uint64_t input_checksum, bool resume, int first) {
+    filename = target;
+    first_g = first;
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        std::cerr << "❌ Cannot open checkpoint " << filename << std::endl;
+        return false;
+    }
+
+    // 기존 기록 확인: 헤더가 맞으면 체크섬이 맞는 연속된 레벨까지만 인정
+    CheckpointHeader header;
+    records.clear();
+    end = 0;
+    if (resume && read_exact(fd, &header, sizeof(header), 0)) {
+        if (std::memcmp(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) != 0 ||
+            header.version != kCheckpointVersion) {
+            std::cout << "   ⚠️  " << filename << " is not a checkpoint, starting over" << std::endl;
+        } else if (header.input_checksum != input_checksum || header.first_g != (uint32_t)first_g) {
+            std::cout << "   ⚠️  " << filename << " was written for a different hypergraph, starting over" << std::endl;
+        } else {
+            // 끊긴 헤더의 payload_bytes는 믿을 수 없으므로 파일 크기를 넘으면 체크섬이 틀린 것처럼 거기서 멈춤
+            struct stat info;
+            uint64_t file_size = fstat(fd, &info) == 0 ? (uint64_t)info.st_size : 0;
+            end = sizeof(header);
+            std::vector<uint8_t> payload;
+            LevelRecord record;
+            while (read_exact(fd, &record, sizeof(record), end) && record.g == first_g + records.size()) {
+                if (end + sizeof(record) > file_size || record.payload_bytes > file_size - end - sizeof(record)) break;
+                payload.resize(record.payload_bytes);
+                if (!read_exact(fd, payload.data(), payload.size(), end + sizeof(record)) ||
+                    section_checksum(payload.data(), payload.size()) != record.checksum) {
+                    break;
+                }
+                records.push_back(end);
+                end += sizeof(record) + record.payload_bytes;
+            }
+        }
+    }
+
+    if (end == 0) {
+        std::memcpy(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic));
+        header.version = kCheckpointVersion;
+        header.first_g = first_g;
+        header.input_checksum = input_checksum;
+        if (!write_all(fd, &header, sizeof(header), 0)) return false;
+        end = sizeof(header);
+    }
+    // 끊긴 기록이 남아 있으면 잘라냄
+    return ftruncate(fd, end) == 0;
+}
+
+bool LevelCheckpoint::read_level(int g, std::vector<std::unordered_set<int>>& level) {
+    if (g < first_g || g >= first_g + completed()) return false;
+    uint64_t offset = records[g - first_g];
+    LevelRecord record;
+    if (!read_exact(fd, &record, sizeof(record), offset)) return false;
+    std::vector<uint8_t> payload(record.payload_bytes);
+    if (!read_exact(fd, payload.data(), payload.size(), offset + sizeof(record))) return false;
+
+    level.assign(record.num_sets, std::unordered_set<int>());
+    size_t pos = 0;
+    for (auto& set : level) {
+        uint32_t bytes;
+        if (pos + sizeof(bytes) > payload.size()) return false;
+        std::memcpy(&bytes, payload.data() + pos, sizeof(bytes));
+        pos += sizeof(bytes);
+        if (pos + bytes > payload.size()) return false;
+        set.reserve(encoded_set_size(payload.data() + pos));
+        decode_sorted_set(payload.data() + pos, set);
+        pos += bytes;
+    }
+    return true;
+}
+
+bool LevelCheckpoint::append_level(int g, const std::vector<std::unordered_set<int>>& level) {
+    if (fd < 0 || g != first_g + completed()) return false;
+
+    std::vector<uint8_t> payload;
+    std::vector<int> sorted;
+    for (const auto& set : level) {
+        sorted.assign(set.begin(), set.end());
+        std::sort(sorted.begin(), sorted.end());
+        size_t at = payload.size();
+        payload.resize(at + sizeof(uint32_t));
+        encode_sorted_set(sorted.data(), sorted.data() + sorted.size(), SetCodec::DeltaVarint, payload);
+        uint32_t bytes = payload.size() - at - sizeof(uint32_t);
+        std::memcpy(payload.data() + at, &bytes, sizeof(bytes));
+    }
+
+    LevelRecord record = {(uint32_t)g, (uint32_t)level.size(), payload.size(), section_checksum(payload.data(), payload.size())};
+    // 동기화까지 끝나야 기록으로 인정 (쓰다 끊기면 다음 open이 체크섬으로 걸러냄)
+    if (!write_all(fd, &record, sizeof(record), end) ||
+        !write_all(fd, payload.data(), payload.size(), end + sizeof(record)) ||
+        fdatasync(fd) != 0) {
+        std::cerr << "❌ Failed writing checkpoint " << filename << std::endl;
+        return false;
+    }
+    records.push_back(end);
+    end += sizeof(record) + payload.size();
+    return true;
+}
+
+void LevelCheckpoint::remove() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+    std::remove(filename.c_str());
+    records.clear();
+}
+
+// ============================================================================
+// mmap 서빙
+// ============================================================================
+
+namespace {
+
+int madvise_flag(MapAdvice advice) {
+    switch (advice) {
+        case MapAdvice::Random: return MADV_RANDOM;
+        case MapAdvice::Sequential: return MADV_SEQUENTIAL;
+        case MapAdvice::WillNeed: return MADV_WILLNEED;
+        default: return MADV_NORMAL;
+    }
+}
+
+// [begin, end)를 덮는 페이지들에 madvise
+void advise_range(const uint8_t* begin, const uint8_t* end, int flag) {
+    static const uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t first = reinterpret_cast<uintptr_t>(begin) / page * page;
+    if (end > begin) {
+        madvise(reinterpret_cast<void*>(first), reinterpret_cast<uintptr_t>(end) - first, flag);
+    }
+}
+
+}  // namespace
+
+bool parse_map_advice(const std::string& name, MapAdvice& advice) {
+    if (name == "normal") advice = MapAdvice::Normal;
+    else if (name == "random") advice = MapAdvice::Random;
+    else if (name == "sequential") advice = MapAdvice::Sequential;
+    else if (name == "willneed") advice = MapAdvice::WillNeed;
+    else return false;
+    return true;
+}
+
+bool MappedIndex::open(const std::string& filename, const MapOptions& options) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "❌ Cannot open " << filename << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(FileHeader)) {
+        std::cerr << "❌ " << filename << ": truncated header" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "❌ Cannot mmap " << filename << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    base = mapped;
+    length = info.st_size;
+    // 헤더를 읽기 전에 힌트를 줘야 첫 페이지 폴트의 미리 읽기가 파일 전체를 끌어오지 않음
+    madvise(base, length, madvise_flag(options.advice));
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(base);
+    FileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (!check_header(header, length, filename) ||
+        sizeof(FileHeader) + (uint64_t)header.num_sections * sizeof(SectionEntry) > length) {
+        close();
+        return false;
+    }
+    const SectionEntry* table = reinterpret_cast<const SectionEntry*>(bytes + sizeof(FileHeader));
+
+    // 구조만 확인 (체크섬은 옵션: 확인하면 파일 전체가 페이지 인됨)
+    std::string problem;
+    auto find = [&](uint32_t id) -> const SectionEntry* {
+        for (uint32_t i = 0; i < header.num_sections; i++) {
+            if (table[i].id == id) return &table[i];
+        }
+        return nullptr;
+    };
+    auto view_of = [&](uint32_t id, auto& view) {
+        using T = typename std::remove_reference_t<decltype(view)>::value_type;
+        const SectionEntry* entry = find(id);
+        if (!entry) {
+            problem = "missing section " + std::to_string(id);
+        } else if (entry->offset + entry->size > length || entry->size % sizeof(T) != 0 || entry->offset % alignof(T) != 0) {
+            problem = "bad bounds for section " + std::to_string(id);
+        } else if (options.verify_checksums && section_checksum(bytes + entry->offset, entry->size) != entry->checksum) {
+            problem = "checksum mismatch in section " + std::to_string(id);
+        } else {
+            view = std::remove_reference_t<decltype(view)>(reinterpret_cast<const T*>(bytes + entry->offset), entry->size / sizeof(T));
+            return true;
+        }
+        return false;
+    };
+
+    ArrayView<uint8_t> meta_bytes;
+    if (find(kSectionKRuns)) {
+        problem = "naive index file, not a flat index";
+    } else if (view_of(kSectionMeta, meta_bytes) && view_of(kSectionLevelRuns, index.first_g) &&
+               view_of(kSectionLevelBegin, index.level_begin) && view_of(kSectionLevelSets, level_set_begin) &&
+               view_of(kSectionCoreSizes, index.core_sizes) &&
+               view_of(kSectionNodes, index.nodes) && view_of(kSectionAuxEntries, index.aux_entries) &&
+               view_of(kSectionSets, index.sets)) {
+        if (!decode_metadata(std::vector<uint8_t>(meta_bytes.begin(), meta_bytes.end()), meta)) {
+            problem = "bad metadata";
+        } else if (index.first_g.size() != index.level_begin.size() ||
+                   (!index.level_begin.empty() && index.level_begin[index.level_begin.size() - 1] > index.nodes.size()) ||
+                   level_set_begin.size() != index.level_begin.size() ||
+                   index.core_sizes.size() != (index.level_begin.empty() ? 0 : index.level_begin[index.level_begin.size() - 1])) {
+            problem = "inconsistent level tables";
+        }
+    }
+    if (!problem.empty()) {
+        std::cerr << "❌ " << filename << ": " << problem << std::endl;
+        close();
+        return false;
+    }
+
+    if (options.huge_pages) {
+#ifdef MADV_HUGEPAGE
+        advise_range(index.sets.begin(), index.sets.end(), MADV_HUGEPAGE);
+#endif
+    }
+    return true;
+}
+
+void MappedIndex::close() {
+    if (base) {
+        munmap(base, length);
+    }
+    base = nullptr;
+    length = 0;
+    index = FlatIndexView();
+    level_set_begin = ArrayView<uint32_t>();
+}
+
+void MappedIndex::advise_level(int g, MapAdvice advice) const {
+    int l = index.level_of(g);
+    if (l < 0) return;
+    advise_range(index.sets.data() + level_set_begin[l], index.sets.data() + level_set_begin[l + 1], madvise_flag(advice));
+}
+
+size_t MappedIndex::resident_bytes() const {
+    if (!base) return 0;
+    size_t page = sysconf(_SC_PAGESIZE);
+    std::vector<unsigned char> pages((length + page - 1) / page);
+    if (mincore(base, length, pages.data()) != 0) return 0;
+    size_t resident = 0;
+    for (unsigned char state : pages) {
+        if (state & 1) resident++;
+    }
+    return std::min(resident * page, length);
+}
+
+// ============================================================================
+// 포인터 트리 저장과 불러오기 (평평한 형식을 거침)
+// ============================================================================
 
-// 임시 구현들 - 일단 컴파일이 되도록
 bool save_index_to_file(const std::shared_ptr<TreeNode>& tree, const std::string& filename, const std::string& index_type) {
-    std::cout << "Saving index to " << filename << " (not implemented yet)" << std::endl;
-    return true;  // 임시로 성공 반환
+    IndexMetadata metadata;
+    metadata.creation_time = get_current_time_string();
+    metadata.compression_type = index_type;
+    metadata.max_g_level = tree_max_g(tree);
+
+    std::cout << "💾 Saving index to " << filename << std::endl;
+    return save_flat_index(flatten_index(tree), metadata, filename);
 }
 
 std::shared_ptr<TreeNode> load_index_from_file(const std::string& filename, const std::string& index_type) {
-    std::cout << "Loading index from " << filename << " (not implemented yet)" << std::endl;
-    return std::make_shared<TreeNode>("loaded_root");  // 임시로 빈 트리 반환
+    FlatIndex index;
+    IndexMetadata metadata;
+    if (!load_flat_index(filename, index, &metadata)) {
+        return nullptr;
+    }
+    if (index_type != "binary" && index_type != metadata.compression_type) {
+        std::cerr << "⚠️  " << filename << " holds a " << metadata.compression_type
+                  << " index, not " << index_type << std::endl;
+    }
+
+    std::cout << "📂 Loaded " << metadata.compression_type << " index from " << filename << std::endl;
+    return tree_from_flat(index);
 }
 
+// 링크 없이 만든 트리의 레벨마다 k 순서로 next 체인을 다시 연결 (불러온 트리는 이미 연결됨)
 void reconstruct_pointers(std::shared_ptr<TreeNode>& tree) {
-    std::cout << "Reconstructing pointers (not implemented yet)" << std::endl;
+    if (!tree) return;
+    for (auto& level : tree->children) {
+        for (size_t k = 0; k + 1 < level->children.size(); k++) {
+            if (!level->children[k]->next) {
+                level->children[k]->next = level->children[k + 1];
+            }
+        }
+    }
 }
 
 bool save_index_to_json(const std::shared_ptr<TreeNode>& tree, const std::string& filename) {
@@ -30,25 +1189,57 @@ bool save_index_to_text(const std::shared_ptr<TreeNode>& tree, const std::string
     return true;
 }
 
+// 메타데이터 파일은 "key: value" 줄들 (사람이 읽을 수 있게)
 bool save_metadata(const IndexMetadata& metadata, const std::string& filename) {
-    std::cout << "Saving metadata to " << filename << " (not implemented yet)" << std::endl;
-    return true;
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "❌ Cannot open " << filename << " for writing" << std::endl;
+        return false;
+    }
+    out << "creation_time: " << metadata.creation_time << "\n"
+        << "hypergraph_filename: " << metadata.hypergraph_filename << "\n"
+        << "compression_type: " << metadata.compression_type << "\n"
+        << "num_nodes: " << metadata.num_nodes << "\n"
+        << "num_hyperedges: " << metadata.num_hyperedges << "\n"
+        << "max_g_level: " << metadata.max_g_level << "\n"
+        << "construction_time: " << std::setprecision(17) << metadata.construction_time << "\n"
+        << "file_size_bytes: " << metadata.file_size_bytes << "\n"
+        << "graph_checksum: " << metadata.graph_checksum << "\n";
+    return (bool)out;
 }
 
 IndexMetadata load_metadata(const std::string& filename) {
-    std::cout << "Loading metadata from " << filename << " (not implemented yet)" << std::endl;
     IndexMetadata metadata;
     metadata.creation_time = "unknown";
     metadata.compression_type = "unknown";
-    metadata.construction_time = 0.0;
-    metadata.file_size_bytes = 0;
-    metadata.num_nodes = 0;
-    metadata.num_hyperedges = 0;
-    metadata.max_g_level = 0;
+
+    std::ifstream in(filename);
+    if (!in) {
+        std::cerr << "⚠️  Cannot open metadata " << filename << std::endl;
+        return metadata;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t colon = line.find(": ");
+        if (colon == std::string::npos) continue;
+        std::string key = line.substr(0, colon);
+        std::string value = line.substr(colon + 2);
+
+        if (key == "creation_time") metadata.creation_time = value;
+        else if (key == "hypergraph_filename") metadata.hypergraph_filename = value;
+        else if (key == "compression_type") metadata.compression_type = value;
+        else if (key == "num_nodes") metadata.num_nodes = std::stoi(value);
+        else if (key == "num_hyperedges") metadata.num_hyperedges = std::stoi(value);
+        else if (key == "max_g_level") metadata.max_g_level = std::stoi(value);
+        else if (key == "construction_time") metadata.construction_time = std::stod(value);
+        else if (key == "file_size_bytes") metadata.file_size_bytes = std::stoull(value);
+        else if (key == "graph_checksum") metadata.graph_checksum = std::stoull(value);
+    }
     return metadata;
 }
 
-void log_construction_result(const std::string& index_type, 
+void log_construction_result(const std::string& index_type,
                            double construction_time,
                            int tree_nodes,
                            int vertices_in_index,
@@ -64,18 +1255,63 @@ void log_query_result(const std::string& index_type,
 }
 
 std::string get_current_time_string() {
-    return "2024-01-01 00:00:00";  // 임시
+    std::time_t now = std::time(nullptr);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+    return buffer;
 }
 
 size_t get_file_size(const std::string& filename) {
-    return 1024;  // 임시로 1KB 반환
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) return 0;
+    return info.st_size;
+}
+
+// /proc/self/status의 한 항목 (kB)
+static size_t read_status_kb(const std::string& key) {
+    std::ifstream file("/proc/self/status");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            std::istringstream iss(line.substr(key.size()));
+            size_t memory_kb = 0;
+            iss >> memory_kb;
+            return memory_kb;
+        }
+    }
+    return 0;
+}
+
+size_t get_memory_usage_kb() {
+    return read_status_kb("VmRSS:");
 }
 
-bool save_complete_index(const std::shared_ptr<TreeNode>& tree, 
+size_t get_peak_memory_usage_kb() {
+    return read_status_kb("VmHWM:");
+}
+
+// base_filename.kgi (인덱스) + base_filename.meta (메타데이터)
+bool save_complete_index(const std::shared_ptr<TreeNode>& tree,
                         const std::string& base_filename,
                         const std::string& compression_type,
                         const Hypergraph& hypergraph,
                         double construction_time) {
-    std::cout << "Saving complete index " << base_filename << " (not implemented yet)" << std::endl;
-    return true;  // 임시로 성공 반환
-}
\ No newline at end of file
+    IndexMetadata metadata;
+    metadata.creation_time = get_current_time_string();
+    metadata.compression_type = compression_type;
+    metadata.num_nodes = hypergraph.total_weight();
+    metadata.num_hyperedges = hypergraph.E.size();
+    metadata.max_g_level = tree_max_g(tree);
+    metadata.construction_time = construction_time;
+    metadata.graph_checksum = hypergraph_checksum(hypergraph);
+
+    std::string index_file = base_filename + ".kgi";
+    if (!save_flat_index(flatten_index(tree), metadata, index_file)) {
+        return false;
+    }
+    metadata.file_size_bytes = get_file_size(index_file);
+
+    std::cout << "💾 Saved " << compression_type << " index to " << index_file << " ("
+              << metadata.file_size_bytes << " bytes)" << std::endl;
+    return save_metadata(metadata, base_filename + ".meta");
+}
@@ -0,0 +1,329 @@
+#include "kg_index.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// ============================================================================
+// 작업 훔치기 태스크 런타임
+// ============================================================================
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 현재 스레드의 워커 번호 (런타임 밖의 스레드는 -1 → 워커 0의 deque를 씀)
+thread_local int t_worker_id = -1;
+
+// 태스크 중첩 깊이와 join 대기 시간 (바깥 태스크의 busy 시간에서 빼기 위함)
+thread_local int t_task_depth = 0;
+thread_local long long t_join_wait_ns = 0;
+
+long long elapsed_ns(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+struct TaskRuntime::Impl {
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+        std::atomic<int> size{0};
+
+        // 통계
+        std::atomic<long long> busy_ns{0};
+        std::atomic<long long> tasks_run{0};
+        std::atomic<long long> steals{0};
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    // 잠들기/깨우기: 잠드는 쪽은 sleep_lock 안에서 sleepers를 올린 뒤 조건을 보고 기한 없이 wait,
+    // 깨우는 쪽은 조건(queued, pending, stopping)을 먼저 바꾸고 sleepers를 본 다음 sleep_lock을 거쳐 notify
+    // 둘 다 seq_cst라 "조건을 못 봄"과 "sleepers를 못 봄"이 동시에 일어날 수 없으므로 깨움을 놓치지 않음
+    std::atomic<int> queued{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<int> sleepers{0};
+
+    Clock::time_point stats_start = Clock::now();
+
+    // ready()가 참이 될 때까지 잠듦 (ready는 sleep_lock 안에서 평가)
+    template <typename Ready>
+    void sleep_until(Ready&& ready) {
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        sleepers.fetch_add(1);
+        wake.wait(guard, ready);
+        sleepers.fetch_sub(1);
+    }
+
+    // 조건을 바꾼 뒤 호출: 잠든 스레드가 있을 때만 잠금을 거쳐 알림
+    void wake_sleepers(bool all) {
+        if (sleepers.load() == 0) return;
+        { std::lock_guard<std::mutex> guard(sleep_lock); }
+        if (all) {
+            wake.notify_all();
+        } else {
+            wake.notify_one();
+        }
+    }
+
+    int self() const {
+        return t_worker_id < 0 ? 0 : t_worker_id;
+    }
+
+    // 자기 deque는 뒤에서, 없으면 다른 워커 deque의 앞에서 훔침
+    bool take(std::function<void()>& task) {
+        if (queued.load(std::memory_order_acquire) == 0) return false;
+
+        int id = self();
+        int n = workers.size();
+        for (int i = 0; i < n; i++) {
+            int victim = (id + i) % n;
+            Worker& w = *workers[victim];
+            if (w.size.load(std::memory_order_relaxed) == 0) continue;
+
+            std::lock_guard<std::mutex> guard(w.lock);
+            if (w.tasks.empty()) continue;
+            if (i == 0) {
+                task = std::move(w.tasks.back());
+                w.tasks.pop_back();
+            } else {
+                task = std::move(w.tasks.front());
+                w.tasks.pop_front();
+                workers[id]->steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            w.size.fetch_sub(1, std::memory_order_relaxed);
+            queued.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+        return false;
+    }
+
+    // 가장 바깥 태스크만 시간을 재고, 안에서 join을 기다린 시간은 뺌
+    void execute(const std::function<void()>& task) {
+        Worker& w = *workers[self()];
+        w.tasks_run.fetch_add(1, std::memory_order_relaxed);
+
+        struct DepthGuard {
+            DepthGuard() { t_task_depth++; }
+            ~DepthGuard() { t_task_depth--; }
+        };
+
+        if (t_task_depth > 0) {
+            DepthGuard guard;
+            task();
+            return;
+        }
+
+        auto start = Clock::now();
+        t_join_wait_ns = 0;
+        {
+            DepthGuard guard;
+            task();
+        }
+        w.busy_ns.fetch_add(std::max(0LL, elapsed_ns(start) - t_join_wait_ns), std::memory_order_relaxed);
+    }
+
+    void worker_loop(int id) {
+        t_worker_id = id;
+        std::function<void()> task;
+        while (!stopping.load(std::memory_order_acquire)) {
+            if (take(task)) {
+                execute(task);
+                task = nullptr;
+                continue;
+            }
+
+            // 할 일이 없으면 submit이나 종료가 깨울 때까지 잠듦
+            sleep_until([&] { return stopping.load() || queued.load() > 0; });
+        }
+    }
+};
+
+TaskRuntime::TaskRuntime(int num_threads) : impl(new Impl()) {
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        impl->workers.push_back(std::make_unique<Impl::Worker>());
+    }
+
+    // 생성한 스레드가 워커 0
+    t_worker_id = 0;
+    for (int i = 1; i < num_threads; i++) {
+        impl->threads.emplace_back([this, i] { impl->worker_loop(i); });
+    }
+}
+
+TaskRuntime::~TaskRuntime() {
+    impl->stopping.store(true);
+    { std::lock_guard<std::mutex> guard(impl->sleep_lock); }
+    impl->wake.notify_all();
+    for (auto& thread : impl->threads) {
+        thread.join();
+    }
+}
+
+int TaskRuntime::num_workers() const {
+    return impl->workers.size();
+}
+
+void TaskRuntime::submit(std::function<void()> task) {
+    Impl::Worker& w = *impl->workers[impl->self()];
+    {
+        std::lock_guard<std::mutex> guard(w.lock);
+        w.tasks.push_back(std::move(task));
+        w.size.fetch_add(1, std::memory_order_relaxed);
+    }
+    impl->queued.fetch_add(1);
+    impl->wake_sleepers(false);
+}
+
+bool TaskRuntime::run_one() {
+    std::function<void()> task;
+    if (!impl->take(task)) return false;
+    impl->execute(task);
+    return true;
+}
+
+void TaskRuntime::park(const std::atomic<int>& pending) {
+    impl->sleep_until([&] {
+        return pending.load() == 0 || impl->queued.load() > 0 || impl->stopping.load();
+    });
+}
+
+void TaskRuntime::notify_idle() {
+    // 어느 묶음을 기다리는 스레드인지 모르므로 모두 깨워 각자 조건을 다시 봄
+    impl->wake_sleepers(true);
+}
+
+void TaskRuntime::parallel_for(int begin, int end, const std::function<void(int, int)>& body, int grain) {
+    if (end <= begin) return;
+
+    int n = end - begin;
+    int workers = num_workers();
+    if (grain <= 0) {
+        grain = std::max(1, n / (workers * 8));
+    }
+
+    if (workers == 1 || n <= grain) {
+        impl->execute([&] { body(begin, end); });
+        return;
+    }
+
+    TaskGroup group(*this);
+
+    // lazy binary splitting: 훔쳐갈 일이 남아 있지 않을 때만 남은 범위의 절반을 내놓고,
+    // 그 외에는 grain 조각씩 직접 처리
+    std::function<void(int, int)> run_range = [&](int b, int e) {
+        while (e - b > grain) {
+            if (impl->queued.load(std::memory_order_relaxed) > 0) {
+                body(b, b + grain);
+                b += grain;
+                continue;
+            }
+            int mid = b + (e - b) / 2;
+            group.run([&run_range, mid, e] { run_range(mid, e); });
+            e = mid;
+        }
+        body(b, e);
+    };
+
+    impl->execute([&] { run_range(begin, end); });
+    group.wait();
+}
+
+void TaskRuntime::reset_stats() {
+    for (auto& w : impl->workers) {
+        w->busy_ns = 0;
+        w->tasks_run = 0;
+        w->steals = 0;
+    }
+    impl->stats_start = Clock::now();
+}
+
+void TaskRuntime::print_utilization(const std::string& label) const {
+    double wall = elapsed_ns(impl->stats_start) / 1e9;
+    int workers = num_workers();
+
+    std::cout << "\n🧵 Worker utilization (" << label << ", " << workers << " threads, "
+              << std::fixed << std::setprecision(3) << wall << "s wall):" << std::endl;
+
+    double total_busy = 0.0;
+    for (int i = 0; i < workers; i++) {
+        const auto& w = *impl->workers[i];
+        double busy = w.busy_ns.load() / 1e9;
+        total_busy += busy;
+        std::cout << "   worker " << i << ": " << std::setprecision(1)
+                  << (wall > 0 ? busy / wall * 100 : 0.0) << "% busy (" << std::setprecision(3) << busy << "s), "
+                  << w.tasks_run.load() << " tasks, " << w.steals.load() << " steals" << std::endl;
+    }
+    std::cout << "   average: " << std::setprecision(1)
+              << (wall > 0 ? total_busy / (wall * workers) * 100 : 0.0) << "%" << std::endl;
+}
+
+TaskGroup::~TaskGroup() {
+    // 예외로 빠져나가는 경우에도 참조하는 태스크가 끝날 때까지 기다림
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!runtime.run_one()) runtime.park(pending);
+    }
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    pending.fetch_add(1);
+    // 마지막 태스크가 pending을 0으로 만들면 wait 쪽이 곧바로 묶음을 없앨 수 있으므로 런타임은 따로 잡아 둠
+    runtime.submit([this, &runtime = runtime, task = std::move(task)] {
+        try {
+            task();
+        } catch (...) {
+            if (!has_error.exchange(true)) {
+                error = std::current_exception();
+            }
+        }
+        if (pending.fetch_sub(1) == 1) {
+            runtime.notify_idle();
+        }
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (runtime.run_one()) continue;
+        
+        // 남은 태스크가 다른 워커에서 도는 중: 끝나거나 훔칠 일이 생길 때까지 잠듦
+        // 태스크 안에서 다른 워커를 기다린 시간은 바깥 태스크의 busy 시간에서 제외
+        auto start = Clock::now();
+        runtime.park(pending);
+        if (t_task_depth > 0) {
+            t_join_wait_ns += elapsed_ns(start);
+        }
+    }
+
+    if (has_error.load()) {
+        has_error = false;
+        std::rethrow_exception(error);
+    }
+}
+
+// ============================================================================
+// 전역 런타임
+// ============================================================================
+
+static std::unique_ptr<TaskRuntime> g_task_runtime;
+
+void init_task_runtime(int num_threads) {
+    g_task_runtime.reset();
+    g_task_runtime = std::make_unique<TaskRuntime>(num_threads);
+}
+
+TaskRuntime& task_runtime() {
+    if (!g_task_runtime) {
+        g_task_runtime = std::make_unique<TaskRuntime>(0);
+    }
+    return *g_task_runtime;
+}